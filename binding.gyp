@@ -3,8 +3,11 @@
   {
     "target_name": "nodespotify",
     "sources": [
-      "src/node-spotify.cc", "src/audio/audio.c", "src/audio/AudioHandler.cc",
-      "src/audio/NodeAudioHandler.cc",
+      "src/node-spotify.cc", "src/Engine.cc", "src/audio/audio.c", "src/audio/audio-pool.c", "src/audio/audio-dsp.c",
+      "src/audio/audio-resample.c", "src/audio/file-audio.c", "src/audio/AudioHandler.cc",
+      "src/audio/Crossfader.cc", "src/audio/NodeAudioHandler.cc", "src/audio/FileAudioHandler.cc",
+      "src/audio/shm-audio.c", "src/audio/SharedMemoryAudioHandler.cc",
+      "src/audio/http-audio.c", "src/audio/HttpAudioHandler.cc",
       "src/callbacks/PlaylistCallbacksHolder.cc",
       "src/callbacks/SessionCallbacks.cc", "src/callbacks/SessionCallbacks_Audio.cc",
       "src/callbacks/SearchCallbacks.cc", "src/callbacks/AlbumBrowseCallbacks.cc",
@@ -24,7 +27,7 @@
       "src/objects/node/NodePlayer.cc", "src/objects/node/NodeSearch.cc",
       "src/objects/node/NodeSpotify.cc", "src/objects/node/NodePlaylistFolder.cc",
       "src/objects/node/NodePlaylistContainer.cc", "src/objects/node/NodeUser.cc",
-      "src/objects/node/NodeTrackExtended.cc"
+      "src/objects/node/NodeTrackExtended.cc", "src/objects/node/LoadWatcher.cc"
     ],
     "include_dirs": [
       "<!(node -e \"require('nan')\")"
@@ -34,7 +37,7 @@
     },
     "copies": [ {
       "destination": "<(PRODUCT_DIR)",
-      "files": ["src/spotify.js", "src/metadataUpdater.js"]
+      "files": ["src/spotify.js"]
       }
     ],
     "variables": {
@@ -59,6 +62,7 @@
           "-std=c++11",
           "-fexceptions"
           ],
+        "link_settings" : { "libraries" : ["-lrt"] },
         "defines": ["OS_LINUX"]
       }],
       [ "OS=='linux' and native_audio=='true'", {
@@ -0,0 +1,208 @@
+#include "Engine.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdlib.h>
+#include <thread>
+#include <utility>
+#include <uv.h>
+#include <node_version.h>
+
+bool Engine::threaded = false;
+int Engine::budget = 0;
+
+//The mutex is not fair, the engine thread would take it again right after a round while an API call waits for it.
+static std::recursive_mutex sessionMutex;
+//Threads waiting for the session, the engine thread does not start another round before they had it.
+static std::mutex handoffMutex;
+static std::condition_variable handoffCondition;
+static int waitingForSession = 0;
+
+static std::thread::id mainThread;
+//Never deleted, a joinable std::thread would terminate the process when it is destroyed on exit.
+static std::thread* engineThread = nullptr;
+static std::mutex wakeMutex;
+static std::condition_variable wakeCondition;
+static bool notified = false;
+static bool stopping = false;
+
+//Calls from the engine thread waiting to run on the main thread, with the object they use.
+static std::mutex queueMutex;
+static std::deque<std::pair<void*, std::function<void()>>> queue;
+static std::unique_ptr<uv_async_t> queueHandle;
+
+//Written by the thread that pumps, read by the main thread.
+static std::mutex pumpMutex;
+static PumpStats pumpStats;
+
+/**
+ * Runs all calls that were queued when the main thread was woken up. Calls queued while they run wait for the next
+ * turn of the loop, the engine thread cannot keep the main thread in here.
+ **/
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+static void handleQueue(uv_async_t* handle) {
+#else
+static void handleQueue(uv_async_t* handle, int status) {
+#endif
+  size_t pending;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    pending = queue.size();
+  }
+  //One at a time, a call may destroy an object and forget the calls queued for it.
+  while(pending-- > 0) {
+    //Taken first, so the references a call holds are released with the session held as well.
+    SessionLock sessionLock;
+    std::function<void()> call;
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      if(queue.empty()) {
+        break;
+      }
+      call = std::move(queue.front().second);
+      queue.pop_front();
+    }
+    call();
+  }
+}
+
+static void runEngine(sp_session* session) {
+  std::unique_lock<std::mutex> wakeLock(wakeMutex);
+  while(!stopping) {
+    int nextTimeout = 0;
+    int iterations = 0;
+    uint64_t start = uv_hrtime();
+    notified = false;
+    wakeLock.unlock();
+    do {
+      {
+        std::lock_guard<std::recursive_mutex> sessionLock(sessionMutex);
+        sp_session_process_events(session, &nextTimeout);
+      }
+      iterations++;
+      //Let a waiting API call in between two rounds.
+      std::unique_lock<std::mutex> handoffLock(handoffMutex);
+      handoffCondition.wait(handoffLock, [] { return waitingForSession == 0; });
+    } while(nextTimeout == 0 && !stopping);
+    Engine::recordPump(uv_hrtime() - start, iterations, false);
+    wakeLock.lock();
+    wakeCondition.wait_for(wakeLock, std::chrono::milliseconds(nextTimeout), [] { return notified || stopping; });
+  }
+}
+
+/**
+ * Lets the engine thread run out on exit. It is not joined, the main thread may exit from a JS callback that holds
+ * the session.
+ **/
+static void stopEngine() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    stopping = true;
+  }
+  wakeCondition.notify_one();
+  engineThread->detach();
+}
+
+void Engine::init(bool _threaded, int pumpBudget) {
+  mainThread = std::this_thread::get_id();
+  threaded = _threaded;
+  budget = pumpBudget;
+  if(threaded) {
+    queueHandle = std::unique_ptr<uv_async_t>(new uv_async_t());
+    uv_async_init(uv_default_loop(), queueHandle.get(), handleQueue);
+  }
+}
+
+void Engine::start(sp_session* session) {
+  if(!threaded || engineThread != nullptr) {
+    return;
+  }
+  engineThread = new std::thread(runEngine, session);
+  atexit(stopEngine);
+}
+
+bool Engine::onMainThread() {
+  return std::this_thread::get_id() == mainThread;
+}
+
+void Engine::notify() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    notified = true;
+  }
+  wakeCondition.notify_one();
+}
+
+void Engine::post(void* owner, std::function<void()> call) {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    queue.push_back(std::make_pair(owner, std::move(call)));
+  }
+  uv_async_send(queueHandle.get());
+}
+
+void Engine::lockSession() {
+  {
+    std::lock_guard<std::mutex> lock(handoffMutex);
+    waitingForSession++;
+  }
+  sessionMutex.lock();
+  {
+    std::lock_guard<std::mutex> lock(handoffMutex);
+    waitingForSession--;
+  }
+  handoffCondition.notify_one();
+}
+
+void Engine::unlockSession() {
+  sessionMutex.unlock();
+}
+
+void Engine::recordPump(uint64_t nanoseconds, int iterations, bool yielded) {
+  static const int durationLimits[ENGINE_DURATION_BUCKETS - 1] = ENGINE_DURATION_LIMITS_US;
+  static const int iterationLimits[ENGINE_ITERATION_BUCKETS - 1] = ENGINE_ITERATION_LIMITS;
+  uint64_t microseconds = nanoseconds / 1000;
+  int durationBucket = 0;
+  int iterationBucket = 0;
+  while(durationBucket < ENGINE_DURATION_BUCKETS - 1 && microseconds >= (uint64_t)durationLimits[durationBucket]) {
+    durationBucket++;
+  }
+  while(iterationBucket < ENGINE_ITERATION_BUCKETS - 1 && iterations >= iterationLimits[iterationBucket]) {
+    iterationBucket++;
+  }
+  std::lock_guard<std::mutex> lock(pumpMutex);
+  pumpStats.pumps++;
+  if(yielded) {
+    pumpStats.yields++;
+  }
+  pumpStats.duration[durationBucket]++;
+  pumpStats.iterations[iterationBucket]++;
+  if(microseconds > pumpStats.maxDuration) {
+    pumpStats.maxDuration = microseconds;
+  }
+  if(iterations > pumpStats.maxIterations) {
+    pumpStats.maxIterations = iterations;
+  }
+}
+
+void Engine::getPumpStats(PumpStats* stats) {
+  std::lock_guard<std::mutex> lock(pumpMutex);
+  *stats = pumpStats;
+}
+
+void Engine::forget(void* owner) {
+  if(!threaded) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(queueMutex);
+  for(auto it = queue.begin(); it != queue.end();) {
+    if(it->first == owner) {
+      it = queue.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
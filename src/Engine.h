@@ -0,0 +1,93 @@
+#ifndef _ENGINE_H
+#define _ENGINE_H
+
+#include <libspotify/api.h>
+#include <functional>
+#include <stdint.h>
+
+#define ENGINE_DURATION_BUCKETS 11
+#define ENGINE_DURATION_LIMITS_US { 100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000 }
+#define ENGINE_ITERATION_BUCKETS 9
+#define ENGINE_ITERATION_LIMITS { 2, 3, 5, 10, 20, 50, 100, 200 }
+
+/**
+ * Counters of the pumps, one pump calls sp_session_process_events until libspotify has nothing more to do right away
+ * or the budget is used up. A bucket counts the pumps below its limit, the last one those above all limits.
+ **/
+struct PumpStats {
+  int pumps;
+  int yields;
+  unsigned int duration[ENGINE_DURATION_BUCKETS];
+  unsigned int iterations[ENGINE_ITERATION_BUCKETS];
+  uint64_t maxDuration;
+  int maxIterations;
+};
+
+/**
+ * Runs sp_session_process_events either on the main thread, driven by the uv loop in SessionCallbacks, or in
+ * threaded mode on a native engine thread of its own.
+ *
+ * In threaded mode libspotify is used from two threads, so every use of it must hold a SessionLock. The engine thread
+ * holds it while it processes events, the main thread while a JS API call uses libspotify or releases one of its
+ * objects. Calls that only use state of the bindings do not take it, so they do not wait for the engine thread.
+ * libspotify callbacks that call into JS are fired on the engine thread, they are queued with post and run in a batch
+ * on the main thread.
+ **/
+class Engine {
+public:
+  /**
+   * Must be called before the sp_session is created, libspotify will call notify right away. A pump on the main thread
+   * yields to the event loop after pumpBudget ms, 0 for no limit.
+   **/
+  static void init(bool threaded, int pumpBudget);
+  /**
+   * Starts the engine thread for the created session. Does nothing if the engine is not threaded.
+   **/
+  static void start(sp_session* session);
+  static bool isThreaded() { return threaded; }
+  static int pumpBudget() { return budget; }
+  static void recordPump(uint64_t nanoseconds, int iterations, bool yielded);
+  static void getPumpStats(PumpStats* stats);
+  static bool onMainThread();
+  /**
+   * Wakes the engine thread to process events. Called from notify_main_thread on any thread.
+   **/
+  static void notify();
+  /**
+   * Queues a call to run on the main thread while holding the SessionLock. The owner is the object the call uses,
+   * forget must be called with it when it is destroyed so queued calls do not run on a deleted object.
+   **/
+  static void post(void* owner, std::function<void()> call);
+  static void forget(void* owner);
+  /**
+   * Takes the session for a SessionLock. The engine thread lets a thread that waits for it in before its next round.
+   **/
+  static void lockSession();
+  static void unlockSession();
+private:
+  static bool threaded;
+  static int budget;
+};
+
+/**
+ * Holds the libspotify session while it is in scope. Does nothing if the engine is not threaded.
+ **/
+class SessionLock {
+public:
+  SessionLock() : locked(Engine::isThreaded()) {
+    if(locked) {
+      Engine::lockSession();
+    }
+  }
+  ~SessionLock() {
+    if(locked) {
+      Engine::unlockSession();
+    }
+  }
+  SessionLock(const SessionLock&) = delete;
+  SessionLock& operator=(const SessionLock&) = delete;
+private:
+  bool locked;
+};
+
+#endif
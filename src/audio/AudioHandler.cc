@@ -2,72 +2,337 @@
 #include "AudioHandler.h"
 #include "../objects/spotify/Spotify.h"
 
-#include <stdlib.h>
-
 #ifdef OS_LINUX //For memcpy
 #include <string.h>
 #endif
+#include <thread>
 
 extern Application* application;
 
-AudioHandler::AudioHandler() {
+std::atomic<AudioHandler*> AudioHandler::active(nullptr);
+std::atomic<int> AudioHandler::callbacksRunning(0);
+
+AudioHandler::AudioHandler(AudioHandlerOptions options) : lowWatermark(options.lowWatermark),
+  highWatermark(options.highWatermark), sampleRate(0), refills(0), bufferFull(false),
+  reportedStutter(0), backpressure(options.backpressure) {
+  if(options.crossfadeDuration > 0) {
+    crossfader = std::unique_ptr<Crossfader>(new Crossfader(options.crossfadeDuration, options.crossfadeCurve));
+  }
+  audio_resampler_init(&resampler, options.outputRate, options.resampleQuality);
   audio_init(&audioFifo);
+  audioPool = audio_pool_create();
+  uv_mutex_init(&sinksMutex);
+  titles[0].first = -1;
+  titles[1].first = -1;
 }
 
 AudioHandler::~AudioHandler() {
+  //Nothing is put into the queues of the sinks anymore once their taps are gone.
+  for(auto& sink : sinks) {
+    audio_fifo_remove_tap(&audioFifo, &sink->audioFifo);
+  }
+  uv_mutex_lock(&sinksMutex);
+  sinks.clear();
+  uv_mutex_unlock(&sinksMutex);
+  uv_mutex_destroy(&sinksMutex);
   audio_stop(&audioFifo);
+  audio_pool_release(audioPool);
+  audio_resampler_destroy(&resampler);
 }
 
 int AudioHandler::musicDelivery(sp_session *session, const sp_audioformat *format, const void *frames, int num_frames) {
-  if(num_frames == 0 || !application->audioHandler->dataNeeded()) {
+  //Announced before the handler is loaded, so replace either sees this callback or it sees the new handler.
+  callbacksRunning++;
+  AudioHandler* audioHandler = active;
+  int consumed = audioHandler != nullptr ? audioHandler->deliver(format, frames, num_frames) : 0;
+  callbacksRunning--;
+  return consumed;
+}
+
+int AudioHandler::deliver(const sp_audioformat* format, const void* frames, int num_frames) {
+  if(num_frames == 0 || !dataNeeded()) {
     return 0;
   }
 
-  audio_fifo_t* audioFifo = &application->audioHandler->audioFifo;
-  uv_mutex_lock(&audioFifo->audioQueueMutex);
+  int rate = resampler.outputRate > 0 ? resampler.outputRate : format->sample_rate;
+  sampleRate = rate;
 
-  //If there is more than one second worth of samples in the queue don't buffer more
-  if(audioFifo->samplesInQueue > format->sample_rate) {
-    uv_mutex_unlock(&audioFifo->audioQueueMutex);
+  //Stop buffering above the high watermark and only start again once the queue drained to the low watermark,
+  //so libspotify gets to deliver in bursts instead of one chunk whenever one was played.
+  int64_t queuedMilliseconds = (int64_t)audio_fifo_samples(&audioFifo) * 1000 / rate;
+  if(bufferFull) {
+    if(queuedMilliseconds > lowWatermark) {
+      return 0;
+    }
+    bufferFull = false;
+    refills++;
+  }
+  if(queuedMilliseconds > highWatermark) {
+    bufferFull = true;
+    return 0;
+  }
+  //A full queue or a full sink that paces the delivery would refuse the chunk, so would the crossfader while audio it
+  //already took waits for the queue. Checked before the resampler takes the frames, libspotify delivers them again
+  //later. Nothing else puts into the queue, so the chunk will fit.
+  if(audio_fifo_free_slots(&audioFifo) == 0 || !audio_fifo_taps_ready(&audioFifo, rate) ||
+    (crossfader && !crossfader->ready(&audioFifo))) {
     return 0;
   }
 
-  size_t size = num_frames * sizeof(int16_t) * format->channels;
-  audio_fifo_data_t* audioData = (audio_fifo_data_t*)malloc(sizeof(*audioData) + size);
-  memcpy(audioData->samples, frames, size);
+  audio_fifo_data_t* audioData;
+  int epoch = audio_clock_epoch(&audioFifo.clock);
+  if(resampler.outputRate > 0) {
+    int maxFrames = audio_resampler_max_output(&resampler, format->sample_rate, num_frames);
+    audioData = audio_data_alloc(audioPool, maxFrames * sizeof(int16_t) * AUDIO_RESAMPLE_CHANNELS);
+    audioData->numberOfSamples = audio_resample(&resampler, audioData->samples, (const int16_t*)frames, num_frames,
+      format->sample_rate, format->channels, epoch);
+    audioData->sampleRate = resampler.outputRate;
+    audioData->channels = AUDIO_RESAMPLE_CHANNELS;
+    if(audioData->numberOfSamples == 0) {
+      //All of it went into the filter.
+      audio_data_free(audioData);
+      return num_frames;
+    }
+  } else {
+    size_t size = num_frames * sizeof(int16_t) * format->channels;
+    audioData = audio_data_alloc(audioPool, size);
+    memcpy(audioData->samples, frames, size);
+    audioData->numberOfSamples = num_frames;
+    audioData->sampleRate = format->sample_rate;
+    audioData->channels = format->channels;
+  }
+  audioData->epoch = epoch;
 
-  audioData->numberOfSamples = num_frames;
-  audioData->sampleRate = format->sample_rate;
-  audioData->channels = format->channels;
+  bool taken = crossfader ? crossfader->process(&audioFifo, audioData) :
+    audio_fifo_put(&audioFifo, audioData);
+  if(!taken) {
+    if(resampler.outputRate == 0) {
+      audio_data_free(audioData);
+      return 0;
+    }
+    //The resampler already has the frames in its filter, taking them again would play them twice.
+    audio_telemetry_lost(&audioFifo, audioData->numberOfSamples);
+    audio_data_free(audioData);
+    return num_frames;
+  }
 
-  TAILQ_INSERT_TAIL(&audioFifo->queue, audioData, link);
-  audioFifo->samplesInQueue += num_frames;
+  notifyDelivery(format);
 
-  application->audioHandler->framesReceived += num_frames;
-  if( application->audioHandler->framesReceived / audioData->sampleRate > 0) {
-    application->audioHandler->currentSecond++;
-    application->audioHandler->framesReceived = application->audioHandler->framesReceived - audioData->sampleRate;
-    application->player->setCurrentSecond(application->audioHandler->currentSecond);
-  }
+  return num_frames;
+}
 
-  application->audioHandler->afterMusicDelivery(format);
+void AudioHandler::notifyDelivery(const sp_audioformat* format) {
+  afterMusicDelivery(format);
+  uv_mutex_lock(&sinksMutex);
+  for(auto& sink : sinks) {
+    sink->sampleRate = sampleRate.load();
+    sink->afterMusicDelivery(format);
+  }
+  uv_mutex_unlock(&sinksMutex);
+}
 
-  uv_mutex_unlock(&audioFifo->audioQueueMutex);
+bool AudioHandler::addSink(std::unique_ptr<AudioHandler> sink, int backpressure) {
+  sink->backpressure = backpressure;
+  uv_mutex_lock(&sinksMutex);
+  //In the list first, so it is notified as soon as the tap fills its queue.
+  sinks.push_back(std::move(sink));
+  uv_mutex_unlock(&sinksMutex);
+  AudioHandler* added = sinks.back().get();
+  if(audio_fifo_add_tap(&audioFifo, &added->audioFifo, backpressure, added->highWatermark) != 0) {
+    uv_mutex_lock(&sinksMutex);
+    sinks.pop_back();
+    uv_mutex_unlock(&sinksMutex);
+    return false;
+  }
+  for(auto& title : titles) {
+    if(title.first >= 0) {
+      added->setTitle(title.first, title.second);
+    }
+  }
+  return true;
+}
 
-  return num_frames;
+std::vector<AudioHandler*> AudioHandler::getSinks() {
+  std::vector<AudioHandler*> handlers;
+  for(auto& sink : sinks) {
+    handlers.push_back(sink.get());
+  }
+  return handlers;
 }
 
 void AudioHandler::getAudioBufferStats(sp_session* session, sp_audio_buffer_stats* stats) {
-  //TODO:this crashes when switching the audio handler in between playback because the mutex gets destroyed.
-  audio_fifo_t *audioFifo = &application->audioHandler->audioFifo;
-  uv_mutex_lock(&audioFifo->audioQueueMutex);
-  stats->samples = audioFifo->samplesInQueue;
-  stats->stutter = 0;
-  uv_mutex_unlock(&audioFifo->audioQueueMutex);
+  callbacksRunning++;
+  AudioHandler* audioHandler = active;
+  if(audioHandler != nullptr) {
+    AudioBufferStats bufferStats;
+    audioHandler->getBufferStats(&bufferStats);
+    stats->samples = bufferStats.samples;
+    stats->stutter = audioHandler->takeStutter();
+  } else {
+    stats->samples = 0;
+    stats->stutter = 0;
+  }
+  callbacksRunning--;
+}
+
+void AudioHandler::replace(std::unique_ptr<AudioHandler>& current, std::unique_ptr<AudioHandler> next) {
+  //libspotify finds no handler while the audio changes hands, it delivers what it has again later.
+  active = nullptr;
+  while(callbacksRunning > 0) {
+    std::this_thread::yield();
+  }
+  if(current && next) {
+    next->takeOver(*current);
+  }
+  active = next.get();
+  //No callback can get to the old handler anymore, it goes away with the assignment.
+  current = std::move(next);
+}
+
+/**
+ * @brief AudioHandler::takeOver Continue where previous stopped. Neither handler gets audio from libspotify meanwhile.
+ */
+void AudioHandler::takeOver(AudioHandler& previous) {
+  previous.haltConsumer();
+  if(previous.crossfader) {
+    //A crossfade does not survive the change, what was held back is played as it is.
+    previous.crossfader->release(&previous.audioFifo);
+  }
+  audio_fifo_take_over(&audioFifo, &previous.audioFifo);
+  sampleRate = previous.sampleRate.load();
+  for(auto& title : previous.titles) {
+    if(title.first >= 0) {
+      setTitle(title.first, title.second);
+    }
+  }
+  //The sinks stay, with the same audio queued.
+  for(auto& sink : previous.sinks) {
+    audio_fifo_remove_tap(&previous.audioFifo, &sink->audioFifo);
+  }
+  uv_mutex_lock(&previous.sinksMutex);
+  std::vector<std::unique_ptr<AudioHandler>> previousSinks = std::move(previous.sinks);
+  previous.sinks.clear();
+  uv_mutex_unlock(&previous.sinksMutex);
+  for(auto& sink : previousSinks) {
+    int sinkBackpressure = sink->backpressure;
+    //More than AUDIO_MAX_TAPS sinks can't have been added, the new handler has none yet.
+    addSink(std::move(sink), sinkBackpressure);
+  }
+  afterMusicDelivery(nullptr);
+}
+
+void AudioHandler::haltConsumer() {
+}
+
+void AudioHandler::setTitle(int epoch, const std::string& title) {
+  //The title of the older epoch goes, the other one is still played or the next to come.
+  int slot = titles[0].first == epoch || (titles[1].first != epoch && titles[0].first < titles[1].first) ? 0 : 1;
+  titles[slot] = std::make_pair(epoch, title);
+  titleChanged(epoch, title);
+  for(auto& sink : sinks) {
+    sink->setTitle(epoch, title);
+  }
+}
+
+void AudioHandler::titleChanged(int epoch, const std::string& title) {
+}
+
+/**
+ * @brief AudioHandler::takeStutter Underruns of the queue and of the device since libspotify last asked.
+ */
+int AudioHandler::takeStutter() {
+  audio_telemetry_t telemetry;
+  audio_output_stats_t outputStats;
+  audio_telemetry_get(&audioFifo, &telemetry);
+  int total = telemetry.underruns + (getOutputStats(&outputStats) ? outputStats.xruns : 0);
+  int stutter = total - reportedStutter;
+  reportedStutter = total;
+  return stutter;
+}
+
+void AudioHandler::getTelemetry(audio_telemetry_t* telemetry) {
+  audio_telemetry_get(&audioFifo, telemetry);
+}
+
+void AudioHandler::getBufferStats(AudioBufferStats* stats) {
+  int rate = sampleRate;
+  stats->samples = audio_fifo_samples(&audioFifo);
+  stats->milliseconds = rate > 0 ? (int)((int64_t)stats->samples * 1000 / rate) : 0;
+  stats->lowWatermark = lowWatermark;
+  stats->highWatermark = highWatermark;
+  stats->refills = refills;
+}
+
+bool AudioHandler::getOutputStats(audio_output_stats_t* stats) {
+  return false;
+}
+
+bool AudioHandler::getFileStats(audio_file_stats_t* stats) {
+  return false;
+}
+
+bool AudioHandler::getHttpStats(audio_http_stats_t* stats) {
+  return false;
+}
+
+int AudioHandler::resetClock() {
+  //New epoch first, so whatever is delivered while flushing already counts for the new position.
+  int epoch = audio_clock_reset(&audioFifo.clock);
+  if(crossfader) {
+    crossfader->discard();
+  }
+  audio_fifo_flush(&audioFifo);
+  bufferFull = false;
+  //The sinks count in the same epochs.
+  for(auto& sink : sinks) {
+    sink->resetClock();
+  }
+  return epoch;
+}
+
+int AudioHandler::queueNextTrack() {
+  for(auto& sink : sinks) {
+    sink->queueNextTrack();
+  }
+  return audio_clock_next(&audioFifo.clock);
+}
+
+void AudioHandler::setVolume(double volume) {
+  audio_gain_set(&audioFifo.gain, (int)(volume * AUDIO_GAIN_UNITY + 0.5));
+  for(auto& sink : sinks) {
+    sink->setVolume(volume);
+  }
+}
+
+void AudioHandler::armCrossfade(bool nextTrack) {
+  if(crossfader) {
+    crossfader->setArmed(nextTrack);
+  }
+}
+
+void AudioHandler::releaseHeldBack() {
+  if(crossfader) {
+    crossfader->release(&audioFifo);
+    notifyDelivery(nullptr);
+  }
+}
+
+double AudioHandler::playedMilliseconds(int* epoch) {
+  int rate;
+  int64_t frames = audio_clock_frames(&audioFifo.clock, &rate, epoch);
+  return rate > 0 ? frames * 1000.0 / rate : 0;
+}
+
+void AudioHandler::getPoolStats(audio_pool_stats_t* stats) {
+  audio_pool_get_stats(audioPool, stats);
 }
 
 void AudioHandler::setStopped(bool stopped) {
   if(stopped == false) {
     audio_fifo_flush(&audioFifo);
+    bufferFull = false;
+  }
+  for(auto& sink : sinks) {
+    sink->setStopped(stopped);
   }
 }
@@ -5,7 +5,74 @@ extern "C" {
   #include "audio.h"
 }
 
+#include "Crossfader.h"
+
 #include <libspotify/api.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The highest watermark in milliseconds. The queue holds AUDIO_FIFO_SLOTS chunks, libspotify delivers about 46 ms per
+ * chunk, so it only fills up before this is queued if the chunks are shorter than 10 ms on average.
+ */
+#define AUDIO_MAX_WATERMARK 10000
+
+/**
+ * Options every audio handler understands. Set from the options object of spotify.useNativeAudio and
+ * spotify.useNodejsAudio.
+ */
+struct AudioHandlerOptions {
+  AudioHandlerOptions() : lowWatermark(1000), highWatermark(1000), crossfadeDuration(0), crossfadeCurve(CROSSFADE_LINEAR),
+    outputRate(0), resampleQuality(AUDIO_RESAMPLE_MEDIUM), addSink(false), backpressure(AUDIO_TAP_SKIP) {}
+  /**
+   * Once the queue was full, no audio is taken from libspotify again until less than this many milliseconds are queued.
+   */
+  int lowWatermark;
+  /**
+   * No audio is taken from libspotify while more than this many milliseconds are queued, at most AUDIO_MAX_WATERMARK.
+   */
+  int highWatermark;
+  /**
+   * Milliseconds the end of a track overlaps with the next one set with player.setNext, 0 to play them back to back.
+   */
+  int crossfadeDuration;
+  CrossfadeCurve crossfadeCurve;
+  /**
+   * If > 0 all audio is resampled to stereo at this rate, so the format never changes.
+   */
+  int outputRate;
+  /**
+   * One of AUDIO_RESAMPLE_LOW, AUDIO_RESAMPLE_MEDIUM and AUDIO_RESAMPLE_HIGH.
+   */
+  int resampleQuality;
+  /**
+   * Add the handler as another sink of the current one instead of replacing it. The audio of the current handler,
+   * after its resampler and crossfade, is shared with the sink, which only keeps its own queue and volume.
+   */
+  bool addSink;
+  /**
+   * What happens if the queue of an added sink is above its high watermark, one of AUDIO_TAP_BLOCK,
+   * AUDIO_TAP_DROP_OLDEST and AUDIO_TAP_SKIP.
+   */
+  int backpressure;
+};
+
+/**
+ * Fill level of the queue of an audio handler together with its watermarks.
+ */
+struct AudioBufferStats {
+  int samples;
+  int milliseconds;
+  int lowWatermark;
+  int highWatermark;
+  /**
+   * How often the queue was refilled after it had reached the high watermark.
+   */
+  int refills;
+};
 
 /**
  * @brief The AudioHandler class
@@ -13,19 +80,115 @@ extern "C" {
  * that pushes music data into a queue and a audio buffer stats callback.
  */
 class AudioHandler {
-friend class Player; // to set current second and frames received on stop
 friend class Spotify; // access the callback methods
 public:
-  AudioHandler();
+  AudioHandler(AudioHandlerOptions options = AudioHandlerOptions());
   virtual ~AudioHandler();
   virtual void setStopped(bool stopped);
+  void getPoolStats(audio_pool_stats_t* stats);
+  void getBufferStats(AudioBufferStats* stats);
+  /**
+   * @brief getTelemetry Frames going through the queue, underruns, queue depth and latency since the handler was created.
+   */
+  void getTelemetry(audio_telemetry_t* telemetry);
+  /**
+   * @brief getOutputStats Counters of the device the audio is played on.
+   * @return false if the handler plays to no device.
+   */
+  virtual bool getOutputStats(audio_output_stats_t* stats);
+  /**
+   * @brief getFileStats Counters of the files the audio is written to.
+   * @return false if the handler writes no files.
+   */
+  virtual bool getFileStats(audio_file_stats_t* stats);
+  /**
+   * @brief getHttpStats Counters of the listeners the audio is streamed to.
+   * @return false if the handler streams to no listeners.
+   */
+  virtual bool getHttpStats(audio_http_stats_t* stats);
+  /**
+   * @brief resetClock Throw away queued audio and restart the playback clock at zero, for a new track or after a seek.
+   * @return the epoch of the clock from now on.
+   */
+  int resetClock();
+  /**
+   * @brief queueNextTrack Audio delivered from now on is the next track, which the clock switches to once it is played.
+   * Queued audio is kept.
+   * @return the epoch of the next track.
+   */
+  int queueNextTrack();
+  /**
+   * @brief playedMilliseconds How much audio of the track in the given epoch the sink has played.
+   */
+  double playedMilliseconds(int* epoch);
+  /**
+   * @brief setVolume Linear gain between 0 and 1 for the audio leaving the queue. Changes are ramped.
+   */
+  void setVolume(double volume);
+  /**
+   * @brief setTitle Title of the track whose audio is delivered in the clock epoch, for sinks that send it along. The
+   * titles of the last two epochs are passed on to sinks added later and to the handler taking over.
+   */
+  void setTitle(int epoch, const std::string& title);
+  /**
+   * @brief armCrossfade Tell the crossfade stage whether a next track follows, so it holds back the end of the current one.
+   */
+  void armCrossfade(bool nextTrack);
+  /**
+   * @brief releaseHeldBack The track ended without a next one, play what the crossfade stage held back.
+   */
+  void releaseHeldBack();
+  /**
+   * @brief addSink Also give the delivered audio to sink, without copying it. Only call it from the main thread.
+   * @param backpressure what to do if the sink does not keep up, see AudioHandlerOptions::backpressure.
+   * @return false if the handler already has AUDIO_MAX_TAPS sinks.
+   */
+  bool addSink(std::unique_ptr<AudioHandler> sink, int backpressure);
+  /**
+   * @brief getSinks The handlers added with addSink. Only call it from the main thread.
+   */
+  std::vector<AudioHandler*> getSinks();
+  /**
+   * @brief replace Make next the handler libspotify delivers to and destroy current once no callback of libspotify
+   * uses it anymore. next takes over the queued audio, the playback clock, the volume and the sinks of current, so
+   * playback goes on without a flush. Only call it from the main thread.
+   */
+  static void replace(std::unique_ptr<AudioHandler>& current, std::unique_ptr<AudioHandler> next);
 protected:
   audio_fifo_t audioFifo;
-  int framesReceived;
-  int currentSecond;
+  audio_pool_t* audioPool;
+  const int lowWatermark;
+  const int highWatermark;
+  /**
+   * Written by the delivery thread, read by audioStats.
+   */
+  std::atomic<int> sampleRate;
+  std::atomic<int> refills;
+  /**
+   * The high watermark was reached and the queue has not yet drained to the low watermark. Reset on a flush.
+   */
+  std::atomic<bool> bufferFull;
+  /**
+   * Sits between musicDelivery and the queue if crossfading is enabled.
+   */
+  std::unique_ptr<Crossfader> crossfader;
+  /**
+   * Sits between libspotify and the crossfader if an output rate is set. Only used on the delivery thread.
+   */
+  audio_resampler_t resampler;
+  /**
+   * Underruns and xruns already reported to libspotify as stutter. Only used on libspotify's thread.
+   */
+  int reportedStutter;
+  /**
+   * Handlers getting the same audio. Changed on the main thread, the delivery thread notifies them under sinksMutex.
+   */
+  std::vector<std::unique_ptr<AudioHandler>> sinks;
+  uv_mutex_t sinksMutex;
   /**
    * @brief afterMusicDelivery Method that will be called after audio data has been written into the queue.
-   * @param format audio format delivered together with the raw music data by libspotify.
+   * @param format audio format delivered together with the raw music data by libspotify, nullptr if held back audio
+   * was released.
    */
   virtual void afterMusicDelivery(const sp_audioformat* format) = 0;
   /**
@@ -34,7 +197,30 @@ protected:
    * @return
    */
   virtual bool dataNeeded() = 0;
+  /**
+   * @brief haltConsumer Stop taking audio out of the queue, which is then handed to another handler. Handlers with
+   * a consumer thread stop it, the default does nothing.
+   */
+  virtual void haltConsumer();
+  /**
+   * @brief titleChanged The title of the track in the clock epoch was set. The default does nothing.
+   */
+  virtual void titleChanged(int epoch, const std::string& title);
 private:
+  /**
+   * The handler libspotify's callbacks use, nullptr while it is replaced. callbacksRunning counts the callbacks that
+   * may still use the handler they loaded.
+   */
+  static std::atomic<AudioHandler*> active;
+  static std::atomic<int> callbacksRunning;
+  /**
+   * What happens if this handler is a sink and falls behind.
+   */
+  int backpressure;
+  /**
+   * Titles set with setTitle by clock epoch, -1 if unused.
+   */
+  std::pair<int, std::string> titles[2];
   /**
    * @brief AudioHandler::musicDelivery Callack for libspotify. Write the music data into the queue and call the abstract afterMusic
    * delivery method.
@@ -45,7 +231,14 @@ private:
    * @return The number of frames consumed.
    */
   static int musicDelivery(sp_session* session, const sp_audioformat* format, const void* frames, int num_frames);
+  int deliver(const sp_audioformat* format, const void* frames, int num_frames);
   static void getAudioBufferStats(sp_session* session, sp_audio_buffer_stats* stats);
+  int takeStutter();
+  /**
+   * @brief notifyDelivery Calls afterMusicDelivery of this handler and of its sinks.
+   */
+  void notifyDelivery(const sp_audioformat* format);
+  void takeOver(AudioHandler& previous);
 };
 
 #endif // AUDIOHANDLER_H
@@ -0,0 +1,214 @@
+#include "Crossfader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#define CURVE_STEPS 1024
+//Room for the gains of a crossfade at up to this rate in stereo, so starting one does not allocate.
+#define RESERVED_RATE 48000
+#define RESERVED_CHUNK_FRAMES 8192
+
+Crossfader::Crossfader(int _duration, CrossfadeCurve curve) : duration(_duration), curveTable(CURVE_STEPS + 1),
+  armed(false), heldOffset(0), heldFrames(0), fadePosition(0), fadeFrames(0) {
+  uv_mutex_init(&mutex);
+  //Both curves are symmetric, the outgoing gain at t is the incoming gain at 1 - t.
+  const double quarterTurn = std::atan(1.0) * 2;
+  for(int i = 0; i <= CURVE_STEPS; i++) {
+    double t = (double)i / CURVE_STEPS;
+    double gain = curve == CROSSFADE_EQUAL_POWER ? std::sin(t * quarterTurn) : t;
+    curveTable[i] = (int16_t)std::lround(gain * INT16_MAX);
+  }
+  //The crossfade is as long as what was held back, at most a chunk more than the duration.
+  size_t reserved = ((size_t)duration * RESERVED_RATE / 1000 + RESERVED_CHUNK_FRAMES + 1) * 2;
+  gainIn.reserve(reserved);
+  gainOut.reserve(reserved);
+}
+
+Crossfader::~Crossfader() {
+  discardAll();
+  uv_mutex_destroy(&mutex);
+}
+
+bool Crossfader::ready(audio_fifo_t* audioFifo) {
+  uv_mutex_lock(&mutex);
+  bool empty = putWaiting(audioFifo);
+  uv_mutex_unlock(&mutex);
+  return empty;
+}
+
+bool Crossfader::process(audio_fifo_t* audioFifo, audio_fifo_data_t* audioData) {
+  uv_mutex_lock(&mutex);
+  //Audio of earlier deliveries goes first, libspotify delivers this chunk again.
+  if(!putWaiting(audioFifo)) {
+    uv_mutex_unlock(&mutex);
+    return false;
+  }
+  if(!heldBack.empty() && audioData->epoch != heldBack.front()->epoch) {
+    //Audio of the next track.
+    audio_fifo_data_t* tail = heldBack.front();
+    if(audioData->sampleRate == tail->sampleRate && audioData->channels == tail->channels) {
+      mix(audioData);
+    } else {
+      releaseAll();
+    }
+    waiting.push_back(audioData);
+  } else if(armed) {
+    heldBack.push_back(audioData);
+    heldFrames += audioData->numberOfSamples;
+    //Keep whole chunks that cover at least the crossfade.
+    int durationFrames = (int)((int64_t)duration * audioData->sampleRate / 1000);
+    while(heldFrames - (heldBack.front()->numberOfSamples - heldOffset) >= durationFrames) {
+      audio_fifo_data_t* released = heldBack.front();
+      heldFrames -= released->numberOfSamples - heldOffset;
+      heldOffset = 0;
+      heldBack.pop_front();
+      waiting.push_back(released);
+    }
+  } else {
+    //Disarmed while audio was held back, the current track goes on.
+    releaseAll();
+    waiting.push_back(audioData);
+  }
+  //Whatever the fifo refuses now goes in with the next chunk.
+  putWaiting(audioFifo);
+  uv_mutex_unlock(&mutex);
+  return true;
+}
+
+/**
+ * @brief Crossfader::putWaiting Puts waiting chunks into the fifo in order until it refuses one.
+ * @return true if nothing is waiting anymore.
+ */
+bool Crossfader::putWaiting(audio_fifo_t* audioFifo) {
+  while(!waiting.empty() && audio_fifo_put(audioFifo, waiting.front())) {
+    waiting.pop_front();
+  }
+  return waiting.empty();
+}
+
+/**
+ * @brief Crossfader::mix Mixes the beginning of the next track into audioData with the held back end of the current one.
+ * The crossfade is as long as what was held back when the next track started.
+ */
+void Crossfader::mix(audio_fifo_data_t* audioData) {
+  int channels = audioData->channels;
+  if(fadeFrames == 0) {
+    fadeFrames = heldFrames;
+    fadePosition = 0;
+    armed = false;
+    buildRamp(channels);
+  }
+  int mixed = 0;
+  while(mixed < audioData->numberOfSamples && !heldBack.empty()) {
+    audio_fifo_data_t* tail = heldBack.front();
+    int frames = std::min(audioData->numberOfSamples - mixed, tail->numberOfSamples - heldOffset);
+    int16_t* head = audioData->samples + mixed * channels;
+    audio_dsp_mix(head, head, gainIn.data() + fadePosition * channels, tail->samples + heldOffset * channels,
+      gainOut.data() + fadePosition * channels, frames * channels);
+    mixed += frames;
+    heldOffset += frames;
+    heldFrames -= frames;
+    fadePosition += frames;
+    if(heldOffset == tail->numberOfSamples) {
+      heldBack.pop_front();
+      heldOffset = 0;
+      audio_data_free(tail);
+    }
+  }
+  if(heldBack.empty()) {
+    fadeFrames = 0;
+  }
+}
+
+/**
+ * @brief Crossfader::buildRamp Gains of every sample of the crossfade that starts, interpolated from the curve table.
+ * The position in the table is in Q8 and advances per frame by a quotient, the remainder is carried over, so it ends
+ * exactly at the end of the table without a division per frame. The outgoing gain is the incoming one backwards.
+ */
+void Crossfader::buildRamp(int channels) {
+  gainIn.resize((size_t)(fadeFrames + 1) * channels);
+  gainOut.resize((size_t)(fadeFrames + 1) * channels);
+  const int step = CURVE_STEPS * 256 / fadeFrames;
+  const int remainder = CURVE_STEPS * 256 % fadeFrames;
+  int position = 0;
+  int carry = 0;
+  for(int i = 0; i <= fadeFrames; i++) {
+    int index = position >> 8;
+    int16_t gain = curveTable[CURVE_STEPS];
+    if(index < CURVE_STEPS) {
+      int fraction = position & 255;
+      gain = (int16_t)(curveTable[index] + (((curveTable[index + 1] - curveTable[index]) * fraction) >> 8));
+    }
+    position += step;
+    carry += remainder;
+    if(carry >= fadeFrames) {
+      carry -= fadeFrames;
+      position++;
+    }
+    for(int c = 0; c < channels; c++) {
+      gainIn[i * channels + c] = gain;
+    }
+  }
+  for(int i = 0; i <= fadeFrames; i++) {
+    for(int c = 0; c < channels; c++) {
+      gainOut[i * channels + c] = gainIn[(fadeFrames - i) * channels];
+    }
+  }
+}
+
+void Crossfader::setArmed(bool _armed) {
+  uv_mutex_lock(&mutex);
+  armed = _armed;
+  uv_mutex_unlock(&mutex);
+}
+
+void Crossfader::release(audio_fifo_t* audioFifo) {
+  uv_mutex_lock(&mutex);
+  releaseAll();
+  putWaiting(audioFifo);
+  for(audio_fifo_data_t* audioData : waiting) {
+    audio_telemetry_lost(audioFifo, audioData->numberOfSamples);
+    audio_data_free(audioData);
+  }
+  waiting.clear();
+  uv_mutex_unlock(&mutex);
+}
+
+void Crossfader::discard() {
+  uv_mutex_lock(&mutex);
+  discardAll();
+  uv_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Crossfader::releaseAll Moves the held back audio behind the waiting audio.
+ */
+void Crossfader::releaseAll() {
+  //Only the part of a chunk that was not mixed yet, a crossfade that could not finish is cut off.
+  if(!heldBack.empty() && heldOffset > 0) {
+    audio_fifo_data_t* front = heldBack.front();
+    front->numberOfSamples -= heldOffset;
+    memmove(front->samples, front->samples + heldOffset * front->channels,
+      front->numberOfSamples * front->channels * sizeof(int16_t));
+  }
+  waiting.insert(waiting.end(), heldBack.begin(), heldBack.end());
+  heldBack.clear();
+  heldOffset = 0;
+  heldFrames = 0;
+  fadeFrames = 0;
+}
+
+void Crossfader::discardAll() {
+  for(audio_fifo_data_t* audioData : heldBack) {
+    audio_data_free(audioData);
+  }
+  for(audio_fifo_data_t* audioData : waiting) {
+    audio_data_free(audioData);
+  }
+  heldBack.clear();
+  waiting.clear();
+  heldOffset = 0;
+  heldFrames = 0;
+  fadeFrames = 0;
+}
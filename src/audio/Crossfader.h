@@ -0,0 +1,83 @@
+#ifndef CROSSFADER_H
+#define CROSSFADER_H
+
+extern "C" {
+  #include "audio.h"
+}
+
+#include <uv.h>
+#include <deque>
+#include <vector>
+
+enum CrossfadeCurve {
+  CROSSFADE_LINEAR,
+  CROSSFADE_EQUAL_POWER
+};
+
+/**
+ * @brief The Crossfader class
+ * Overlaps the end of a track with the beginning of the next one. While a next track is armed the last duration
+ * milliseconds of the delivered audio are held back. The first audio of the next track is mixed with what was held back.
+ * process runs on libspotify's delivery thread, the main thread arms the crossfader and releases or discards held back
+ * audio. A mutex serializes the two, which also keeps putting into the fifo single producer.
+ * Audio the fifo refuses waits in the crossfader and goes in first the next time, it can't be handed back to libspotify.
+ */
+class Crossfader {
+public:
+  Crossfader(int duration, CrossfadeCurve curve);
+  ~Crossfader();
+  /**
+   * @brief ready Puts waiting audio into the fifo. Whether process takes the next chunk.
+   */
+  bool ready(audio_fifo_t* audioFifo);
+  /**
+   * @brief process Takes a delivered chunk and puts everything that is ready to be played into the fifo.
+   * @return false if the chunk was not taken because audio is still waiting for the fifo.
+   */
+  bool process(audio_fifo_t* audioFifo, audio_fifo_data_t* audioData);
+  /**
+   * @brief setArmed Whether a next track follows the current one, only then audio is held back.
+   */
+  void setArmed(bool armed);
+  /**
+   * @brief release Put held back audio into the fifo as it is, because no track follows after all. Audio the fifo
+   * refuses is counted as lost, nothing is delivered afterwards that could take it there.
+   */
+  void release(audio_fifo_t* audioFifo);
+  /**
+   * @brief discard Throw away held back audio, e.g. after a seek.
+   */
+  void discard();
+private:
+  const int duration;
+  /**
+   * Q15 gain of the incoming track over the crossfade in CURVE_STEPS steps. The outgoing track uses it backwards.
+   */
+  std::vector<int16_t> curveTable;
+  uv_mutex_t mutex;
+  bool armed;
+  std::deque<audio_fifo_data_t*> heldBack;
+  /**
+   * Chunks that are ready to be played but were refused by the fifo, in order.
+   */
+  std::deque<audio_fifo_data_t*> waiting;
+  /**
+   * Frames of the first held back chunk that were already mixed.
+   */
+  int heldOffset;
+  int heldFrames;
+  int fadePosition;
+  int fadeFrames;
+  /**
+   * Gains of every sample of the running crossfade, built once when it starts.
+   */
+  std::vector<int16_t> gainIn;
+  std::vector<int16_t> gainOut;
+  void mix(audio_fifo_data_t* audioData);
+  void buildRamp(int channels);
+  bool putWaiting(audio_fifo_t* audioFifo);
+  void releaseAll();
+  void discardAll();
+};
+
+#endif // CROSSFADER_H
@@ -0,0 +1,38 @@
+#include "FileAudioHandler.h"
+
+#include <string.h>
+
+FileAudioHandler::FileAudioHandler(FileAudioOptions options) : AudioHandler(options) {
+  audio_output_options_t outputOptions;
+  memset(&outputOptions, 0, sizeof(outputOptions));
+  memset(&sink, 0, sizeof(sink));
+  strncpy(sink.options.path, options.path.c_str(), AUDIO_PATH_LENGTH - 1);
+  sink.options.format = options.format;
+  sink.options.writeSize = options.writeSize;
+  sink.options.direct = options.direct;
+  sink.options.preallocate = options.preallocate;
+  audio_init_file(&audioFifo, audioPool, &sink, &outputOptions);
+}
+
+FileAudioHandler::~FileAudioHandler() {
+  //Joins the writing thread, which completes the file.
+  audio_stop_native(&audioFifo);
+}
+
+void FileAudioHandler::afterMusicDelivery(const sp_audioformat *format) {
+  audio_signal_native(&audioFifo);
+}
+
+void FileAudioHandler::haltConsumer() {
+  //Completes the file, the audio still queued goes to the next handler.
+  audio_halt_native(&audioFifo);
+}
+
+bool FileAudioHandler::getFileStats(audio_file_stats_t* stats) {
+  audio_file_get_stats(&sink, stats);
+  return true;
+}
+
+bool FileAudioHandler::dataNeeded() {
+  return true;
+}
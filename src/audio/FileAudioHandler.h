@@ -0,0 +1,55 @@
+#ifndef FILEAUDIOHANDLER_H
+#define FILEAUDIOHANDLER_H
+
+#include "AudioHandler.h"
+
+#include <string>
+
+/**
+ * Options for the file audio handler, set from spotify.useFileAudio.
+ */
+struct FileAudioOptions : public AudioHandlerOptions {
+  FileAudioOptions() : format(AUDIO_FILE_WAV), writeSize(0), direct(false), preallocate(0) {}
+  /**
+   * File to write to, %d is replaced by the number of the track to write one file per track.
+   */
+  std::string path;
+  /**
+   * AUDIO_FILE_WAV or AUDIO_FILE_RAW.
+   */
+  int format;
+  /**
+   * Bytes per write, a multiple of 4096. 0 for the default of 1 MB.
+   */
+  int writeSize;
+  /**
+   * Bypass the page cache (O_DIRECT) if the file system allows it.
+   */
+  bool direct;
+  /**
+   * Bytes of disk space to reserve at a time ahead of the writes, 0 to not reserve any.
+   */
+  int64_t preallocate;
+};
+
+/**
+ * @brief The FileAudioHandler class
+ * Writes the audio as WAV or raw PCM files from its own thread, as fast as libspotify delivers it.
+ */
+class FileAudioHandler : public AudioHandler {
+public:
+  FileAudioHandler(FileAudioOptions options);
+  ~FileAudioHandler();
+  bool getFileStats(audio_file_stats_t* stats);
+protected:
+  void afterMusicDelivery(const sp_audioformat* format);
+  bool dataNeeded();
+  void haltConsumer();
+private:
+  /**
+   * Options and counters of the writing thread.
+   */
+  audio_file_sink_t sink;
+};
+
+#endif // FILEAUDIOHANDLER_H
@@ -0,0 +1,50 @@
+#include "HttpAudioHandler.h"
+#include "../exceptions.h"
+
+#include <string.h>
+
+HttpAudioHandler::HttpAudioHandler(HttpAudioOptions options) : AudioHandler(options) {
+  audio_output_options_t outputOptions;
+  memset(&outputOptions, 0, sizeof(outputOptions));
+  memset(&sink, 0, sizeof(sink));
+  sink.options.port = options.port;
+  sink.options.format = options.format;
+  sink.options.maxListeners = options.maxListeners;
+  sink.options.bufferSize = options.bufferSize;
+  int error = audio_http_listen(&sink);
+  if(error != 0) {
+    throw AudioHandlerCreationException(strerror(-error));
+  }
+  audio_init_http(&audioFifo, audioPool, &sink, &outputOptions);
+}
+
+HttpAudioHandler::~HttpAudioHandler() {
+  //Disconnects the listeners.
+  audio_stop_native(&audioFifo);
+  audio_http_close(&sink);
+}
+
+void HttpAudioHandler::afterMusicDelivery(const sp_audioformat* format) {
+  //The thread looks for audio on its own, it sleeps in poll and not on the queue.
+}
+
+void HttpAudioHandler::haltConsumer() {
+  audio_halt_native(&audioFifo);
+}
+
+void HttpAudioHandler::titleChanged(int epoch, const std::string& title) {
+  audio_http_set_title(&sink, epoch, title.c_str());
+}
+
+int HttpAudioHandler::getPort() {
+  return sink.port;
+}
+
+bool HttpAudioHandler::getHttpStats(audio_http_stats_t* stats) {
+  audio_http_get_stats(&sink, stats);
+  return true;
+}
+
+bool HttpAudioHandler::dataNeeded() {
+  return true;
+}
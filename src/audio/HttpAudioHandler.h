@@ -0,0 +1,48 @@
+#ifndef HTTPAUDIOHANDLER_H
+#define HTTPAUDIOHANDLER_H
+
+#include "AudioHandler.h"
+
+/**
+ * Options for the HTTP audio handler, set from spotify.useHttpAudio.
+ */
+struct HttpAudioOptions : public AudioHandlerOptions {
+  HttpAudioOptions() : port(0), format(AUDIO_FILE_WAV), maxListeners(32), bufferSize(AUDIO_HTTP_DEFAULT_BUFFER_SIZE) {}
+  /**
+   * Port on 127.0.0.1, 0 for any free one.
+   */
+  int port;
+  /**
+   * AUDIO_FILE_WAV or AUDIO_FILE_RAW.
+   */
+  int format;
+  int maxListeners;
+  /**
+   * Bytes of audio kept for the listeners, one that falls behind by more is disconnected.
+   */
+  int bufferSize;
+};
+
+/**
+ * @brief The HttpAudioHandler class
+ * Streams the audio over HTTP to the listeners on localhost from its own thread, in real time.
+ */
+class HttpAudioHandler : public AudioHandler {
+public:
+  /**
+   * Throws an AudioHandlerCreationException if the port could not be bound.
+   */
+  HttpAudioHandler(HttpAudioOptions options);
+  ~HttpAudioHandler();
+  int getPort();
+  bool getHttpStats(audio_http_stats_t* stats);
+protected:
+  void afterMusicDelivery(const sp_audioformat* format);
+  bool dataNeeded();
+  void haltConsumer();
+  void titleChanged(int epoch, const std::string& title);
+private:
+  audio_http_sink_t sink;
+};
+
+#endif // HTTPAUDIOHANDLER_H
@@ -1,7 +1,18 @@
 #include "NativeAudioHandler.h"
 
-NativeAudioHandler::NativeAudioHandler() {
-  audio_init_native(&audioFifo);
+#include <string.h>
+
+NativeAudioHandler::NativeAudioHandler(NativeAudioOptions options) : AudioHandler(options) {
+  audio_output_options_t outputOptions;
+  memset(&outputOptions, 0, sizeof(outputOptions));
+  strncpy(outputOptions.device, options.device.c_str(), AUDIO_DEVICE_NAME_LENGTH - 1);
+  outputOptions.periodSize = options.periodSize;
+  outputOptions.bufferSize = options.bufferSize;
+  outputOptions.schedPolicy = options.schedPolicy;
+  outputOptions.schedPriority = options.schedPriority;
+  outputOptions.cpuMask = options.cpuMask;
+  outputOptions.lockMemory = options.lockMemory;
+  audio_init_native(&audioFifo, audioPool, &outputOptions);
 }
 
 NativeAudioHandler::~NativeAudioHandler() {
@@ -9,7 +20,16 @@ NativeAudioHandler::~NativeAudioHandler() {
 }
 
 void NativeAudioHandler::afterMusicDelivery(const sp_audioformat *format) {
-  uv_cond_signal(&audioFifo.audioCondition);
+  audio_signal_native(&audioFifo);
+}
+
+void NativeAudioHandler::haltConsumer() {
+  audio_halt_native(&audioFifo);
+}
+
+bool NativeAudioHandler::getOutputStats(audio_output_stats_t* stats) {
+  audio_output_get_stats(&audioFifo, stats);
+  return true;
 }
 
 bool NativeAudioHandler::dataNeeded() {
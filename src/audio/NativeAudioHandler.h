@@ -3,17 +3,54 @@
 
 #include "AudioHandler.h"
 
+#include <string>
+
+/**
+ * Options for the native audio handler, set from the options object of spotify.useNativeAudio.
+ */
+struct NativeAudioOptions : public AudioHandlerOptions {
+  NativeAudioOptions() : periodSize(0), bufferSize(0), schedPolicy(AUDIO_SCHED_DEFAULT), schedPriority(0), cpuMask(0),
+    lockMemory(false) {}
+  /**
+   * Name of the output device, e.g. an ALSA PCM. Empty for the default device.
+   */
+  std::string device;
+  /**
+   * Frames the device plays between two wakeups of the audio thread, 0 for the default.
+   */
+  int periodSize;
+  /**
+   * Frames the device buffers, 0 for four periods.
+   */
+  int bufferSize;
+  /**
+   * AUDIO_SCHED_FIFO or AUDIO_SCHED_RR to run the audio thread with realtime priority schedPriority, if permitted.
+   */
+  int schedPolicy;
+  int schedPriority;
+  /**
+   * CPUs the audio thread may run on, one bit per CPU. 0 for all.
+   */
+  uint64_t cpuMask;
+  /**
+   * mlock the queue and the chunk pool.
+   */
+  bool lockMemory;
+};
+
 /**
  * @brief The NativeAudioHandler class
  * Handles audio in a native audio system like ALSA or OpenAL.
  */
 class NativeAudioHandler : public AudioHandler {
 public:
-  NativeAudioHandler();
+  NativeAudioHandler(NativeAudioOptions options = NativeAudioOptions());
   ~NativeAudioHandler();
+  bool getOutputStats(audio_output_stats_t* stats);
 protected:
   void afterMusicDelivery(const sp_audioformat* format);
   bool dataNeeded();
+  void haltConsumer();
 };
 
 #endif // NATIVEAUDIOHANDLER_H
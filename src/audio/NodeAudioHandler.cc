@@ -3,46 +3,222 @@
 #include "../Application.h"
 
 #include <node_buffer.h>
+#include <string.h>
 
 using namespace v8;
 
 extern Application* application;
 
-NodeAudioHandler::NodeAudioHandler(std::unique_ptr<NanCallback> _musicDeliveryCallback) :
-  AudioHandler(), musicDeliveryCallback(std::move(_musicDeliveryCallback)), needMoreData(true), stopped(false), musicTimerRepeat(20) {
-  uv_timer_init(uv_default_loop(), &musicTimer);
-  musicTimer.data = this;
-  uv_timer_start(&musicTimer, &musicTimeout, 0, musicTimerRepeat);
+std::map<int, NodeAudioHandler*> NodeAudioHandler::handlers;
+int NodeAudioHandler::nextId = 0;
+
+template <class T>
+static void closeHandle(uv_handle_t* handle) {
+  delete reinterpret_cast<T*>(handle);
+}
+
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+static void callReplacedReader(uv_timer_t* timer) {
+#else
+static void callReplacedReader(uv_timer_t* timer, int status) {
+#endif
+  NanScope();
+  std::unique_ptr<NanCallback> callback(static_cast<NanCallback*>(timer->data));
+  callback->Call(0, {});
+  uv_close(reinterpret_cast<uv_handle_t*>(timer), &closeHandle<uv_timer_t>);
+}
+
+NodeAudioHandler::NodeAudioHandler(std::unique_ptr<NanCallback> _musicDeliveryCallback, NodeAudioOptions _options) :
+  AudioHandler(_options), musicDeliveryCallback(std::move(_musicDeliveryCallback)), needMoreData(true), stopped(false),
+  readPending(false), options(_options), formatSampleRate(0), formatChannels(0), id(++nextId) {
+  handlers[id] = this;
+  musicNotify = new uv_async_t();
+  uv_async_init(uv_default_loop(), musicNotify, &musicAvailable);
+  musicNotify->data = this;
+  partialBufferTimer = new uv_timer_t();
+  uv_timer_init(uv_default_loop(), partialBufferTimer);
+  partialBufferTimer->data = this;
+
+  NanAssignPersistent(numberOfSamplesKey, NanNew<String>("numberOfSamples"));
+  NanAssignPersistent(sampleRateKey, NanNew<String>("sampleRate"));
+  NanAssignPersistent(channelsKey, NanNew<String>("channels"));
 }
 
 NodeAudioHandler::~NodeAudioHandler() {
-  uv_timer_stop(&musicTimer);
+  handlers.erase(id);
+  if(options.pull && readPending) {
+    //The reader waits to be called, on the next turn of the loop it reads once more and learns the handler is gone.
+    uv_timer_t* lastCall = new uv_timer_t();
+    uv_timer_init(uv_default_loop(), lastCall);
+    lastCall->data = musicDeliveryCallback.release();
+    uv_timer_start(lastCall, &callReplacedReader, 0, 0);
+  }
+  musicNotify->data = nullptr;
+  uv_close(reinterpret_cast<uv_handle_t*>(musicNotify), &closeHandle<uv_async_t>);
+  uv_timer_stop(partialBufferTimer);
+  uv_close(reinterpret_cast<uv_handle_t*>(partialBufferTimer), &closeHandle<uv_timer_t>);
+  NanDisposePersistent(numberOfSamplesKey);
+  NanDisposePersistent(sampleRateKey);
+  NanDisposePersistent(channelsKey);
+  NanDisposePersistent(format);
 }
 
 #if NODE_VERSION_AT_LEAST(0, 11, 0)
-void NodeAudioHandler::musicTimeout(uv_timer_t* timer) {
+void NodeAudioHandler::musicAvailable(uv_async_t* handle) {
 #else
-void NodeAudioHandler::musicTimeout(uv_timer_t* timer, int status) {
+void NodeAudioHandler::musicAvailable(uv_async_t* handle, int status) {
 #endif
-  NodeAudioHandler* audioHandler = static_cast<NodeAudioHandler*>(timer->data);
-  audio_fifo_t *audioFifo = &audioHandler->audioFifo;
+  NodeAudioHandler* audioHandler = static_cast<NodeAudioHandler*>(handle->data);
+  if(audioHandler != nullptr) {
+    audioHandler->deliverMusic(false);
+  }
+}
+
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+void NodeAudioHandler::partialBufferTimeout(uv_timer_t* timer) {
+#else
+void NodeAudioHandler::partialBufferTimeout(uv_timer_t* timer, int status) {
+#endif
+  static_cast<NodeAudioHandler*>(timer->data)->deliverMusic(true);
+}
+
+/**
+ * @brief NodeAudioHandler::deliverMusic Hand everything that is queued to JavaScript until it signals it
+ * does not want more. Sends coalesce, so one wakeup can cover many chunks.
+ * @param deliverPartial if buffers are coalesced, also deliver a buffer shorter than bufferDuration.
+ */
+void NodeAudioHandler::deliverMusic(bool deliverPartial) {
+  NanScope();
   audio_fifo_data_t* audioData;
+  if(options.pull) {
+    if(readPending && !stopped && audio_peek(&audioFifo) != nullptr) {
+      readPending = false;
+      musicDeliveryCallback->Call(0, {});
+    }
+    return;
+  }
+
+  if(options.bufferDuration <= 0) {
+    while( !stopped && needMoreData && (audioData = audio_get(&audioFifo)) ) {
+      // The audio data will be freed in a callback that is set up in callMusicDeliveryCallback.
+      needMoreData = callMusicDeliveryCallback(audioData);
+    }
+    return;
+  }
+
+  uv_timer_stop(partialBufferTimer);
+  while( !stopped && needMoreData && (audioData = audio_peek(&audioFifo)) ) {
+    int targetFrames = audioData->sampleRate * options.bufferDuration / 1000;
+    if(audio_fifo_samples(&audioFifo) < targetFrames && !deliverPartial) {
+      //Wait for more audio, but don't keep the end of a track forever.
+      uv_timer_start(partialBufferTimer, &partialBufferTimeout, options.bufferDuration, 0);
+      break;
+    }
+    needMoreData = callMusicDeliveryCallback(coalesce(targetFrames));
+  }
+}
+
+/**
+ * @brief NodeAudioHandler::coalesce Take chunks with the same format out of the queue until they contain at
+ * least targetFrames frames and copy them into one chunk.
+ */
+audio_fifo_data_t* NodeAudioHandler::coalesce(int targetFrames) {
+  audio_fifo_data_t* first = audio_get(&audioFifo);
+  audio_fifo_data_t* next;
+  int frames = first->numberOfSamples;
+  coalescedChunks.clear();
+  coalescedChunks.push_back(first);
+  while(frames < targetFrames && (next = audio_peek(&audioFifo)) && next->epoch == first->epoch &&
+    next->sampleRate == first->sampleRate && next->channels == first->channels) {
+    coalescedChunks.push_back(audio_get(&audioFifo));
+    frames += next->numberOfSamples;
+  }
+  if(coalescedChunks.size() == 1) {
+    return first;
+  }
 
-  if( !audioHandler->stopped && audioHandler->needMoreData && (audioData = audio_get(audioFifo)) ) {
-    // The audio data will be freed in a callback that is set up in this method.
-    audioHandler->needMoreData = audioHandler->callMusicDeliveryCallback(audioData);
+  size_t frameSize = sizeof(int16_t) * first->channels;
+  audio_fifo_data_t* coalesced = audio_data_alloc(audioPool, frames * frameSize);
+  coalesced->epoch = first->epoch;
+  coalesced->sampleRate = first->sampleRate;
+  coalesced->channels = first->channels;
+  coalesced->numberOfSamples = frames;
+  char* position = (char*)coalesced->samples;
+  for(audio_fifo_data_t* chunk : coalescedChunks) {
+    memcpy(position, chunk->samples, chunk->numberOfSamples * frameSize);
+    position += chunk->numberOfSamples * frameSize;
+    audio_data_free(chunk);
   }
+  return coalesced;
 }
 
 /**
- * @brief free_data Free the audio data after buffer initialization.
+ * @brief NodeAudioHandler::formatObject The format of coalesced buffers. The same object is handed out until
+ * the format changes.
+ */
+Handle<Object> NodeAudioHandler::formatObject(audio_fifo_data_t* audioData) {
+  if(format.IsEmpty() || formatSampleRate != audioData->sampleRate || formatChannels != audioData->channels) {
+    Local<Object> newFormat = NanNew<Object>();
+    newFormat->Set(NanNew(sampleRateKey), NanNew<Integer>(audioData->sampleRate));
+    newFormat->Set(NanNew(channelsKey), NanNew<Integer>(audioData->channels));
+    NanDisposePersistent(format);
+    NanAssignPersistent(format, newFormat);
+    formatSampleRate = audioData->sampleRate;
+    formatChannels = audioData->channels;
+  }
+  return NanNew(format);
+}
+
+/**
+ * @brief free_data Give the audio data back to the pool when the buffer is garbage collected.
  */
 static void free_data(char* data, void* hint) {
   audio_fifo_data_t* audioData = static_cast<audio_fifo_data_t*>(hint);
   assert((char*)audioData->samples == data);
-  free(audioData);
+  audio_data_free(audioData);
+}
+
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+static size_t floatArraySize(audio_fifo_data_t* audioData) {
+  return audioData->numberOfSamples * audioData->channels * sizeof(float);
 }
 
+/**
+ * @brief freeFloatArrayData Give the converted audio data back to the pool when the ArrayBuffer is garbage collected.
+ */
+NAN_WEAK_CALLBACK(freeFloatArrayData) {
+  audio_fifo_data_t* audioData = data.GetParameter();
+  NanAdjustExternalMemory(-(int)floatArraySize(audioData));
+  audio_data_free(audioData);
+}
+
+/**
+ * @brief NodeAudioHandler::createFloatArray Convert the audio data to floats in a new chunk and wrap that in a
+ * Float32Array without copying it again. The chunk holding the 16 bit samples is freed.
+ */
+Local<Object> NodeAudioHandler::createFloatArray(audio_fifo_data_t* audioData) {
+  int samples = audioData->numberOfSamples * audioData->channels;
+  audio_fifo_data_t* converted = audio_data_alloc(audioPool, samples * sizeof(float));
+  converted->epoch = audioData->epoch;
+  converted->sampleRate = audioData->sampleRate;
+  converted->channels = audioData->channels;
+  converted->numberOfSamples = audioData->numberOfSamples;
+  float* floats = reinterpret_cast<float*>(converted->samples);
+  if(options.sampleFormat == SAMPLE_FORMAT_F32_PLANAR) {
+    audio_dsp_to_float_planar(floats, audioData->samples, audioData->numberOfSamples, audioData->channels);
+  } else {
+    audio_dsp_to_float(floats, audioData->samples, samples);
+  }
+  audio_data_free(audioData);
+
+  size_t size = floatArraySize(converted);
+  Local<ArrayBuffer> arrayBuffer = ArrayBuffer::New(Isolate::GetCurrent(), floats, size);
+  NanMakeWeakPersistent(arrayBuffer, converted, &freeFloatArrayData);
+  NanAdjustExternalMemory(size);
+  return Float32Array::New(arrayBuffer, 0, samples);
+}
+#endif
+
 /**
  * @brief NodeAudioHandler::callMusicDeliveryCallback
  * Call the user provided JavaScript callback with the audio data.
@@ -50,12 +226,44 @@ static void free_data(char* data, void* hint) {
  * @return true if the callback needs more data.
  */
 bool NodeAudioHandler::callMusicDeliveryCallback(audio_fifo_data_t* audioData) {
-  static Local<String> numberOfSamplesKey = NanNew<String>("numberOfSamples");
-  static Local<String> sampleRateKey = NanNew<String>("sampleRate");
-  static Local<String> channelsKey = NanNew<String>("channels");
+  if(options.bufferDuration > 0) {
+    int argc = 3;
+    Handle<Value> argv[] = { NanUndefined(), createBuffer(audioData, false), formatObject(audioData) };
+    Handle<Value> bufferFilled = musicDeliveryCallback->Call(argc, argv);
+    return bufferFilled->ToBoolean()->BooleanValue();
+  }
+
+  int argc = 2;
+  Handle<Value> argv[] = { NanUndefined(), createBuffer(audioData, true) };
+  Handle<Value> bufferFilled = musicDeliveryCallback->Call(argc, argv);
+  return bufferFilled->ToBoolean()->BooleanValue();
+}
 
-  size_t size = audioData->numberOfSamples * sizeof(int16_t) * audioData->channels;
-  Local<Object> actualBuffer = NanNewBufferHandle((char*)audioData->samples, size, free_data, audioData);
+/**
+ * @brief NodeAudioHandler::createBuffer Wrap the audio data in a node.js Buffer without copying it, or in a
+ * Float32Array for the float sample formats.
+ * The volume is applied here and the audio counts as played once it is released to JavaScript. When the Buffer
+ * is collected says nothing about playback and what JavaScript buffers afterwards is up to it.
+ * @param withFormat set numberOfSamples, sampleRate and channels on the buffer.
+ */
+Handle<Object> NodeAudioHandler::createBuffer(audio_fifo_data_t* audioData, bool withFormat) {
+  audioData = audio_data_apply_gain(&audioFifo.gain, audioData);
+  audio_clock_advance(&audioFifo.clock, audioData->epoch, audioData->numberOfSamples, audioData->sampleRate);
+  int numberOfSamples = audioData->numberOfSamples;
+  int sampleRate = audioData->sampleRate;
+  int channels = audioData->channels;
+  Local<Object> actualBuffer;
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+  if(options.sampleFormat != SAMPLE_FORMAT_S16) {
+    actualBuffer = createFloatArray(audioData);
+  } else
+#endif
+  {
+    size_t size = numberOfSamples * sizeof(int16_t) * channels;
+    //JavaScript may write to the Buffer, other sinks must not hear that.
+    audioData = audio_data_unshare(audioData);
+    actualBuffer = NanNewBufferHandle((char*)audioData->samples, size, free_data, audioData);
+  }
   //node::Buffer *slowBuffer = node::Buffer::New((char*)audioData->samples, size, free_data, audioData);
 
   //Local<Object> globalObj = Context::GetCurrent()->Global();
@@ -63,17 +271,24 @@ bool NodeAudioHandler::callMusicDeliveryCallback(audio_fifo_data_t* audioData) {
   //Handle<Value> constructorArgs[3] = { slowBuffer->handle_, Integer::New(size), Integer::New(0)};
   //Handle<Object> actualBuffer = ctor->NewInstance(3, constructorArgs);
 
-  actualBuffer->Set(numberOfSamplesKey, NanNew<Integer>(audioData->numberOfSamples));
-  actualBuffer->Set(sampleRateKey, NanNew<Integer>(audioData->sampleRate));
-  actualBuffer->Set(channelsKey, NanNew<Integer>(audioData->channels));
+  if(withFormat) {
+    actualBuffer->Set(NanNew(numberOfSamplesKey), NanNew<Integer>(numberOfSamples));
+    actualBuffer->Set(NanNew(sampleRateKey), NanNew<Integer>(sampleRate));
+    actualBuffer->Set(NanNew(channelsKey), NanNew<Integer>(channels));
+  }
+  return actualBuffer;
+}
 
-  int argc = 2;
-  Handle<Value> argv[] = { NanUndefined(), actualBuffer };
-  Handle<Value> bufferFilled = musicDeliveryCallback->Call(argc, argv);
-  return bufferFilled->ToBoolean()->BooleanValue();
+/**
+ * @brief NodeAudioHandler::bytesPerSample Size of one sample in what JavaScript gets.
+ */
+size_t NodeAudioHandler::bytesPerSample() {
+  return options.sampleFormat == SAMPLE_FORMAT_S16 ? sizeof(int16_t) : sizeof(float);
 }
 
-void NodeAudioHandler::afterMusicDelivery(const sp_audioformat *format) { }
+void NodeAudioHandler::afterMusicDelivery(const sp_audioformat *format) {
+  uv_async_send(musicNotify);
+}
 
 bool NodeAudioHandler::dataNeeded() {
   return needMoreData;
@@ -81,16 +296,67 @@ bool NodeAudioHandler::dataNeeded() {
 
 void NodeAudioHandler::setStopped(bool _stopped) {
   stopped = _stopped;
+  if(stopped) {
+    uv_timer_stop(partialBufferTimer);
+  }
   AudioHandler::setStopped(_stopped);
 }
 
+void NodeAudioHandler::setDataNeeded(bool _needMoreData) {
+  needMoreData = _needMoreData;
+  if(needMoreData) {
+    //Deliver what has been queued in the meantime on the next loop iteration, not from within the JavaScript call.
+    uv_async_send(musicNotify);
+  }
+}
+
+int NodeAudioHandler::getId() {
+  return id;
+}
+
+NodeAudioHandler* NodeAudioHandler::fromId(Handle<Value> id) {
+  auto handler = handlers.find(id->Int32Value());
+  return handler != handlers.end() ? handler->second : nullptr;
+}
+
 NAN_METHOD(NodeAudioHandler::setNeedMoreData) {
   NanScope();
   if(args.Length() < 1 || !args[0]->IsBoolean()) {
     return NanThrowError("setNeedMoreData needs a boolean as its first argument.");
   }
-  NodeAudioHandler* audioHandler = static_cast<NodeAudioHandler*>(application->audioHandler.get());
+  NodeAudioHandler* audioHandler = fromId(args.Data());
+  if(audioHandler == nullptr) {
+    //The handler was replaced.
+    NanReturnUndefined();
+  }
   bool needMoreData = args[0]->ToBoolean()->BooleanValue();
-  audioHandler->needMoreData = needMoreData;
+  audioHandler->setDataNeeded(needMoreData);
   NanReturnUndefined();
 }
+
+/**
+ * Takes about the given number of bytes of queued audio in the sample format, in whole chunks, out of the queue.
+ * Returns null if there is nothing queued, the callback will then be called once audio arrives.
+ * Returns false once the handler was replaced, no more audio comes from it.
+ * Reading from an empty queue while playing counts as an underrun if the track goes on afterwards.
+ */
+NAN_METHOD(NodeAudioHandler::read) {
+  NanScope();
+  NodeAudioHandler* audioHandler = fromId(args.Data());
+  if(audioHandler == nullptr) {
+    NanReturnValue(NanFalse());
+  }
+  int maxBytes = args.Length() > 0 && args[0]->IsNumber() ? args[0]->ToInteger()->Value() : 0;
+  audio_fifo_data_t* audioData = audio_peek(&audioHandler->audioFifo);
+  if(audioHandler->stopped || audioData == nullptr) {
+    if(!audioHandler->stopped) {
+      //The reader wants audio now, if the track goes on this is an underrun.
+      audio_telemetry_starved(&audioHandler->audioFifo);
+    }
+    audioHandler->readPending = true;
+    NanReturnNull();
+  }
+  int maxFrames = maxBytes / (audioHandler->bytesPerSample() * audioData->channels);
+  audioData = audioHandler->coalesce(maxFrames);
+  NanReturnValue(audioHandler->createBuffer(audioData, true));
+}
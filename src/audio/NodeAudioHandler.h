@@ -5,34 +5,115 @@
 
 #include <nan.h>
 #include <uv.h>
+#include <map>
 #include <memory>
+#include <vector>
 
 #include <node_version.h>
 
+/**
+ * How samples are handed to JavaScript.
+ */
+enum NodeSampleFormat {
+  /**
+   * Interleaved 16 bit integers in a Buffer.
+   */
+  SAMPLE_FORMAT_S16,
+  /**
+   * Interleaved floats between -1 and 1 in a Float32Array.
+   */
+  SAMPLE_FORMAT_F32,
+  /**
+   * Floats in a Float32Array, all samples of the first channel, then all of the second and so on.
+   */
+  SAMPLE_FORMAT_F32_PLANAR
+};
+
+/**
+ * Options for the node.js audio handler, set from the second argument of spotify.useNodejsAudio.
+ */
+struct NodeAudioOptions : public AudioHandlerOptions {
+  NodeAudioOptions() : bufferDuration(0), pull(false), sampleFormat(SAMPLE_FORMAT_S16) {}
+  /**
+   * If > 0 consecutive chunks with the same format are merged into buffers of at least this many milliseconds.
+   * The callback then gets the format as a third argument instead of properties on every buffer.
+   */
+  int bufferDuration;
+  /**
+   * If true audio is not pushed to the callback but taken out of the queue with the read function returned by
+   * spotify.useNodejsAudio. The callback is called without arguments when audio arrives after read returned null,
+   * or when the handler is replaced while the reader waits. read returns false from then on.
+   */
+  bool pull;
+  NodeSampleFormat sampleFormat;
+};
+
 /**
  * @brief The NodeAudioHandler class
  * Handles audio data by calling a user provided Javascript callback with it.
  */
 class NodeAudioHandler : public AudioHandler {
 public:
-  NodeAudioHandler(std::unique_ptr<NanCallback> musicDeliveryCallback);
+  NodeAudioHandler(std::unique_ptr<NanCallback> musicDeliveryCallback, NodeAudioOptions options);
   ~NodeAudioHandler();
   void setStopped(bool stopped);
+  void setDataNeeded(bool needMoreData);
+  /**
+   * @brief getId Passed as data to setNeedMoreData and read, which may be called after the handler is gone.
+   */
+  int getId();
   static NAN_METHOD(setNeedMoreData);
+  static NAN_METHOD(read);
 protected:
   void afterMusicDelivery(const sp_audioformat* format);
   bool dataNeeded();
 private:
   std::unique_ptr<NanCallback> musicDeliveryCallback;
-  uv_timer_t musicTimer;
+  /**
+   * Signalled from the delivery thread when new audio is in the queue. Heap allocated because libuv
+   * needs it until the close callback ran, which can be after this handler is gone.
+   */
+  uv_async_t* musicNotify;
+  /**
+   * Runs while less than bufferDuration is queued, so the rest of a track still gets delivered.
+   */
+  uv_timer_t* partialBufferTimer;
   bool needMoreData;
   bool stopped;
-  int musicTimerRepeat;
+  /**
+   * A read in pull mode found the queue empty, the callback has to be notified when audio arrives.
+   */
+  bool readPending;
+  NodeAudioOptions options;
+  std::vector<audio_fifo_data_t*> coalescedChunks;
+  v8::Persistent<v8::String> numberOfSamplesKey;
+  v8::Persistent<v8::String> sampleRateKey;
+  v8::Persistent<v8::String> channelsKey;
+  v8::Persistent<v8::Object> format;
+  int formatSampleRate;
+  int formatChannels;
+  int id;
+  /**
+   * The handlers that exist by their id. Only used on the main thread.
+   */
+  static std::map<int, NodeAudioHandler*> handlers;
+  static int nextId;
+  static NodeAudioHandler* fromId(v8::Handle<v8::Value> id);
 #if NODE_VERSION_AT_LEAST(0, 11, 0) // TODO 11 or 12?
-  static void musicTimeout(uv_timer_t* timer);
+  static void musicAvailable(uv_async_t* handle);
+  static void partialBufferTimeout(uv_timer_t* timer);
 #else
-  static void musicTimeout(uv_timer_t* timer, int status);
+  static void musicAvailable(uv_async_t* handle, int status);
+  static void partialBufferTimeout(uv_timer_t* timer, int status);
+#endif
+  void deliverMusic(bool deliverPartial);
+  audio_fifo_data_t* coalesce(int targetFrames);
+  v8::Handle<v8::Object> formatObject(audio_fifo_data_t* audioData);
+  v8::Handle<v8::Object> createBuffer(audio_fifo_data_t* audioData, bool withFormat);
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+  v8::Local<v8::Object> createFloatArray(audio_fifo_data_t* audioData);
 #endif
+  size_t bytesPerSample();
   bool callMusicDeliveryCallback(audio_fifo_data_t* audioData);
 };
 
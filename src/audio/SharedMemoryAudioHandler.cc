@@ -0,0 +1,36 @@
+#include "SharedMemoryAudioHandler.h"
+#include "../exceptions.h"
+
+#include <string.h>
+
+SharedMemoryAudioHandler::SharedMemoryAudioHandler(SharedMemoryAudioOptions options) : AudioHandler(options) {
+  int error = audio_shm_open(&ring, options.name.empty() ? nullptr : options.name.c_str(), options.capacity);
+  if(error != 0) {
+    throw AudioHandlerCreationException(strerror(-error));
+  }
+}
+
+SharedMemoryAudioHandler::~SharedMemoryAudioHandler() {
+  audio_shm_close(&ring);
+}
+
+void SharedMemoryAudioHandler::afterMusicDelivery(const sp_audioformat* format) {
+  //Copying into the ring is cheap enough for libspotify's thread, a thread of its own would only add latency.
+  audio_shm_drain(&audioFifo, &ring);
+}
+
+bool SharedMemoryAudioHandler::dataNeeded() {
+  return true;
+}
+
+int SharedMemoryAudioHandler::getFd() {
+  return ring.fd;
+}
+
+const char* SharedMemoryAudioHandler::getName() {
+  return ring.name;
+}
+
+uint32_t SharedMemoryAudioHandler::getCapacity() {
+  return ring.capacity;
+}
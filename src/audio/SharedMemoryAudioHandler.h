@@ -0,0 +1,44 @@
+#ifndef SHAREDMEMORYAUDIOHANDLER_H
+#define SHAREDMEMORYAUDIOHANDLER_H
+
+#include "AudioHandler.h"
+
+#include <string>
+
+/**
+ * Options for the shared memory audio handler, set from spotify.useSharedMemoryAudio.
+ */
+struct SharedMemoryAudioOptions : public AudioHandlerOptions {
+  SharedMemoryAudioOptions() : capacity(AUDIO_SHM_DEFAULT_CAPACITY) {}
+  /**
+   * Name of a POSIX shared memory object like /spotify, empty for an anonymous memfd.
+   */
+  std::string name;
+  /**
+   * Bytes of audio in the ring, a power of two of at least 65536.
+   */
+  uint32_t capacity;
+};
+
+/**
+ * @brief The SharedMemoryAudioHandler class
+ * Writes the audio into a ring in shared memory for other processes, from libspotify's thread as it is delivered.
+ */
+class SharedMemoryAudioHandler : public AudioHandler {
+public:
+  /**
+   * Throws an AudioHandlerCreationException if the ring could not be created.
+   */
+  SharedMemoryAudioHandler(SharedMemoryAudioOptions options);
+  ~SharedMemoryAudioHandler();
+  int getFd();
+  const char* getName();
+  uint32_t getCapacity();
+protected:
+  void afterMusicDelivery(const sp_audioformat* format);
+  bool dataNeeded();
+private:
+  audio_shm_ring_t ring;
+};
+
+#endif // SHAREDMEMORYAUDIOHANDLER_H
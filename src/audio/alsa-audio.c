@@ -27,191 +27,279 @@
 
 #include <asoundlib.h>
 #include <errno.h>
-#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
-#include <sys/time.h>
 
 #include "audio.h"
 
-extern int audio_stopThread;
+/* A failed device is tried again at most this often */
+#define ALSA_RETRY_NS 1000000000ULL
 
-static snd_pcm_t *alsa_open(char *dev, int rate, int channels) {
-	snd_pcm_hw_params_t *hwp;
-	snd_pcm_sw_params_t *swp;
+typedef struct alsa_output {
 	snd_pcm_t *h;
-	int r;
-	int dir;
-	snd_pcm_uframes_t period_size_min;
-	snd_pcm_uframes_t period_size_max;
-	snd_pcm_uframes_t buffer_size_min;
-	snd_pcm_uframes_t buffer_size_max;
+	int rate;
+	int channels;
+	int mmap;
 	snd_pcm_uframes_t period_size;
 	snd_pcm_uframes_t buffer_size;
+	uint64_t failed_at;
+} alsa_output_t;
 
-	if ((r = snd_pcm_open(&h, dev, SND_PCM_STREAM_PLAYBACK, 0) < 0))
-		return NULL;
+static int alsa_configure(snd_pcm_t *h, alsa_output_t *out, const audio_output_options_t *options,
+                          snd_pcm_access_t access) {
+	snd_pcm_hw_params_t *hwp;
+	snd_pcm_sw_params_t *swp;
+	snd_pcm_uframes_t period_size;
+	snd_pcm_uframes_t buffer_size;
+	int dir = 0;
+	int r;
 
 	hwp = alloca(snd_pcm_hw_params_sizeof());
 	memset(hwp, 0, snd_pcm_hw_params_sizeof());
 	snd_pcm_hw_params_any(h, hwp);
 
-	snd_pcm_hw_params_set_access(h, hwp, SND_PCM_ACCESS_RW_INTERLEAVED);
-	snd_pcm_hw_params_set_format(h, hwp, SND_PCM_FORMAT_S16_LE);
-	snd_pcm_hw_params_set_rate(h, hwp, rate, 0);
-	snd_pcm_hw_params_set_channels(h, hwp, channels);
-
-	/* Configurue period */
-
-	dir = 0;
-	snd_pcm_hw_params_get_period_size_min(hwp, &period_size_min, &dir);
-	dir = 0;
-	snd_pcm_hw_params_get_period_size_max(hwp, &period_size_max, &dir);
-
-	period_size = 1024;
-
-	dir = 0;
-	r = snd_pcm_hw_params_set_period_size_near(h, hwp, &period_size, &dir);
-
-	if (r < 0) {
-		fprintf(stderr, "audio: Unable to set period size %lu (%s)\n",
-		        period_size, snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+	if ((r = snd_pcm_hw_params_set_access(h, hwp, access)) < 0 ||
+	    (r = snd_pcm_hw_params_set_format(h, hwp, SND_PCM_FORMAT_S16_LE)) < 0 ||
+	    (r = snd_pcm_hw_params_set_rate(h, hwp, out->rate, 0)) < 0 ||
+	    (r = snd_pcm_hw_params_set_channels(h, hwp, out->channels)) < 0) {
+		return r;
 	}
 
-	dir = 0;
-	r = snd_pcm_hw_params_get_period_size(hwp, &period_size, &dir);
-
-	if (r < 0) {
-		fprintf(stderr, "audio: Unable to get period size (%s)\n",
-		        snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+	/* Small periods wake the audio thread often for low latency, large ones save power */
+	period_size = options->periodSize > 0 ? options->periodSize : 1024;
+	if ((r = snd_pcm_hw_params_set_period_size_near(h, hwp, &period_size, &dir)) < 0) {
+		fprintf(stderr, "audio: Unable to set period size %lu (%s)\n", period_size, snd_strerror(r));
+		return r;
+	}
+	buffer_size = options->bufferSize > 0 ? options->bufferSize : period_size * 4;
+	if ((r = snd_pcm_hw_params_set_buffer_size_near(h, hwp, &buffer_size)) < 0) {
+		fprintf(stderr, "audio: Unable to set buffer size %lu (%s)\n", buffer_size, snd_strerror(r));
+		return r;
+	}
+	if ((r = snd_pcm_hw_params(h, hwp)) < 0) {
+		return r;
 	}
-
-	/* Configurue buffer size */
-
-	snd_pcm_hw_params_get_buffer_size_min(hwp, &buffer_size_min);
-	snd_pcm_hw_params_get_buffer_size_max(hwp, &buffer_size_max);
-	buffer_size = period_size * 4;
-
 	dir = 0;
-	r = snd_pcm_hw_params_set_buffer_size_near(h, hwp, &buffer_size);
+	snd_pcm_hw_params_get_period_size(hwp, &period_size, &dir);
+	snd_pcm_hw_params_get_buffer_size(hwp, &buffer_size);
 
-	if (r < 0) {
-		fprintf(stderr, "audio: Unable to set buffer size %lu (%s)\n",
-		        buffer_size, snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+	swp = alloca(snd_pcm_sw_params_sizeof());
+	memset(swp, 0, snd_pcm_sw_params_sizeof());
+	snd_pcm_sw_params_current(h, swp);
+	if ((r = snd_pcm_sw_params_set_avail_min(h, swp, period_size)) < 0) {
+		fprintf(stderr, "audio: Unable to configure wakeup threshold (%s)\n", snd_strerror(r));
+		return r;
 	}
-
-	r = snd_pcm_hw_params_get_buffer_size(hwp, &buffer_size);
-
-	if (r < 0) {
-		fprintf(stderr, "audio: Unable to get buffer size (%s)\n",
-		        snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+	/* Start as soon as a period is queued, not only once the whole buffer is full */
+	if ((r = snd_pcm_sw_params_set_start_threshold(h, swp, period_size)) < 0) {
+		fprintf(stderr, "audio: Unable to configure start threshold (%s)\n", snd_strerror(r));
+		return r;
 	}
-
-	/* write the hw params */
-	r = snd_pcm_hw_params(h, hwp);
-
-	if (r < 0) {
-		fprintf(stderr, "audio: Unable to configure hardware parameters (%s)\n",
-		        snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+	if ((r = snd_pcm_sw_params(h, swp)) < 0) {
+		fprintf(stderr, "audio: Cannot set soft parameters (%s)\n", snd_strerror(r));
+		return r;
+	}
+	if ((r = snd_pcm_prepare(h)) < 0) {
+		fprintf(stderr, "audio: Cannot prepare audio for playback (%s)\n", snd_strerror(r));
+		return r;
 	}
 
-	/*
-	 * Software parameters
-	 */
-
-	swp = alloca(snd_pcm_sw_params_sizeof());
-	memset(hwp, 0, snd_pcm_sw_params_sizeof());
-	snd_pcm_sw_params_current(h, swp);
+	out->mmap = access == SND_PCM_ACCESS_MMAP_INTERLEAVED;
+	out->period_size = period_size;
+	out->buffer_size = buffer_size;
+	return 0;
+}
 
-	r = snd_pcm_sw_params_set_avail_min(h, swp, period_size);
+/*
+ * Opens the device for mmap transfers, or for plain writes if it can't do mmap.
+ */
+static int alsa_open(alsa_output_t *out, const audio_output_options_t *options, int rate, int channels) {
+	const char *dev = options->device[0] ? options->device : "default";
+	int r;
 
-	if (r < 0) {
-		fprintf(stderr, "audio: Unable to configure wakeup threshold (%s)\n",
-		        snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+	out->rate = rate;
+	out->channels = channels;
+	if ((r = snd_pcm_open(&out->h, dev, SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+		fprintf(stderr, "audio: Unable to open ALSA device %s (%s)\n", dev, snd_strerror(r));
+		out->h = NULL;
+		return r;
 	}
-
-	snd_pcm_sw_params_set_start_threshold(h, swp, 0);
-
-	if (r < 0) {
-		fprintf(stderr, "audio: Unable to configure start threshold (%s)\n",
-		        snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+	if ((r = alsa_configure(out->h, out, options, SND_PCM_ACCESS_MMAP_INTERLEAVED)) < 0 &&
+	    (r = alsa_configure(out->h, out, options, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+		fprintf(stderr, "audio: Unable to configure ALSA device %s for %d channels, %d Hz (%s)\n",
+		        dev, channels, rate, snd_strerror(r));
+		snd_pcm_close(out->h);
+		out->h = NULL;
 	}
+	return r;
+}
 
-	r = snd_pcm_sw_params(h, swp);
-
-	if (r < 0) {
-		fprintf(stderr, "audio: Cannot set soft parameters (%s)\n",
-		snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+static void alsa_close(alsa_output_t *out) {
+	if (out->h) {
+		snd_pcm_drop(out->h);
+		snd_pcm_close(out->h);
+		out->h = NULL;
 	}
+}
 
-	r = snd_pcm_prepare(h);
-	if (r < 0) {
-		fprintf(stderr, "audio: Cannot prepare audio for playback (%s)\n",
-		snd_strerror(r));
-		snd_pcm_close(h);
-		return NULL;
+/*
+ * Gets the device going again after an underrun or a suspend. An underrun only counts as an xrun if there was
+ * audio to play, the device running dry because the queue was empty (a pause, the end of the music) is expected.
+ */
+static int alsa_recover(alsa_output_t *out, audio_fifo_t *audioFifo, int err, int idle) {
+	if (err == -EPIPE && !idle) {
+		__atomic_fetch_add(&audioFifo->outputStats.xruns, 1, __ATOMIC_RELAXED);
 	}
+	return snd_pcm_recover(out->h, err, 1);
+}
+
+/*
+ * Writes all frames, copying them straight into the device buffer with mmap. Returns 0 or a negative error code
+ * if the device is broken.
+ */
+static int alsa_write(alsa_output_t *out, audio_fifo_t *audioFifo, const int16_t *samples, int frames, int idle) {
+	snd_pcm_sframes_t r;
+	size_t frame_bytes = out->channels * sizeof(int16_t);
+
+	/* A halt lets the chunk finish, the queue behind it goes to another handler */
+	while (frames > 0 && __atomic_load_n(&audioFifo->stopThread, __ATOMIC_RELAXED) != AUDIO_THREAD_STOP) {
+		if (!out->mmap) {
+			r = snd_pcm_writei(out->h, samples, frames);
+			if (r == -EAGAIN)
+				continue;
+			if (r < 0) {
+				if ((r = alsa_recover(out, audioFifo, r, idle)) < 0)
+					return r;
+				continue;
+			}
+		} else {
+			const snd_pcm_channel_area_t *areas;
+			snd_pcm_uframes_t offset;
+			snd_pcm_uframes_t n;
+			snd_pcm_sframes_t avail = snd_pcm_avail_update(out->h);
+
+			if (avail < 0) {
+				if ((r = alsa_recover(out, audioFifo, avail, idle)) < 0)
+					return r;
+				continue;
+			}
+			if ((snd_pcm_uframes_t)avail < out->period_size && avail < frames) {
+				/* The buffer is full. If it never started, e.g. the first chunk was short, start it now */
+				if (snd_pcm_state(out->h) == SND_PCM_STATE_PREPARED)
+					snd_pcm_start(out->h);
+				if ((r = snd_pcm_wait(out->h, 1000)) < 0 && (r = alsa_recover(out, audioFifo, r, idle)) < 0)
+					return r;
+				continue;
+			}
 
-	return h;
+			n = avail < frames ? avail : frames;
+			if ((r = snd_pcm_mmap_begin(out->h, &areas, &offset, &n)) < 0) {
+				if ((r = alsa_recover(out, audioFifo, r, idle)) < 0)
+					return r;
+				continue;
+			}
+			/* Interleaved, so all channels are in the first area */
+			memcpy((char *)areas[0].addr + areas[0].first / 8 + offset * (areas[0].step / 8), samples,
+			       n * frame_bytes);
+			r = snd_pcm_mmap_commit(out->h, offset, n);
+			if (r < 0 || (snd_pcm_uframes_t)r != n) {
+				if ((r = alsa_recover(out, audioFifo, r >= 0 ? -EPIPE : r, idle)) < 0)
+					return r;
+				continue;
+			}
+		}
+		samples += r * out->channels;
+		frames -= r;
+		idle = 0;
+	}
+	return 0;
 }
 
 void audio_start(void *aux)
 {
 	audio_fifo_t *audioFifo = aux;
-	snd_pcm_t *h = NULL;
-	int c;
-	int cur_channels = 0;
-	int cur_rate = 0;
+	const audio_output_options_t *options = &audioFifo->outputOptions;
+	alsa_output_t out;
+	int epoch = -1;
+	int idle;
+	snd_pcm_sframes_t written = 0;
+	snd_pcm_sframes_t played = 0;
+	snd_pcm_sframes_t delay;
 
 	audio_fifo_data_t *audioData;
 
-    for (;!audio_stopThread;) {
-        audioData = audio_get_native(audioFifo);
-        if(audioData == NULL) {
-            break;
-        }
-
-		if (!h || cur_rate != audioData->sampleRate || cur_channels != audioData->channels) {
-			if (h) snd_pcm_close(h);
-
-			cur_rate = audioData->sampleRate;
-			cur_channels = audioData->channels;
-
-			h = alsa_open("default", cur_rate, cur_channels);
+	memset(&out, 0, sizeof(out));
+	/* The device buffer adds to the latency, snd_pcm_delay knows how much */
+	__atomic_store_n(&audioFifo->telemetry.sinkMeasuresLatency, 1, __ATOMIC_RELAXED);
+	for (;!audioFifo->stopThread;) {
+		idle = audio_fifo_samples(audioFifo) == 0;
+		audioData = audio_get_native(audioFifo);
+		if(audioData == NULL) {
+			break;
+		}
 
-			if (!h) {
-				fprintf(stderr, "Unable to open ALSA device (%d channels, %d Hz), dying\n",
-				        cur_channels, cur_rate);
-				exit(1);
+		/* Only reopen when the format changes, or to retry a device that failed */
+		if (out.h && (out.rate != audioData->sampleRate || out.channels != audioData->channels)) {
+			snd_pcm_drain(out.h);
+			alsa_close(&out);
+		}
+		if (!out.h && (out.failed_at == 0 || uv_hrtime() - out.failed_at >= ALSA_RETRY_NS)) {
+			if (alsa_open(&out, options, audioData->sampleRate, audioData->channels) < 0) {
+				out.failed_at = uv_hrtime();
+				__atomic_fetch_add(&audioFifo->outputStats.openFailures, 1, __ATOMIC_RELAXED);
+			} else {
+				out.failed_at = 0;
+				__atomic_store_n(&audioFifo->outputStats.periodSize, (int)out.period_size, __ATOMIC_RELAXED);
+				__atomic_store_n(&audioFifo->outputStats.bufferSize, (int)out.buffer_size, __ATOMIC_RELAXED);
+				__atomic_store_n(&audioFifo->outputStats.mmap, out.mmap, __ATOMIC_RELAXED);
 			}
+			written = 0;
+			played = 0;
 		}
 
-		c = snd_pcm_wait(h, 1000);
-
-		if (c >= 0)
-			c = snd_pcm_avail_update(h);
+		if (audioData->epoch != epoch) {
+			epoch = audioData->epoch;
+			written = 0;
+			played = 0;
+		}
 
-		if (c == -EPIPE)
-			snd_pcm_prepare(h);
+		if (!out.h) {
+			/* Without a device drop the audio in real time, so the track still plays to its end */
+			usleep((useconds_t)((int64_t)audioData->numberOfSamples * 1000000 / audioData->sampleRate));
+			audio_clock_advance(&audioFifo->clock, epoch, audioData->numberOfSamples, audioData->sampleRate);
+			audio_telemetry_dropped(audioFifo, audioData->numberOfSamples);
+			audio_data_free(audioData);
+			continue;
+		}
 
-		snd_pcm_writei(h, audioData->samples, audioData->numberOfSamples);
-		free(audioData);
+		if (alsa_write(&out, audioFifo, audioData->samples, audioData->numberOfSamples, idle) < 0) {
+			fprintf(stderr, "audio: ALSA device failed, reopening it\n");
+			alsa_close(&out);
+			out.failed_at = uv_hrtime();
+			audio_telemetry_dropped(audioFifo, audioData->numberOfSamples);
+			audio_data_free(audioData);
+			continue;
+		}
+		written += audioData->numberOfSamples;
+
+		/* Whatever is still in the device buffer has not been played yet.
+		   Frames of the last epoch come first, so the count stays at 0 until they are out. */
+		if (snd_pcm_delay(out.h, &delay) == 0) {
+			if (written - delay > played) {
+				audio_clock_advance(&audioFifo->clock, epoch, written - delay - played, out.rate);
+				played = written - delay;
+			}
+			/* The last frame of the chunk is played once the delay has passed */
+			audio_telemetry_latency(audioFifo, (int64_t)(uv_hrtime() - audioData->deliveredAt) / 1000 +
+				(int64_t)delay * 1000000 / out.rate);
+		}
+		audio_data_free(audioData);
+	}
+	if (out.h && audioFifo->stopThread == AUDIO_THREAD_HALT) {
+		/* Play out the device buffer before another handler takes over */
+		snd_pcm_drain(out.h);
 	}
+	alsa_close(&out);
 }
@@ -0,0 +1,477 @@
+#include "audio.h"
+
+#include <stddef.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AUDIO_DSP_X86
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIO_DSP_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*audio_dsp_mix_fn)(int16_t* dst, const int16_t* a, const int16_t* gainA, const int16_t* b,
+  const int16_t* gainB, int samples);
+typedef void (*audio_dsp_gain_fn)(int16_t* dst, const int16_t* src, int16_t gain, int samples);
+typedef void (*audio_dsp_to_float_fn)(float* dst, const int16_t* src, int samples);
+typedef void (*audio_dsp_to_float_stereo_fn)(float* left, float* right, const int16_t* src, int frames);
+typedef void (*audio_dsp_fir2_fn)(const float* filter, const float* a, const float* b, int taps, float* outA,
+  float* outB);
+
+#define AUDIO_DSP_FLOAT_SCALE (1.0f / 32768)
+
+static int16_t audio_dsp_saturate(int32_t value) {
+  return value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : (int16_t)value);
+}
+
+static void audio_dsp_mix_scalar(int16_t* dst, const int16_t* a, const int16_t* gainA, const int16_t* b,
+  const int16_t* gainB, int samples) {
+  int i;
+  for(i = 0; i < samples; i++) {
+    int32_t mixed = (int32_t)a[i] * gainA[i] + (int32_t)b[i] * gainB[i];
+    dst[i] = audio_dsp_saturate((mixed + (1 << 14)) >> 15);
+  }
+}
+
+static void audio_dsp_gain_scalar(int16_t* dst, const int16_t* src, int16_t gain, int samples) {
+  int i;
+  for(i = 0; i < samples; i++) {
+    dst[i] = audio_dsp_saturate(((int32_t)src[i] * gain + (1 << 14)) >> 15);
+  }
+}
+
+static void audio_dsp_to_float_scalar(float* dst, const int16_t* src, int samples) {
+  int i;
+  for(i = 0; i < samples; i++) {
+    dst[i] = src[i] * AUDIO_DSP_FLOAT_SCALE;
+  }
+}
+
+static void audio_dsp_to_float_stereo_scalar(float* left, float* right, const int16_t* src, int frames) {
+  int i;
+  for(i = 0; i < frames; i++) {
+    left[i] = src[i * 2] * AUDIO_DSP_FLOAT_SCALE;
+    right[i] = src[i * 2 + 1] * AUDIO_DSP_FLOAT_SCALE;
+  }
+}
+
+static void audio_dsp_fir2_scalar(const float* filter, const float* a, const float* b, int taps, float* outA,
+  float* outB) {
+  float sumA = 0, sumB = 0;
+  int i;
+  for(i = 0; i < taps; i++) {
+    sumA += filter[i] * a[i];
+    sumB += filter[i] * b[i];
+  }
+  *outA = sumA;
+  *outB = sumB;
+}
+
+#if defined(AUDIO_DSP_X86) && defined(__SSE2__)
+/**
+Interleaves the samples of both streams and their gains, so one pmaddwd gives a * gainA + b * gainB per sample.
+**/
+static void audio_dsp_mix_sse2(int16_t* dst, const int16_t* a, const int16_t* gainA, const int16_t* b,
+  const int16_t* gainB, int samples) {
+  const __m128i round = _mm_set1_epi32(1 << 14);
+  int i;
+  for(i = 0; i + 8 <= samples; i += 8) {
+    __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+    __m128i ga = _mm_loadu_si128((const __m128i*)(gainA + i));
+    __m128i gb = _mm_loadu_si128((const __m128i*)(gainB + i));
+    __m128i low = _mm_madd_epi16(_mm_unpacklo_epi16(va, vb), _mm_unpacklo_epi16(ga, gb));
+    __m128i high = _mm_madd_epi16(_mm_unpackhi_epi16(va, vb), _mm_unpackhi_epi16(ga, gb));
+    low = _mm_srai_epi32(_mm_add_epi32(low, round), 15);
+    high = _mm_srai_epi32(_mm_add_epi32(high, round), 15);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(low, high));
+  }
+  audio_dsp_mix_scalar(dst + i, a + i, gainA + i, b + i, gainB + i, samples - i);
+}
+
+/**
+SSE2 has no rounding multiply high, so the rounding constant goes through pmaddwd as sample 1 times 1 << 14.
+**/
+static void audio_dsp_gain_sse2(int16_t* dst, const int16_t* src, int16_t gain, int samples) {
+  const __m128i gains = _mm_set1_epi32((1 << 30) | (uint16_t)gain);
+  const __m128i one = _mm_set1_epi16(1);
+  int i;
+  for(i = 0; i + 8 <= samples; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i low = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(v, one), gains), 15);
+    __m128i high = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(v, one), gains), 15);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(low, high));
+  }
+  audio_dsp_gain_scalar(dst + i, src + i, gain, samples - i);
+}
+
+/**
+Sign extends by unpacking the samples into the high halves of 32 bit lanes and shifting them back down.
+**/
+static void audio_dsp_to_float_sse2(float* dst, const int16_t* src, int samples) {
+  const __m128 scale = _mm_set1_ps(AUDIO_DSP_FLOAT_SCALE);
+  int i;
+  for(i = 0; i + 8 <= samples; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+  }
+  audio_dsp_to_float_scalar(dst + i, src + i, samples - i);
+}
+
+/**
+A stereo frame is one 32 bit lane, the right sample is its high half and the left one its low half.
+**/
+static void audio_dsp_to_float_stereo_sse2(float* left, float* right, const int16_t* src, int frames) {
+  const __m128 scale = _mm_set1_ps(AUDIO_DSP_FLOAT_SCALE);
+  int i;
+  for(i = 0; i + 4 <= frames; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 2));
+    __m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    __m128i r = _mm_srai_epi32(v, 16);
+    _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+    _mm_storeu_ps(right + i, _mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+  }
+  audio_dsp_to_float_stereo_scalar(left + i, right + i, src + i * 2, frames - i);
+}
+
+static float audio_dsp_sum_sse2(__m128 v) {
+  __m128 sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+}
+
+static void audio_dsp_fir2_sse2(const float* filter, const float* a, const float* b, int taps, float* outA,
+  float* outB) {
+  __m128 sumA = _mm_setzero_ps();
+  __m128 sumB = _mm_setzero_ps();
+  float restA, restB;
+  int i;
+  for(i = 0; i + 4 <= taps; i += 4) {
+    __m128 h = _mm_loadu_ps(filter + i);
+    sumA = _mm_add_ps(sumA, _mm_mul_ps(h, _mm_loadu_ps(a + i)));
+    sumB = _mm_add_ps(sumB, _mm_mul_ps(h, _mm_loadu_ps(b + i)));
+  }
+  audio_dsp_fir2_scalar(filter + i, a + i, b + i, taps - i, &restA, &restB);
+  *outA = audio_dsp_sum_sse2(sumA) + restA;
+  *outB = audio_dsp_sum_sse2(sumB) + restB;
+}
+#endif
+
+#ifdef AUDIO_DSP_X86
+/**
+Same as SSE2. Unpack and pack both work within 128 bit lanes, so the samples come out in order.
+**/
+__attribute__((target("avx2")))
+static void audio_dsp_mix_avx2(int16_t* dst, const int16_t* a, const int16_t* gainA, const int16_t* b,
+  const int16_t* gainB, int samples) {
+  const __m256i round = _mm256_set1_epi32(1 << 14);
+  int i;
+  for(i = 0; i + 16 <= samples; i += 16) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+    __m256i ga = _mm256_loadu_si256((const __m256i*)(gainA + i));
+    __m256i gb = _mm256_loadu_si256((const __m256i*)(gainB + i));
+    __m256i low = _mm256_madd_epi16(_mm256_unpacklo_epi16(va, vb), _mm256_unpacklo_epi16(ga, gb));
+    __m256i high = _mm256_madd_epi16(_mm256_unpackhi_epi16(va, vb), _mm256_unpackhi_epi16(ga, gb));
+    low = _mm256_srai_epi32(_mm256_add_epi32(low, round), 15);
+    high = _mm256_srai_epi32(_mm256_add_epi32(high, round), 15);
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packs_epi32(low, high));
+  }
+  audio_dsp_mix_scalar(dst + i, a + i, gainA + i, b + i, gainB + i, samples - i);
+}
+
+/**
+pmulhrsw is exactly a Q15 multiply with rounding. It only overflows for -32768 * -32768, gains are never negative.
+**/
+__attribute__((target("avx2")))
+static void audio_dsp_gain_avx2(int16_t* dst, const int16_t* src, int16_t gain, int samples) {
+  const __m256i gains = _mm256_set1_epi16(gain);
+  int i;
+  for(i = 0; i + 16 <= samples; i += 16) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_mulhrs_epi16(v, gains));
+  }
+  audio_dsp_gain_scalar(dst + i, src + i, gain, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void audio_dsp_to_float_avx2(float* dst, const int16_t* src, int samples) {
+  const __m256 scale = _mm256_set1_ps(AUDIO_DSP_FLOAT_SCALE);
+  int i;
+  for(i = 0; i + 16 <= samples; i += 16) {
+    __m256i low = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+    __m256i high = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + i + 8)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+    _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+  }
+  audio_dsp_to_float_scalar(dst + i, src + i, samples - i);
+}
+
+__attribute__((target("avx2")))
+static void audio_dsp_to_float_stereo_avx2(float* left, float* right, const int16_t* src, int frames) {
+  const __m256 scale = _mm256_set1_ps(AUDIO_DSP_FLOAT_SCALE);
+  int i;
+  for(i = 0; i + 8 <= frames; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 2));
+    __m256i l = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+    __m256i r = _mm256_srai_epi32(v, 16);
+    _mm256_storeu_ps(left + i, _mm256_mul_ps(_mm256_cvtepi32_ps(l), scale));
+    _mm256_storeu_ps(right + i, _mm256_mul_ps(_mm256_cvtepi32_ps(r), scale));
+  }
+  audio_dsp_to_float_stereo_scalar(left + i, right + i, src + i * 2, frames - i);
+}
+
+__attribute__((target("avx2,fma")))
+static float audio_dsp_sum_avx2(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+}
+
+__attribute__((target("avx2,fma")))
+static void audio_dsp_fir2_avx2(const float* filter, const float* a, const float* b, int taps, float* outA,
+  float* outB) {
+  __m256 sumA = _mm256_setzero_ps();
+  __m256 sumB = _mm256_setzero_ps();
+  float restA, restB;
+  int i;
+  for(i = 0; i + 8 <= taps; i += 8) {
+    __m256 h = _mm256_loadu_ps(filter + i);
+    sumA = _mm256_fmadd_ps(h, _mm256_loadu_ps(a + i), sumA);
+    sumB = _mm256_fmadd_ps(h, _mm256_loadu_ps(b + i), sumB);
+  }
+  audio_dsp_fir2_scalar(filter + i, a + i, b + i, taps - i, &restA, &restB);
+  *outA = audio_dsp_sum_avx2(sumA) + restA;
+  *outB = audio_dsp_sum_avx2(sumB) + restB;
+}
+#endif
+
+#ifdef AUDIO_DSP_NEON
+static void audio_dsp_mix_neon(int16_t* dst, const int16_t* a, const int16_t* gainA, const int16_t* b,
+  const int16_t* gainB, int samples) {
+  int i;
+  for(i = 0; i + 4 <= samples; i += 4) {
+    int32x4_t mixed = vmull_s16(vld1_s16(a + i), vld1_s16(gainA + i));
+    mixed = vmlal_s16(mixed, vld1_s16(b + i), vld1_s16(gainB + i));
+    vst1_s16(dst + i, vqrshrn_n_s32(mixed, 15));
+  }
+  audio_dsp_mix_scalar(dst + i, a + i, gainA + i, b + i, gainB + i, samples - i);
+}
+
+/**
+vqrdmulh doubles, rounds and saturates, which is a Q15 multiply.
+**/
+static void audio_dsp_gain_neon(int16_t* dst, const int16_t* src, int16_t gain, int samples) {
+  int i;
+  for(i = 0; i + 8 <= samples; i += 8) {
+    vst1q_s16(dst + i, vqrdmulhq_n_s16(vld1q_s16(src + i), gain));
+  }
+  audio_dsp_gain_scalar(dst + i, src + i, gain, samples - i);
+}
+
+static void audio_dsp_to_float_neon(float* dst, const int16_t* src, int samples) {
+  int i;
+  for(i = 0; i + 4 <= samples; i += 4) {
+    vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(src + i))), AUDIO_DSP_FLOAT_SCALE));
+  }
+  audio_dsp_to_float_scalar(dst + i, src + i, samples - i);
+}
+
+/**
+vld2 deinterleaves while loading.
+**/
+static void audio_dsp_to_float_stereo_neon(float* left, float* right, const int16_t* src, int frames) {
+  int i;
+  for(i = 0; i + 4 <= frames; i += 4) {
+    int16x4x2_t v = vld2_s16(src + i * 2);
+    vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(v.val[0])), AUDIO_DSP_FLOAT_SCALE));
+    vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(v.val[1])), AUDIO_DSP_FLOAT_SCALE));
+  }
+  audio_dsp_to_float_stereo_scalar(left + i, right + i, src + i * 2, frames - i);
+}
+
+static void audio_dsp_fir2_neon(const float* filter, const float* a, const float* b, int taps, float* outA,
+  float* outB) {
+  float32x4_t sumA = vdupq_n_f32(0);
+  float32x4_t sumB = vdupq_n_f32(0);
+  float32x2_t pairA, pairB;
+  float restA, restB;
+  int i;
+  for(i = 0; i + 4 <= taps; i += 4) {
+    float32x4_t h = vld1q_f32(filter + i);
+    sumA = vmlaq_f32(sumA, h, vld1q_f32(a + i));
+    sumB = vmlaq_f32(sumB, h, vld1q_f32(b + i));
+  }
+  audio_dsp_fir2_scalar(filter + i, a + i, b + i, taps - i, &restA, &restB);
+  pairA = vadd_f32(vget_low_f32(sumA), vget_high_f32(sumA));
+  pairB = vadd_f32(vget_low_f32(sumB), vget_high_f32(sumB));
+  *outA = vget_lane_f32(vpadd_f32(pairA, pairA), 0) + restA;
+  *outB = vget_lane_f32(vpadd_f32(pairB, pairB), 0) + restB;
+}
+#endif
+
+static audio_dsp_mix_fn audio_dsp_mix_impl;
+static audio_dsp_gain_fn audio_dsp_gain_impl;
+static audio_dsp_to_float_fn audio_dsp_to_float_impl;
+static audio_dsp_to_float_stereo_fn audio_dsp_to_float_stereo_impl;
+static audio_dsp_fir2_fn audio_dsp_fir2_impl;
+static const char* audio_dsp_impl_name;
+
+/**
+Picks the widest implementation the CPU supports. Every thread picks the same, so a race on the first call is harmless.
+**/
+static void audio_dsp_select(void) {
+  audio_dsp_mix_fn mix = audio_dsp_mix_scalar;
+  audio_dsp_gain_fn gain = audio_dsp_gain_scalar;
+  audio_dsp_to_float_fn toFloat = audio_dsp_to_float_scalar;
+  audio_dsp_to_float_stereo_fn toFloatStereo = audio_dsp_to_float_stereo_scalar;
+  audio_dsp_fir2_fn fir2 = audio_dsp_fir2_scalar;
+  const char* name = "scalar";
+#if defined(AUDIO_DSP_X86) && defined(__SSE2__)
+  mix = audio_dsp_mix_sse2;
+  gain = audio_dsp_gain_sse2;
+  toFloat = audio_dsp_to_float_sse2;
+  toFloatStereo = audio_dsp_to_float_stereo_sse2;
+  fir2 = audio_dsp_fir2_sse2;
+  name = "sse2";
+#endif
+#ifdef AUDIO_DSP_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    mix = audio_dsp_mix_avx2;
+    gain = audio_dsp_gain_avx2;
+    toFloat = audio_dsp_to_float_avx2;
+    toFloatStereo = audio_dsp_to_float_stereo_avx2;
+    name = "avx2";
+  }
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    fir2 = audio_dsp_fir2_avx2;
+  }
+#endif
+#ifdef AUDIO_DSP_NEON
+  mix = audio_dsp_mix_neon;
+  gain = audio_dsp_gain_neon;
+  toFloat = audio_dsp_to_float_neon;
+  toFloatStereo = audio_dsp_to_float_stereo_neon;
+  fir2 = audio_dsp_fir2_neon;
+  name = "neon";
+#endif
+  __atomic_store_n(&audio_dsp_impl_name, name, __ATOMIC_RELAXED);
+  __atomic_store_n(&audio_dsp_gain_impl, gain, __ATOMIC_RELAXED);
+  __atomic_store_n(&audio_dsp_to_float_impl, toFloat, __ATOMIC_RELAXED);
+  __atomic_store_n(&audio_dsp_to_float_stereo_impl, toFloatStereo, __ATOMIC_RELAXED);
+  __atomic_store_n(&audio_dsp_fir2_impl, fir2, __ATOMIC_RELAXED);
+  __atomic_store_n(&audio_dsp_mix_impl, mix, __ATOMIC_RELEASE);
+}
+
+void audio_dsp_mix(int16_t* dst, const int16_t* a, const int16_t* gainA, const int16_t* b, const int16_t* gainB,
+  int samples) {
+  audio_dsp_mix_fn mix = __atomic_load_n(&audio_dsp_mix_impl, __ATOMIC_ACQUIRE);
+  if(mix == NULL) {
+    audio_dsp_select();
+    mix = __atomic_load_n(&audio_dsp_mix_impl, __ATOMIC_ACQUIRE);
+  }
+  mix(dst, a, gainA, b, gainB, samples);
+}
+
+void audio_dsp_gain(int16_t* dst, const int16_t* src, int16_t gain, int samples) {
+  if(__atomic_load_n(&audio_dsp_mix_impl, __ATOMIC_ACQUIRE) == NULL) {
+    audio_dsp_select();
+  }
+  __atomic_load_n(&audio_dsp_gain_impl, __ATOMIC_RELAXED)(dst, src, gain, samples);
+}
+
+void audio_dsp_to_float(float* dst, const int16_t* src, int samples) {
+  if(__atomic_load_n(&audio_dsp_mix_impl, __ATOMIC_ACQUIRE) == NULL) {
+    audio_dsp_select();
+  }
+  __atomic_load_n(&audio_dsp_to_float_impl, __ATOMIC_RELAXED)(dst, src, samples);
+}
+
+void audio_dsp_to_float_stereo(float* left, float* right, const int16_t* src, int frames) {
+  if(__atomic_load_n(&audio_dsp_mix_impl, __ATOMIC_ACQUIRE) == NULL) {
+    audio_dsp_select();
+  }
+  __atomic_load_n(&audio_dsp_to_float_stereo_impl, __ATOMIC_RELAXED)(left, right, src, frames);
+}
+
+void audio_dsp_to_float_planar(float* dst, const int16_t* src, int frames, int channels) {
+  int i, c;
+  if(channels == 1) {
+    audio_dsp_to_float(dst, src, frames);
+    return;
+  }
+  if(channels == 2) {
+    audio_dsp_to_float_stereo(dst, dst + frames, src, frames);
+    return;
+  }
+  for(c = 0; c < channels; c++) {
+    for(i = 0; i < frames; i++) {
+      dst[c * frames + i] = src[i * channels + c] * AUDIO_DSP_FLOAT_SCALE;
+    }
+  }
+}
+
+void audio_dsp_fir2(const float* filter, const float* a, const float* b, int taps, float* outA, float* outB) {
+  if(__atomic_load_n(&audio_dsp_mix_impl, __ATOMIC_ACQUIRE) == NULL) {
+    audio_dsp_select();
+  }
+  __atomic_load_n(&audio_dsp_fir2_impl, __ATOMIC_RELAXED)(filter, a, b, taps, outA, outB);
+}
+
+void audio_gain_init(audio_gain_t* gain) {
+  gain->target = AUDIO_GAIN_UNITY;
+  gain->current = AUDIO_GAIN_UNITY;
+  gain->rampFrom = AUDIO_GAIN_UNITY;
+  gain->rampTo = AUDIO_GAIN_UNITY;
+  gain->rampPosition = 0;
+}
+
+void audio_gain_set(audio_gain_t* gain, int target) {
+  __atomic_store_n(&gain->target, target, __ATOMIC_RELAXED);
+}
+
+int audio_gain_begin(audio_gain_t* gain) {
+  int target = __atomic_load_n(&gain->target, __ATOMIC_RELAXED);
+  if(target != gain->rampTo) {
+    gain->rampFrom = gain->current;
+    gain->rampTo = target;
+    gain->rampPosition = 0;
+  }
+  return gain->current != AUDIO_GAIN_UNITY || gain->rampTo != AUDIO_GAIN_UNITY;
+}
+
+void audio_gain_apply(audio_gain_t* gain, int16_t* samples, int frames, int channels, int sampleRate) {
+  int rampFrames = sampleRate * AUDIO_GAIN_RAMP_MS / 1000 + 1;
+  int frame = 0;
+  int c;
+
+  if(!audio_gain_begin(gain)) {
+    return;
+  }
+  //Ramp frame by frame, jumping to a new gain at once would click.
+  while(gain->current != gain->rampTo && frame < frames) {
+    gain->rampPosition++;
+    gain->current = gain->rampPosition >= rampFrames ? gain->rampTo :
+      gain->rampFrom + (gain->rampTo - gain->rampFrom) * gain->rampPosition / rampFrames;
+    for(c = 0; c < channels; c++) {
+      int16_t* sample = &samples[frame * channels + c];
+      *sample = audio_dsp_saturate(((int32_t)*sample * gain->current + (1 << 14)) >> 15);
+    }
+    frame++;
+  }
+  if(frame < frames && gain->current != AUDIO_GAIN_UNITY) {
+    audio_dsp_gain(samples + frame * channels, samples + frame * channels, (int16_t)gain->current,
+      (frames - frame) * channels);
+  }
+}
+
+const char* audio_dsp_name(void) {
+  if(__atomic_load_n(&audio_dsp_mix_impl, __ATOMIC_ACQUIRE) == NULL) {
+    audio_dsp_select();
+  }
+  return __atomic_load_n(&audio_dsp_impl_name, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,159 @@
+#include "audio.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define AUDIO_POOL_ALIGNMENT 64
+
+static void audio_pool_unref(audio_pool_t* pool) {
+  int i;
+  if(__atomic_sub_fetch(&pool->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    for(i = 0; i < AUDIO_POOL_CLASSES; i++) {
+      if(pool->locked) {
+        munlock(pool->memory[i], pool->stride[i] * pool->chunks[i]);
+      }
+      free(pool->memory[i]);
+    }
+    free(pool);
+  }
+}
+
+audio_pool_t* audio_pool_create(void) {
+  size_t sampleBytes[AUDIO_POOL_CLASSES] = AUDIO_POOL_CLASS_SIZES;
+  int chunks[AUDIO_POOL_CLASSES] = AUDIO_POOL_CLASS_CHUNKS;
+  audio_pool_t* pool = calloc(1, sizeof(audio_pool_t));
+  int i;
+
+  for(i = 0; i < AUDIO_POOL_CLASSES; i++) {
+    size_t stride = sizeof(audio_fifo_data_t) + sampleBytes[i];
+    stride = (stride + AUDIO_POOL_ALIGNMENT - 1) & ~(size_t)(AUDIO_POOL_ALIGNMENT - 1);
+    pool->sampleBytes[i] = sampleBytes[i];
+    pool->stride[i] = stride;
+    pool->chunks[i] = chunks[i];
+    pool->memory[i] = malloc(stride * chunks[i]);
+  }
+  pool->refs = 1;
+  return pool;
+}
+
+void audio_pool_release(audio_pool_t* pool) {
+  audio_pool_unref(pool);
+}
+
+int audio_pool_lock(audio_pool_t* pool) {
+  int i;
+  for(i = 0; i < AUDIO_POOL_CLASSES; i++) {
+    if(mlock(pool->memory[i], pool->stride[i] * pool->chunks[i]) != 0) {
+      while(--i >= 0) {
+        munlock(pool->memory[i], pool->stride[i] * pool->chunks[i]);
+      }
+      return -1;
+    }
+  }
+  pool->locked = 1;
+  return 0;
+}
+
+void audio_pool_get_stats(audio_pool_t* pool, audio_pool_stats_t* stats) {
+  stats->hits = __atomic_load_n(&pool->hits, __ATOMIC_RELAXED);
+  stats->misses = __atomic_load_n(&pool->misses, __ATOMIC_RELAXED);
+  stats->highWaterMark = __atomic_load_n(&pool->highWaterMark, __ATOMIC_RELAXED);
+  stats->chunksInUse = __atomic_load_n(&pool->chunksInUse, __ATOMIC_RELAXED);
+}
+
+static audio_fifo_data_t* audio_pool_take(audio_pool_t* pool, size_t sampleBytes) {
+  int c, i;
+  for(c = 0; c < AUDIO_POOL_CLASSES; c++) {
+    if(pool->sampleBytes[c] < sampleBytes) {
+      continue;
+    }
+    for(i = 0; i < pool->chunks[c]; i++) {
+      int expected = 0;
+      if(__atomic_load_n(&pool->inUse[c][i], __ATOMIC_RELAXED) == 0 &&
+        __atomic_compare_exchange_n(&pool->inUse[c][i], &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        audio_fifo_data_t* audioData = (audio_fifo_data_t*)(pool->memory[c] + pool->stride[c] * i);
+        audioData->pool = pool;
+        audioData->poolSlot = c * AUDIO_POOL_MAX_CHUNKS + i;
+        return audioData;
+      }
+    }
+    //The smallest class that fits is exhausted, a bigger chunk is still better than the heap.
+  }
+  return NULL;
+}
+
+audio_fifo_data_t* audio_data_alloc(audio_pool_t* pool, size_t sampleBytes) {
+  audio_fifo_data_t* audioData = NULL;
+
+  if(pool != NULL) {
+    audioData = audio_pool_take(pool, sampleBytes);
+    if(audioData != NULL) {
+      int inUse = __atomic_add_fetch(&pool->chunksInUse, 1, __ATOMIC_RELAXED);
+      int highWaterMark = __atomic_load_n(&pool->highWaterMark, __ATOMIC_RELAXED);
+      while(inUse > highWaterMark &&
+        !__atomic_compare_exchange_n(&pool->highWaterMark, &highWaterMark, inUse, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+      __atomic_add_fetch(&pool->refs, 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&pool->hits, 1, __ATOMIC_RELAXED);
+      audioData->refs = 1;
+      audioData->deliveredAt = uv_hrtime();
+      return audioData;
+    }
+    __atomic_add_fetch(&pool->misses, 1, __ATOMIC_RELAXED);
+  }
+
+  audioData = malloc(sizeof(*audioData) + sampleBytes);
+  audioData->pool = NULL;
+  audioData->poolSlot = -1;
+  audioData->refs = 1;
+  audioData->deliveredAt = uv_hrtime();
+  return audioData;
+}
+
+void audio_data_ref(audio_fifo_data_t* audioData) {
+  __atomic_add_fetch(&audioData->refs, 1, __ATOMIC_RELAXED);
+}
+
+audio_fifo_data_t* audio_data_unshare(audio_fifo_data_t* audioData) {
+  size_t sampleBytes;
+  audio_fifo_data_t* copy;
+  if(__atomic_load_n(&audioData->refs, __ATOMIC_ACQUIRE) <= 1) {
+    return audioData;
+  }
+  sampleBytes = (size_t)audioData->numberOfSamples * audioData->channels * sizeof(int16_t);
+  copy = audio_data_alloc(audioData->pool, sampleBytes);
+  copy->deliveredAt = audioData->deliveredAt;
+  copy->epoch = audioData->epoch;
+  copy->channels = audioData->channels;
+  copy->sampleRate = audioData->sampleRate;
+  copy->numberOfSamples = audioData->numberOfSamples;
+  memcpy(copy->samples, audioData->samples, sampleBytes);
+  audio_data_free(audioData);
+  return copy;
+}
+
+audio_fifo_data_t* audio_data_apply_gain(audio_gain_t* gain, audio_fifo_data_t* audioData) {
+  if(!audio_gain_begin(gain)) {
+    return audioData;
+  }
+  //Other sinks play the same chunk with their own volume.
+  audioData = audio_data_unshare(audioData);
+  audio_gain_apply(gain, audioData->samples, audioData->numberOfSamples, audioData->channels, audioData->sampleRate);
+  return audioData;
+}
+
+void audio_data_free(audio_fifo_data_t* audioData) {
+  audio_pool_t* pool = audioData->pool;
+  //Chunks that are not from audio_data_alloc have no references and belong to the caller.
+  if(__atomic_sub_fetch(&audioData->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+    return;
+  }
+  if(pool == NULL) {
+    free(audioData);
+    return;
+  }
+  __atomic_sub_fetch(&pool->chunksInUse, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&pool->inUse[audioData->poolSlot / AUDIO_POOL_MAX_CHUNKS][audioData->poolSlot % AUDIO_POOL_MAX_CHUNKS],
+    0, __ATOMIC_RELEASE);
+  audio_pool_unref(pool);
+}
@@ -0,0 +1,201 @@
+#include "audio.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+Filter length, Kaiser window shape and cutoff relative to the lower Nyquist frequency per quality level. The taps
+are a multiple of 8 so the vector kernels need no scalar rest.
+**/
+static const struct {
+  int taps;
+  double beta;
+  double rolloff;
+} audio_resample_levels[] = {
+  { 16, 5.0, 0.85 },
+  { 32, 7.5, 0.92 },
+  { 64, 9.0, 0.96 }
+};
+
+static int audio_resample_gcd(int a, int b) {
+  while(b != 0) {
+    int rest = a % b;
+    a = b;
+    b = rest;
+  }
+  return a;
+}
+
+static void audio_resample_ratio(int inputRate, int outputRate, int* up, int* down) {
+  int divisor = audio_resample_gcd(inputRate, outputRate);
+  *up = outputRate / divisor;
+  *down = inputRate / divisor;
+  if(*up > AUDIO_RESAMPLE_MAX_PHASES) {
+    *down = (int)(((int64_t)*down * AUDIO_RESAMPLE_MAX_PHASES + *up / 2) / *up);
+    *up = AUDIO_RESAMPLE_MAX_PHASES;
+  }
+}
+
+/**
+Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+**/
+static double audio_resample_bessel_i0(double x) {
+  double sum = 1, term = 1;
+  int k;
+  for(k = 1; k < 50 && term > sum * 1e-12; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+/**
+Row p of the filter weighs the taps input frames around input position p / up. Every row is normalized to a gain
+of one, otherwise the rows would differ slightly and modulate the signal with the phase.
+**/
+static void audio_resample_design(audio_resampler_t* resampler) {
+  double beta = audio_resample_levels[resampler->quality].beta;
+  double cutoff = audio_resample_levels[resampler->quality].rolloff;
+  double pi = atan(1.0) * 4;
+  int halfTaps = resampler->taps / 2;
+  int p, j;
+  if(resampler->down > resampler->up) {
+    cutoff = cutoff * resampler->up / resampler->down;
+  }
+  for(p = 0; p < resampler->up; p++) {
+    float* row = resampler->filter + p * resampler->taps;
+    double sum = 0;
+    for(j = 0; j < resampler->taps; j++) {
+      double distance = j - (halfTaps - 1) - (double)p / resampler->up;
+      double x = distance / halfTaps;
+      double sinc = distance == 0 ? 1 : sin(pi * cutoff * distance) / (pi * cutoff * distance);
+      double window = x * x >= 1 ? 0 : audio_resample_bessel_i0(beta * sqrt(1 - x * x)) / audio_resample_bessel_i0(beta);
+      row[j] = (float)(sinc * window);
+      sum += row[j];
+    }
+    for(j = 0; j < resampler->taps; j++) {
+      row[j] = (float)(row[j] / sum);
+    }
+  }
+}
+
+static void audio_resample_configure(audio_resampler_t* resampler, int inputRate, int channels, int epoch) {
+  if(inputRate != resampler->inputRate) {
+    free(resampler->filter);
+    resampler->filter = NULL;
+    resampler->taps = 0;
+    if(inputRate != resampler->outputRate) {
+      audio_resample_ratio(inputRate, resampler->outputRate, &resampler->up, &resampler->down);
+      resampler->taps = audio_resample_levels[resampler->quality].taps;
+      resampler->filter = malloc(resampler->up * resampler->taps * sizeof(float));
+      audio_resample_design(resampler);
+    }
+  }
+  resampler->inputRate = inputRate;
+  resampler->inputChannels = channels;
+  resampler->epoch = epoch;
+  resampler->phase = 0;
+  resampler->position = 0;
+  //Silence before the first frame, so the first output frame is centered on it.
+  resampler->planeFrames = resampler->taps > 0 ? resampler->taps / 2 - 1 : 0;
+  if(resampler->planeFrames > resampler->planeCapacity) {
+    resampler->planeCapacity = resampler->planeFrames;
+    resampler->planes[0] = realloc(resampler->planes[0], resampler->planeCapacity * sizeof(float));
+    resampler->planes[1] = realloc(resampler->planes[1], resampler->planeCapacity * sizeof(float));
+  }
+  if(resampler->planeFrames > 0) {
+    memset(resampler->planes[0], 0, resampler->planeFrames * sizeof(float));
+    memset(resampler->planes[1], 0, resampler->planeFrames * sizeof(float));
+  }
+}
+
+static int16_t audio_resample_to_int16(float value) {
+  float scaled = value * 32768.0f;
+  return scaled >= INT16_MAX ? INT16_MAX : (scaled <= INT16_MIN ? INT16_MIN : (int16_t)lrintf(scaled));
+}
+
+void audio_resampler_init(audio_resampler_t* resampler, int outputRate, int quality) {
+  memset(resampler, 0, sizeof(audio_resampler_t));
+  resampler->outputRate = outputRate;
+  resampler->quality = quality < AUDIO_RESAMPLE_LOW ? AUDIO_RESAMPLE_LOW :
+    (quality > AUDIO_RESAMPLE_HIGH ? AUDIO_RESAMPLE_HIGH : quality);
+}
+
+void audio_resampler_destroy(audio_resampler_t* resampler) {
+  free(resampler->filter);
+  free(resampler->planes[0]);
+  free(resampler->planes[1]);
+  memset(resampler, 0, sizeof(audio_resampler_t));
+}
+
+int audio_resampler_max_output(audio_resampler_t* resampler, int inputRate, int frames) {
+  int up, down;
+  if(inputRate == resampler->outputRate) {
+    return frames;
+  }
+  audio_resample_ratio(inputRate, resampler->outputRate, &up, &down);
+  return (int)(((int64_t)frames + audio_resample_levels[resampler->quality].taps) * up / down) + 1;
+}
+
+int audio_resample(audio_resampler_t* resampler, int16_t* dst, const int16_t* src, int frames, int inputRate,
+  int channels, int epoch) {
+  float* left;
+  float* right;
+  int output = 0;
+  int consumed;
+  int i;
+
+  if(inputRate != resampler->inputRate || channels != resampler->inputChannels || epoch != resampler->epoch) {
+    audio_resample_configure(resampler, inputRate, channels, epoch);
+  }
+  if(resampler->taps == 0) {
+    for(i = 0; i < frames; i++) {
+      dst[i * 2] = src[i * channels];
+      dst[i * 2 + 1] = src[i * channels + (channels > 1)];
+    }
+    return frames;
+  }
+
+  if(resampler->planeFrames + frames > resampler->planeCapacity) {
+    resampler->planeCapacity = resampler->planeFrames + frames;
+    resampler->planes[0] = realloc(resampler->planes[0], resampler->planeCapacity * sizeof(float));
+    resampler->planes[1] = realloc(resampler->planes[1], resampler->planeCapacity * sizeof(float));
+  }
+  left = resampler->planes[0];
+  right = channels > 1 ? resampler->planes[1] : left;
+  if(channels == 1) {
+    audio_dsp_to_float(left + resampler->planeFrames, src, frames);
+  } else if(channels == 2) {
+    audio_dsp_to_float_stereo(left + resampler->planeFrames, right + resampler->planeFrames, src, frames);
+  } else {
+    for(i = 0; i < frames; i++) {
+      left[resampler->planeFrames + i] = src[i * channels] / 32768.0f;
+      right[resampler->planeFrames + i] = src[i * channels + 1] / 32768.0f;
+    }
+  }
+  resampler->planeFrames += frames;
+
+  while(resampler->position + resampler->taps <= resampler->planeFrames) {
+    const float* row = resampler->filter + resampler->phase * resampler->taps;
+    float sampleLeft, sampleRight;
+    audio_dsp_fir2(row, left + resampler->position, right + resampler->position, resampler->taps, &sampleLeft,
+      &sampleRight);
+    dst[output * 2] = audio_resample_to_int16(sampleLeft);
+    dst[output * 2 + 1] = audio_resample_to_int16(sampleRight);
+    output++;
+    resampler->phase += resampler->down;
+    resampler->position += resampler->phase / resampler->up;
+    resampler->phase %= resampler->up;
+  }
+
+  //Keep only what the filter still needs.
+  consumed = resampler->position < resampler->planeFrames ? resampler->position : resampler->planeFrames;
+  memmove(left, left + consumed, (resampler->planeFrames - consumed) * sizeof(float));
+  if(channels > 1) {
+    memmove(right, right + consumed, (resampler->planeFrames - consumed) * sizeof(float));
+  }
+  resampler->planeFrames -= consumed;
+  resampler->position -= consumed;
+  return output;
+}
@@ -25,93 +25,581 @@
  * This file is part of the libspotify examples suite.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+#endif
+
 #include "audio.h"
 #include <stdlib.h>
+#include <string.h>
 
-int audio_stopThread;
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
 
-#ifdef NODE_SPOTIFY_NATIVE_SOUND
-static uv_thread_t audioThread;
-#endif
+#define AUDIO_FIFO_MASK (AUDIO_FIFO_SLOTS - 1)
 
-audio_fifo_data_t* audio_get(audio_fifo_t* audioFifo) {
-  uv_mutex_lock(&audioFifo->audioQueueMutex);
 
-  audio_fifo_data_t* audioData = TAILQ_FIRST(&audioFifo->queue);
-  if(audioData) {
-    TAILQ_REMOVE(&audioFifo->queue, audioData, link);
-    audioFifo->samplesInQueue -= audioData->numberOfSamples;
+static int audio_fifo_push(audio_fifo_t* audioFifo, audio_fifo_data_t* audioData) {
+  unsigned int head = __atomic_load_n(&audioFifo->head, __ATOMIC_RELAXED);
+  unsigned int tail = __atomic_load_n(&audioFifo->tail, __ATOMIC_ACQUIRE);
+  if(head - tail >= AUDIO_FIFO_SLOTS) {
+    return 0;
   }
 
-  uv_mutex_unlock(&audioFifo->audioQueueMutex);
+  __atomic_store_n(&audioFifo->slots[head & AUDIO_FIFO_MASK], audioData, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&audioFifo->samplesInQueue, audioData->numberOfSamples, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&audioFifo->telemetry.framesDelivered, audioData->numberOfSamples, __ATOMIC_RELAXED);
+  //Sequentially consistent so a native consumer going to sleep either sees the data or is seen waiting.
+  __atomic_store_n(&audioFifo->head, head + 1, __ATOMIC_SEQ_CST);
+  return 1;
+}
+
+static audio_fifo_data_t* audio_fifo_take(audio_fifo_t* audioFifo) {
+  unsigned int tail = __atomic_load_n(&audioFifo->tail, __ATOMIC_RELAXED);
+  audio_fifo_data_t* audioData;
+
+  for(;;) {
+    unsigned int head = __atomic_load_n(&audioFifo->head, __ATOMIC_ACQUIRE);
+    if(tail == head) {
+      return NULL;
+    }
+    audioData = __atomic_load_n(&audioFifo->slots[tail & AUDIO_FIFO_MASK], __ATOMIC_RELAXED);
+    //On failure tail is reloaded, someone else (a flush) took the chunk.
+    if(__atomic_compare_exchange_n(&audioFifo->tail, &tail, tail + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  __atomic_fetch_sub(&audioFifo->samplesInQueue, audioData->numberOfSamples, __ATOMIC_RELAXED);
   return audioData;
 }
 
-void audio_fifo_flush(audio_fifo_t* audioFifo) {
-  audio_fifo_data_t *audioData;
-  uv_mutex_lock(&audioFifo->audioQueueMutex);
+static int audio_fifo_milliseconds(audio_fifo_t* audioFifo, int sampleRate) {
+  return sampleRate > 0 ? (int)((int64_t)audio_fifo_samples(audioFifo) * 1000 / sampleRate) : 0;
+}
 
-  while((audioData = TAILQ_FIRST(&audioFifo->queue))) {
-	  TAILQ_REMOVE(&audioFifo->queue, audioData, link);
-	  free(audioData);
+/**
+Gives the chunk to every tap as its policy says. The caller keeps its own reference.
+**/
+static void audio_fifo_put_taps(audio_fifo_t* audioFifo, audio_fifo_data_t* audioData) {
+  int i;
+  __atomic_add_fetch(&audioFifo->tapUsers, 1, __ATOMIC_SEQ_CST);
+  for(i = 0; i < AUDIO_MAX_TAPS; i++) {
+    audio_tap_t* tap = &audioFifo->taps[i];
+    audio_fifo_t* tapFifo = __atomic_load_n(&tap->fifo, __ATOMIC_ACQUIRE);
+    int full;
+    if(tapFifo == NULL) {
+      continue;
+    }
+    full = tap->capacity > 0 && audio_fifo_milliseconds(tapFifo, audioData->sampleRate) >= tap->capacity;
+    if(full && tap->policy == AUDIO_TAP_SKIP) {
+      audio_telemetry_lost(tapFifo, audioData->numberOfSamples);
+      continue;
+    }
+    if(full && tap->policy == AUDIO_TAP_DROP_OLDEST) {
+      audio_fifo_data_t* oldest;
+      while(audio_fifo_milliseconds(tapFifo, audioData->sampleRate) >= tap->capacity &&
+        (oldest = audio_fifo_take(tapFifo))) {
+        audio_telemetry_dropped(tapFifo, oldest->numberOfSamples);
+        audio_data_free(oldest);
+      }
+    }
+    audio_data_ref(audioData);
+    if(!audio_fifo_push(tapFifo, audioData)) {
+      //All slots taken by tiny chunks, the capacity cannot help here.
+      audio_telemetry_lost(tapFifo, audioData->numberOfSamples);
+      audio_data_free(audioData);
+    }
   }
+  __atomic_sub_fetch(&audioFifo->tapUsers, 1, __ATOMIC_RELEASE);
+}
 
-  audioFifo->samplesInQueue = 0;
-  uv_mutex_unlock(&audioFifo->audioQueueMutex);
+int audio_fifo_taps_ready(audio_fifo_t* audioFifo, int sampleRate) {
+  int i;
+  for(i = 0; i < AUDIO_MAX_TAPS; i++) {
+    audio_tap_t* tap = &audioFifo->taps[i];
+    audio_fifo_t* tapFifo = __atomic_load_n(&tap->fifo, __ATOMIC_ACQUIRE);
+    if(tapFifo != NULL && tap->policy == AUDIO_TAP_BLOCK && tap->capacity > 0 &&
+      audio_fifo_milliseconds(tapFifo, sampleRate) >= tap->capacity) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int audio_fifo_free_slots(audio_fifo_t* audioFifo) {
+  unsigned int head = __atomic_load_n(&audioFifo->head, __ATOMIC_RELAXED);
+  unsigned int tail = __atomic_load_n(&audioFifo->tail, __ATOMIC_ACQUIRE);
+  return AUDIO_FIFO_SLOTS - (int)(head - tail);
+}
+
+static int audio_fifo_has_taps(audio_fifo_t* audioFifo) {
+  int i;
+  for(i = 0; i < AUDIO_MAX_TAPS; i++) {
+    if(__atomic_load_n(&audioFifo->taps[i].fifo, __ATOMIC_RELAXED) != NULL) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int audio_fifo_put(audio_fifo_t* audioFifo, audio_fifo_data_t* audioData) {
+  int taken;
+  if(!audio_fifo_has_taps(audioFifo)) {
+    return audio_fifo_push(audioFifo, audioData);
+  }
+  //Only a tap with the BLOCK policy holds up the others.
+  if(!audio_fifo_taps_ready(audioFifo, audioData->sampleRate)) {
+    return 0;
+  }
+  //Keep the chunk alive while the taps get it, the consumer of this queue may be done with it already.
+  audio_data_ref(audioData);
+  taken = audio_fifo_push(audioFifo, audioData);
+  if(taken) {
+    audio_fifo_put_taps(audioFifo, audioData);
+  }
+  audio_data_free(audioData);
+  return taken;
+}
+
+void audio_fifo_take_over(audio_fifo_t* audioFifo, audio_fifo_t* from) {
+  audio_fifo_data_t* audioData;
+  //Clock and volume first, the consumer may take the first chunk as soon as it is in the queue.
+  __atomic_store_n(&audioFifo->clock.deliveryEpoch, audio_clock_epoch(&from->clock), __ATOMIC_RELEASE);
+  __atomic_store_n(&audioFifo->clock.sampleRate, __atomic_load_n(&from->clock.sampleRate, __ATOMIC_RELAXED),
+    __ATOMIC_RELAXED);
+  __atomic_store_n(&audioFifo->clock.state, __atomic_load_n(&from->clock.state, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+  audioFifo->gain.current = from->gain.current;
+  audioFifo->gain.rampFrom = from->gain.rampFrom;
+  audioFifo->gain.rampTo = from->gain.rampTo;
+  audioFifo->gain.rampPosition = from->gain.rampPosition;
+  //Not to the taps, the sinks already have this audio.
+  while((audioData = audio_fifo_take(from))) {
+    if(!audio_fifo_push(audioFifo, audioData)) {
+      audio_telemetry_dropped(audioFifo, audioData->numberOfSamples);
+      audio_data_free(audioData);
+    }
+  }
+}
+
+int audio_fifo_add_tap(audio_fifo_t* audioFifo, audio_fifo_t* tap, int policy, int capacity) {
+  int epoch = audio_clock_epoch(&audioFifo->clock);
+  int i;
+  for(i = 0; i < AUDIO_MAX_TAPS; i++) {
+    if(__atomic_load_n(&audioFifo->taps[i].fifo, __ATOMIC_RELAXED) == NULL) {
+      break;
+    }
+  }
+  if(i == AUDIO_MAX_TAPS) {
+    return -1;
+  }
+  //The sink joins the track that is being delivered.
+  __atomic_store_n(&tap->clock.state, (int64_t)epoch << AUDIO_CLOCK_EPOCH_SHIFT, __ATOMIC_RELEASE);
+  __atomic_store_n(&tap->clock.deliveryEpoch, epoch, __ATOMIC_RELEASE);
+  audioFifo->taps[i].policy = policy;
+  audioFifo->taps[i].capacity = capacity;
+  __atomic_store_n(&audioFifo->taps[i].fifo, tap, __ATOMIC_RELEASE);
+  return 0;
+}
+
+void audio_fifo_remove_tap(audio_fifo_t* audioFifo, audio_fifo_t* tap) {
+  int i;
+  for(i = 0; i < AUDIO_MAX_TAPS; i++) {
+    if(__atomic_load_n(&audioFifo->taps[i].fifo, __ATOMIC_RELAXED) == tap) {
+      __atomic_store_n(&audioFifo->taps[i].fifo, NULL, __ATOMIC_SEQ_CST);
+    }
+  }
+  //A producer that already loaded the tap may still be putting into it.
+  while(__atomic_load_n(&audioFifo->tapUsers, __ATOMIC_SEQ_CST) > 0) {
+    sched_yield();
+  }
+}
+
+
+static int audio_latency_bucket(int64_t microseconds) {
+  int64_t ms = microseconds / 1000;
+  if(ms < 100) {
+    return ms < 0 ? 0 : (int)ms;
+  }
+  if(ms < 1000) {
+    return 100 + (int)((ms - 100) / 10);
+  }
+  if(ms < 10000) {
+    return 190 + (int)((ms - 1000) / 100);
+  }
+  ms = 280 + (ms - 10000) / 1000;
+  return ms < AUDIO_LATENCY_BUCKETS ? (int)ms : AUDIO_LATENCY_BUCKETS - 1;
+}
+
+static int audio_latency_bucket_limit(int bucket) {
+  if(bucket < 100) {
+    return bucket + 1;
+  }
+  if(bucket < 190) {
+    return 100 + (bucket - 99) * 10;
+  }
+  if(bucket < 280) {
+    return 1000 + (bucket - 189) * 100;
+  }
+  return 10000 + (bucket - 279) * 1000;
 }
 
 /**
-Initialize the audio queue and the locking mutex
+Telemetry of a chunk a sink takes out of the queue.
+**/
+static void audio_telemetry_consumed(audio_fifo_t* audioFifo, audio_fifo_data_t* audioData) {
+  audio_telemetry_t* telemetry = &audioFifo->telemetry;
+  static const int depthLimits[AUDIO_DEPTH_BUCKETS - 1] = AUDIO_DEPTH_LIMITS_MS;
+  int depth = audioData->sampleRate > 0 ?
+    (int)((int64_t)audio_fifo_samples(audioFifo) * 1000 / audioData->sampleRate) : 0;
+  int bucket = 0;
+
+  __atomic_fetch_add(&telemetry->framesConsumed, audioData->numberOfSamples, __ATOMIC_RELAXED);
+  if(__atomic_exchange_n(&telemetry->starvedEpoch, -1, __ATOMIC_RELAXED) == audioData->epoch) {
+    __atomic_fetch_add(&telemetry->underruns, 1, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&telemetry->lastEpoch, audioData->epoch, __ATOMIC_RELAXED);
+  while(bucket < AUDIO_DEPTH_BUCKETS - 1 && depth >= depthLimits[bucket]) {
+    bucket++;
+  }
+  __atomic_fetch_add(&telemetry->depth[bucket], 1, __ATOMIC_RELAXED);
+  if(!__atomic_load_n(&telemetry->sinkMeasuresLatency, __ATOMIC_RELAXED)) {
+    audio_telemetry_latency(audioFifo, (int64_t)(uv_hrtime() - audioData->deliveredAt) / 1000);
+  }
+}
+
+audio_fifo_data_t* audio_get(audio_fifo_t* audioFifo) {
+  audio_fifo_data_t* audioData = audio_fifo_take(audioFifo);
+  if(audioData != NULL) {
+    audio_telemetry_consumed(audioFifo, audioData);
+  }
+  return audioData;
+}
+
+void audio_telemetry_starved(audio_fifo_t* audioFifo) {
+  __atomic_store_n(&audioFifo->telemetry.starvedEpoch, __atomic_load_n(&audioFifo->telemetry.lastEpoch, __ATOMIC_RELAXED),
+    __ATOMIC_RELAXED);
+}
+
+void audio_telemetry_dropped(audio_fifo_t* audioFifo, int frames) {
+  __atomic_fetch_add(&audioFifo->telemetry.framesDropped, frames, __ATOMIC_RELAXED);
+}
+
+void audio_telemetry_lost(audio_fifo_t* audioFifo, int frames) {
+  __atomic_fetch_add(&audioFifo->telemetry.framesDelivered, frames, __ATOMIC_RELAXED);
+  audio_telemetry_dropped(audioFifo, frames);
+}
+
+void audio_telemetry_latency(audio_fifo_t* audioFifo, int64_t microseconds) {
+  audio_telemetry_t* telemetry = &audioFifo->telemetry;
+  int64_t max = __atomic_load_n(&telemetry->maxLatency, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&telemetry->latency[audio_latency_bucket(microseconds)], 1, __ATOMIC_RELAXED);
+  while(microseconds > max &&
+    !__atomic_compare_exchange_n(&telemetry->maxLatency, &max, microseconds, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+void audio_telemetry_get(audio_fifo_t* audioFifo, audio_telemetry_t* snapshot) {
+  audio_telemetry_t* telemetry = &audioFifo->telemetry;
+  int i;
+  snapshot->framesDelivered = __atomic_load_n(&telemetry->framesDelivered, __ATOMIC_RELAXED);
+  snapshot->framesConsumed = __atomic_load_n(&telemetry->framesConsumed, __ATOMIC_RELAXED);
+  snapshot->framesDropped = __atomic_load_n(&telemetry->framesDropped, __ATOMIC_RELAXED);
+  snapshot->underruns = __atomic_load_n(&telemetry->underruns, __ATOMIC_RELAXED);
+  snapshot->starvedEpoch = __atomic_load_n(&telemetry->starvedEpoch, __ATOMIC_RELAXED);
+  snapshot->lastEpoch = __atomic_load_n(&telemetry->lastEpoch, __ATOMIC_RELAXED);
+  snapshot->sinkMeasuresLatency = __atomic_load_n(&telemetry->sinkMeasuresLatency, __ATOMIC_RELAXED);
+  for(i = 0; i < AUDIO_DEPTH_BUCKETS; i++) {
+    snapshot->depth[i] = __atomic_load_n(&telemetry->depth[i], __ATOMIC_RELAXED);
+  }
+  for(i = 0; i < AUDIO_LATENCY_BUCKETS; i++) {
+    snapshot->latency[i] = __atomic_load_n(&telemetry->latency[i], __ATOMIC_RELAXED);
+  }
+  snapshot->maxLatency = __atomic_load_n(&telemetry->maxLatency, __ATOMIC_RELAXED);
+}
+
+int audio_telemetry_percentile(const audio_telemetry_t* snapshot, int percent) {
+  uint64_t total = 0, count = 0;
+  int maxMs = (int)((snapshot->maxLatency + 999) / 1000);
+  int i;
+  for(i = 0; i < AUDIO_LATENCY_BUCKETS; i++) {
+    total += snapshot->latency[i];
+  }
+  if(total == 0) {
+    return 0;
+  }
+  for(i = 0; i < AUDIO_LATENCY_BUCKETS; i++) {
+    count += snapshot->latency[i];
+    if(count * 100 >= total * percent) {
+      break;
+    }
+  }
+  //The maximum is exact, no percentile can be above it.
+  return audio_latency_bucket_limit(i) < maxMs ? audio_latency_bucket_limit(i) : maxMs;
+}
+
+audio_fifo_data_t* audio_peek(audio_fifo_t* audioFifo) {
+  unsigned int tail = __atomic_load_n(&audioFifo->tail, __ATOMIC_RELAXED);
+  unsigned int head = __atomic_load_n(&audioFifo->head, __ATOMIC_ACQUIRE);
+  if(tail == head) {
+    return NULL;
+  }
+  return __atomic_load_n(&audioFifo->slots[tail & AUDIO_FIFO_MASK], __ATOMIC_RELAXED);
+}
+
+int audio_fifo_samples(audio_fifo_t* audioFifo) {
+  return __atomic_load_n(&audioFifo->samplesInQueue, __ATOMIC_RELAXED);
+}
+
+#define AUDIO_CLOCK_FRAMES(state) ((state) & (((int64_t)1 << AUDIO_CLOCK_EPOCH_SHIFT) - 1))
+#define AUDIO_CLOCK_PLAYED_EPOCH(state) ((int)((state) >> AUDIO_CLOCK_EPOCH_SHIFT) & AUDIO_CLOCK_EPOCH_MASK)
+
+int audio_clock_reset(audio_clock_t* clock) {
+  int epoch = (audio_clock_epoch(clock) + 1) & AUDIO_CLOCK_EPOCH_MASK;
+  //Playback first: a sink seeing the new delivery epoch before must not take it for the next track.
+  //A sink advancing concurrently fails its compare and swap and sees the new epoch.
+  __atomic_store_n(&clock->state, (int64_t)epoch << AUDIO_CLOCK_EPOCH_SHIFT, __ATOMIC_RELEASE);
+  __atomic_store_n(&clock->deliveryEpoch, epoch, __ATOMIC_RELEASE);
+  return epoch;
+}
+
+int audio_clock_next(audio_clock_t* clock) {
+  int epoch = (audio_clock_epoch(clock) + 1) & AUDIO_CLOCK_EPOCH_MASK;
+  __atomic_store_n(&clock->deliveryEpoch, epoch, __ATOMIC_RELEASE);
+  return epoch;
+}
+
+int audio_clock_epoch(audio_clock_t* clock) {
+  return __atomic_load_n(&clock->deliveryEpoch, __ATOMIC_ACQUIRE);
+}
+
+void audio_clock_advance(audio_clock_t* clock, int epoch, int frames, int sampleRate) {
+  int64_t state = __atomic_load_n(&clock->state, __ATOMIC_ACQUIRE);
+  int64_t advanced;
+  do {
+    int playedEpoch = AUDIO_CLOCK_PLAYED_EPOCH(state);
+    int ahead = (epoch - playedEpoch) & AUDIO_CLOCK_EPOCH_MASK;
+    if(ahead == 0) {
+      advanced = state + frames;
+    } else if(ahead <= ((audio_clock_epoch(clock) - playedEpoch) & AUDIO_CLOCK_EPOCH_MASK)) {
+      //First audio of a track that was queued gaplessly.
+      advanced = ((int64_t)epoch << AUDIO_CLOCK_EPOCH_SHIFT) + frames;
+    } else {
+      return;
+    }
+  } while(!__atomic_compare_exchange_n(&clock->state, &state, advanced, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  __atomic_store_n(&clock->sampleRate, sampleRate, __ATOMIC_RELAXED);
+}
+
+int64_t audio_clock_frames(audio_clock_t* clock, int* sampleRate, int* epoch) {
+  int64_t state = __atomic_load_n(&clock->state, __ATOMIC_ACQUIRE);
+  *sampleRate = __atomic_load_n(&clock->sampleRate, __ATOMIC_RELAXED);
+  *epoch = AUDIO_CLOCK_PLAYED_EPOCH(state);
+  return AUDIO_CLOCK_FRAMES(state);
+}
+
+void audio_fifo_flush(audio_fifo_t* audioFifo) {
+  audio_fifo_data_t *audioData;
+  while((audioData = audio_fifo_take(audioFifo))) {
+    audio_telemetry_dropped(audioFifo, audioData->numberOfSamples);
+    audio_data_free(audioData);
+  }
+  //Whatever comes next starts over, running empty before is no underrun.
+  __atomic_store_n(&audioFifo->telemetry.starvedEpoch, -1, __ATOMIC_RELAXED);
+}
+
+/**
+Initialize the audio queue
 **/
 void audio_init(audio_fifo_t* audioFifo) {
-  TAILQ_INIT(&audioFifo->queue);
+  audioFifo->head = 0;
+  audioFifo->tail = 0;
   audioFifo->samplesInQueue = 0;
-  uv_mutex_init(&audioFifo->audioQueueMutex);
+  audioFifo->clock.state = 0;
+  audioFifo->clock.deliveryEpoch = 0;
+  audio_gain_init(&audioFifo->gain);
+  audioFifo->clock.sampleRate = 0;
+  memset(&audioFifo->telemetry, 0, sizeof(audio_telemetry_t));
+  memset(audioFifo->taps, 0, sizeof(audioFifo->taps));
+  audioFifo->tapUsers = 0;
+  audioFifo->telemetry.starvedEpoch = -1;
+  audioFifo->telemetry.lastEpoch = -1;
 }
 
 void audio_stop(audio_fifo_t *audioFifo) {
   audio_fifo_flush(audioFifo);
-  uv_mutex_destroy(&audioFifo->audioQueueMutex);
 }
 
-#ifdef NODE_SPOTIFY_NATIVE_SOUND
+static int audio_fifo_empty(audio_fifo_t* audioFifo) {
+  return __atomic_load_n(&audioFifo->head, __ATOMIC_SEQ_CST) == __atomic_load_n(&audioFifo->tail, __ATOMIC_SEQ_CST);
+}
+
 /**
-Gets the audio data from the queue. If there is none, waits for the condition variable to trigger.
+Gets the audio data from the queue. If there is none, waits for the condition variable to trigger, at most timeout
+ns unless timeout is 0.
 **/
-audio_fifo_data_t* audio_get_native(audio_fifo_t* audioFifo) {
+static audio_fifo_data_t* audio_wait_native(audio_fifo_t* audioFifo, uint64_t timeout) {
   audio_fifo_data_t* audioData;
-  uv_mutex_lock(&audioFifo->audioQueueMutex);
+  int timedOut = 0;
 
-  while( !audio_stopThread && !(audioData = TAILQ_FIRST(&audioFifo->queue)) ) {
-    uv_cond_wait(&audioFifo->audioCondition, &audioFifo->audioQueueMutex);
+  for(;;) {
+    if(__atomic_load_n(&audioFifo->stopThread, __ATOMIC_ACQUIRE)) {
+      return NULL;
+    }
+    if((audioData = audio_get(audioFifo))) {
+      return audio_data_apply_gain(&audioFifo->gain, audioData);
+    }
+    if(timedOut) {
+      return NULL;
+    }
+
+    audio_telemetry_starved(audioFifo);
+    uv_mutex_lock(&audioFifo->audioQueueMutex);
+    __atomic_store_n(&audioFifo->consumerWaiting, 1, __ATOMIC_SEQ_CST);
+    if(!audioFifo->stopThread && audio_fifo_empty(audioFifo)) {
+      if(timeout == 0) {
+        uv_cond_wait(&audioFifo->audioCondition, &audioFifo->audioQueueMutex);
+      } else {
+        timedOut = uv_cond_timedwait(&audioFifo->audioCondition, &audioFifo->audioQueueMutex, timeout) != 0;
+      }
+    }
+    __atomic_store_n(&audioFifo->consumerWaiting, 0, __ATOMIC_RELAXED);
+    uv_mutex_unlock(&audioFifo->audioQueueMutex);
   }
+}
+
+audio_fifo_data_t* audio_get_native(audio_fifo_t* audioFifo) {
+  return audio_wait_native(audioFifo, 0);
+}
+
+audio_fifo_data_t* audio_get_native_timed(audio_fifo_t* audioFifo, uint64_t timeout) {
+  return audio_wait_native(audioFifo, timeout);
+}
 
-  if(audio_stopThread) {
+/**
+The producer only touches the mutex if the consumer is asleep, i.e. the queue ran empty.
+**/
+void audio_signal_native(audio_fifo_t* audioFifo) {
+  if(__atomic_load_n(&audioFifo->consumerWaiting, __ATOMIC_SEQ_CST)) {
+    uv_mutex_lock(&audioFifo->audioQueueMutex);
+    uv_cond_signal(&audioFifo->audioCondition);
     uv_mutex_unlock(&audioFifo->audioQueueMutex);
-    return NULL;
   }
+}
 
-  TAILQ_REMOVE(&audioFifo->queue, audioData, link);
-  audioFifo->samplesInQueue -= audioData->numberOfSamples;
+/**
+Applies the scheduling options to the calling thread. Whatever the system does not allow is reported once and left
+at the default, the audio still plays.
+**/
+static void audio_thread_setup(audio_fifo_t* audioFifo) {
+  const audio_output_options_t* options = &audioFifo->outputOptions;
+  int r;
 
-  uv_mutex_unlock(&audioFifo->audioQueueMutex);
-  return audioData;
+  if(options->schedPolicy != AUDIO_SCHED_DEFAULT) {
+    int policy = options->schedPolicy == AUDIO_SCHED_RR ? SCHED_RR : SCHED_FIFO;
+    int minPriority = sched_get_priority_min(policy);
+    int maxPriority = sched_get_priority_max(policy);
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = options->schedPriority < minPriority ? minPriority :
+      (options->schedPriority > maxPriority ? maxPriority : options->schedPriority);
+    if((r = pthread_setschedparam(pthread_self(), policy, &param)) == 0) {
+      __atomic_store_n(&audioFifo->outputStats.realtime, 1, __ATOMIC_RELAXED);
+    } else {
+      fprintf(stderr, "audio: Unable to use realtime scheduling (%s), running at normal priority\n", strerror(r));
+    }
+  }
+
+  if(options->cpuMask != 0) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    int cpu;
+    CPU_ZERO(&cpus);
+    for(cpu = 0; cpu < 64; cpu++) {
+      if(options->cpuMask & ((uint64_t)1 << cpu)) {
+        CPU_SET(cpu, &cpus);
+      }
+    }
+    if((r = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) == 0) {
+      __atomic_store_n(&audioFifo->outputStats.affinity, 1, __ATOMIC_RELAXED);
+    } else {
+      fprintf(stderr, "audio: Unable to pin the audio thread to the CPUs (%s)\n", strerror(r));
+    }
+#else
+    fprintf(stderr, "audio: Pinning the audio thread to CPUs is not supported on this system\n");
+#endif
+  }
+}
+
+static void audio_thread(void* aux) {
+  audio_fifo_t* audioFifo = aux;
+  audio_thread_setup(audioFifo);
+  audioFifo->consumer(audioFifo);
 }
 
-void audio_init_native(audio_fifo_t* audioFifo) {
-  audio_stopThread = 0;
+void audio_init_thread(audio_fifo_t* audioFifo, audio_pool_t* pool, const audio_output_options_t* options,
+  void (*consumer)(void* aux), void* sink) {
+  audioFifo->stopThread = 0;
+  audioFifo->consumer = consumer;
+  audioFifo->sink = sink;
+  audioFifo->outputOptions = *options;
+  memset(&audioFifo->outputStats, 0, sizeof(audio_output_stats_t));
+  audioFifo->consumerWaiting = 0;
+  uv_mutex_init(&audioFifo->audioQueueMutex);
   uv_cond_init(&audioFifo->audioCondition);
-  uv_thread_create(&audioThread, audio_start, audioFifo);
+  if(options->lockMemory) {
+    //A page fault in the queue or a chunk would stall the audio thread like a preemption does.
+    if(mlock(audioFifo, sizeof(audio_fifo_t)) == 0 && audio_pool_lock(pool) == 0) {
+      audioFifo->outputStats.memoryLocked = 1;
+    } else {
+      munlock(audioFifo, sizeof(audio_fifo_t));
+      fprintf(stderr, "audio: Unable to lock the audio buffers in memory, check RLIMIT_MEMLOCK\n");
+    }
+  }
+  uv_thread_create(&audioFifo->consumerThread, audio_thread, audioFifo);
 }
 
-void audio_stop_native(audio_fifo_t* audioFifo) {
-  audio_stopThread  = 1;
+#ifdef NODE_SPOTIFY_NATIVE_SOUND
+void audio_init_native(audio_fifo_t* audioFifo, audio_pool_t* pool, const audio_output_options_t* options) {
+  audio_init_thread(audioFifo, pool, options, audio_start, NULL);
+}
+#endif
+
+void audio_output_get_stats(audio_fifo_t* audioFifo, audio_output_stats_t* stats) {
+  stats->xruns = __atomic_load_n(&audioFifo->outputStats.xruns, __ATOMIC_RELAXED);
+  stats->openFailures = __atomic_load_n(&audioFifo->outputStats.openFailures, __ATOMIC_RELAXED);
+  stats->periodSize = __atomic_load_n(&audioFifo->outputStats.periodSize, __ATOMIC_RELAXED);
+  stats->bufferSize = __atomic_load_n(&audioFifo->outputStats.bufferSize, __ATOMIC_RELAXED);
+  stats->mmap = __atomic_load_n(&audioFifo->outputStats.mmap, __ATOMIC_RELAXED);
+  stats->realtime = __atomic_load_n(&audioFifo->outputStats.realtime, __ATOMIC_RELAXED);
+  stats->affinity = __atomic_load_n(&audioFifo->outputStats.affinity, __ATOMIC_RELAXED);
+  stats->memoryLocked = audioFifo->outputStats.memoryLocked;
+}
+
+static void audio_join_native(audio_fifo_t* audioFifo, int how) {
+  if(audioFifo->consumer == NULL) {
+    return;
+  }
   //Notify audio_get_native to return in case it is waiting for data
   uv_mutex_lock(&audioFifo->audioQueueMutex);
+  __atomic_store_n(&audioFifo->stopThread, how, __ATOMIC_RELEASE);
   uv_cond_signal(&audioFifo->audioCondition);
   uv_mutex_unlock(&audioFifo->audioQueueMutex);
+  uv_thread_join(&audioFifo->consumerThread);
+  audioFifo->consumer = NULL;
+}
+
+void audio_halt_native(audio_fifo_t* audioFifo) {
+  audio_join_native(audioFifo, AUDIO_THREAD_HALT);
+}
+
+void audio_stop_native(audio_fifo_t* audioFifo) {
+  audio_join_native(audioFifo, AUDIO_THREAD_STOP);
   audio_fifo_flush(audioFifo);
-  uv_thread_join(&audioThread);
   uv_cond_destroy(&audioFifo->audioCondition);
+  uv_mutex_destroy(&audioFifo->audioQueueMutex);
+  if(audioFifo->outputStats.memoryLocked) {
+    munlock(audioFifo, sizeof(audio_fifo_t));
+  }
 }
-#endif
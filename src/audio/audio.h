@@ -29,33 +29,633 @@
 
 #include <uv.h>
 #include <stdint.h>
-#include "queue.h"
+
+/**
+Number of chunks the fifo can hold. Must be a power of two.
+**/
+#define AUDIO_FIFO_SLOTS 1024
+
+typedef struct audio_pool audio_pool_t;
 
 typedef struct audio_fifo_data {
-  TAILQ_ENTRY(audio_fifo_data) link;
+  audio_pool_t* pool;
+  /**
+  uv_hrtime when the chunk was allocated, i.e. when its audio was delivered.
+  **/
+  uint64_t deliveredAt;
+  int poolSlot;
+  /**
+  References to the chunk, it is freed when the last one is given back. A chunk that went to several sinks is
+  shared and must not be changed in place.
+  **/
+  int refs;
+  /**
+  Epoch of the playback clock when the chunk was delivered.
+  **/
+  int epoch;
   int channels;
   int sampleRate;
   int numberOfSamples;
   int16_t samples[0];
 } audio_fifo_data_t;
 
+/**
+Counts the frames a sink actually played of the current track. Chunks are stamped with the delivery epoch.
+A reset (a seek or a new track) starts a new epoch for delivery and playback at once, so frames of chunks delivered
+before it are never counted. For gapless playback audio_clock_next only starts a new delivery epoch, playback
+switches over when the sink plays the first chunk of it. The played epoch lives in the upper bits of the same word
+as the frame count, so both change together.
+**/
+typedef struct audio_clock {
+  int64_t state;
+  int deliveryEpoch;
+  int sampleRate;
+} audio_clock_t;
+
+#define AUDIO_CLOCK_EPOCH_SHIFT 48
+#define AUDIO_CLOCK_EPOCH_MASK 0xffff
+
+/**
+Volume of the audio leaving the queue, in Q15. target is set from any thread, the rest belongs to the consumer.
+Changes of target are ramped over AUDIO_GAIN_RAMP_MS.
+**/
+typedef struct audio_gain {
+  int target;
+  int current;
+  int rampFrom;
+  int rampTo;
+  int rampPosition;
+} audio_gain_t;
+
+#define AUDIO_GAIN_UNITY 32767
+#define AUDIO_GAIN_RAMP_MS 20
+
+/**
+Quality levels of the resampler. Higher levels use longer filters, which keep more of the treble and let through
+less aliasing.
+**/
+#define AUDIO_RESAMPLE_LOW 0
+#define AUDIO_RESAMPLE_MEDIUM 1
+#define AUDIO_RESAMPLE_HIGH 2
+/**
+The resampler always puts out stereo.
+**/
+#define AUDIO_RESAMPLE_CHANNELS 2
+/**
+More phases than this and the ratio of the rates is rounded, which changes the pitch by less than 0.05 %.
+**/
+#define AUDIO_RESAMPLE_MAX_PHASES 1024
+
+/**
+Converts audio of any rate to stereo at outputRate with a polyphase windowed sinc filter. Output frame k lies at
+input position k * down / up, the filter for its fraction phase / up is row phase of filter. Input is kept as floats
+per channel in planes, with the frames the filter still needs from the previous chunk in front. Belongs to the
+delivery thread.
+**/
+typedef struct audio_resampler {
+  int outputRate;
+  int quality;
+  int inputRate;
+  int inputChannels;
+  int epoch;
+  int up;
+  int down;
+  int taps;
+  float* filter;
+  int phase;
+  /**
+  Input frame in the planes where the filter for the next output frame starts.
+  **/
+  int position;
+  float* planes[AUDIO_RESAMPLE_CHANNELS];
+  int planeFrames;
+  int planeCapacity;
+} audio_resampler_t;
+
+#define AUDIO_DEPTH_BUCKETS 12
+#define AUDIO_DEPTH_LIMITS_MS { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000 }
+/**
+1 ms wide up to 100 ms, 10 ms wide up to 1 s, 100 ms wide up to 10 s and 1 s wide above.
+**/
+#define AUDIO_LATENCY_BUCKETS 330
+
+/**
+Counters of the audio going through a queue. Frames are counted when they are put into the queue, when a sink takes
+them out and when a flush or a sink that could not play them throws them away. An underrun is a sink finding the
+queue empty in the middle of a track: it asked for audio and the next chunk it got was of the same epoch. The depth
+of the queue is sampled and the latency from delivery until the chunk is played is measured for every chunk a sink
+takes. Sinks that know how long their device buffers set sinkMeasuresLatency and measure it themselves.
+**/
+typedef struct audio_telemetry {
+  int64_t framesDelivered;
+  int64_t framesConsumed;
+  int64_t framesDropped;
+  int underruns;
+  int starvedEpoch;
+  int lastEpoch;
+  int sinkMeasuresLatency;
+  unsigned int depth[AUDIO_DEPTH_BUCKETS];
+  unsigned int latency[AUDIO_LATENCY_BUCKETS];
+  int64_t maxLatency;
+} audio_telemetry_t;
+
+#define AUDIO_DEVICE_NAME_LENGTH 128
+
+#define AUDIO_SCHED_DEFAULT 0
+#define AUDIO_SCHED_FIFO 1
+#define AUDIO_SCHED_RR 2
+
+/**
+Settings of the native output. Sizes are in frames, 0 lets the output choose. An empty device is the default one.
+The audio thread runs with schedPolicy at schedPriority and only on the CPUs set in cpuMask, 0 for any CPU. If
+lockMemory is set the queue and the chunk pool are kept out of swap.
+**/
+typedef struct audio_output_options {
+  char device[AUDIO_DEVICE_NAME_LENGTH];
+  int periodSize;
+  int bufferSize;
+  int schedPolicy;
+  int schedPriority;
+  uint64_t cpuMask;
+  int lockMemory;
+} audio_output_options_t;
+
+/**
+What the native output reports, written by the audio thread. xruns counts the times the device ran dry while audio
+was queued, openFailures the times the device could not be opened. The sizes are what the device really uses.
+realtime, affinity and memoryLocked are set if the options asked for them and the system allowed them.
+**/
+typedef struct audio_output_stats {
+  int xruns;
+  int openFailures;
+  int periodSize;
+  int bufferSize;
+  int mmap;
+  int realtime;
+  int affinity;
+  int memoryLocked;
+} audio_output_stats_t;
+
+#define AUDIO_MAX_TAPS 8
+
+#define AUDIO_TAP_BLOCK 0
+#define AUDIO_TAP_DROP_OLDEST 1
+#define AUDIO_TAP_SKIP 2
+
+struct audio_fifo;
+
+/**
+Another queue that gets every chunk put into a queue, the queue of another sink. The chunk is shared, not copied.
+policy says what happens if the tap already holds capacity ms of audio: BLOCK refuses the chunk for all queues, so
+the slowest sink paces the delivery, DROP_OLDEST throws away the oldest audio of the tap and SKIP does not give the
+chunk to it. A tap is in use while fifo is set.
+**/
+typedef struct audio_tap {
+  struct audio_fifo* fifo;
+  int policy;
+  int capacity;
+} audio_tap_t;
+
+#define AUDIO_THREAD_STOP 1
+#define AUDIO_THREAD_HALT 2
+
+#define AUDIO_PATH_LENGTH 4096
+
+#define AUDIO_FILE_WAV 0
+#define AUDIO_FILE_RAW 1
+#define AUDIO_WAV_HEADER_SIZE 44
+
+/**
+Settings of the file sink. If path contains %d every track goes into its own file, with %d replaced by the number
+of the track, otherwise all tracks go into one file. Audio is written in blocks of writeSize bytes, a multiple of
+AUDIO_FILE_ALIGNMENT, 0 for the default. direct bypasses the page cache where the file system allows it, preallocate
+reserves that many bytes of disk space at a time ahead of the writes, 0 to let the file grow as it is written.
+**/
+typedef struct audio_file_options {
+  char path[AUDIO_PATH_LENGTH];
+  int format;
+  int writeSize;
+  int direct;
+  int64_t preallocate;
+} audio_file_options_t;
+
+/**
+What the file sink reports, written by its thread. direct and preallocated are set if the file system allowed them.
+**/
+typedef struct audio_file_stats {
+  int64_t bytesWritten;
+  int writes;
+  int files;
+  int openFailures;
+  int writeErrors;
+  int direct;
+  int preallocated;
+} audio_file_stats_t;
+
+typedef struct audio_file_sink {
+  audio_file_options_t options;
+  audio_file_stats_t stats;
+} audio_file_sink_t;
+
+#define AUDIO_SHM_MAGIC 0x4d525053 /* "SPRM" */
+#define AUDIO_SHM_VERSION 1
+#define AUDIO_SHM_HEADER_SIZE 4096
+#define AUDIO_SHM_DEFAULT_CAPACITY (4 * 1024 * 1024)
+#define AUDIO_SHM_NAME_LENGTH 256
+
+/**
+Start of a shared memory ring, the PCM follows at headerSize. Byte i of the audio written since the ring was created
+is at headerSize + i % capacity, capacity is a power of two and a multiple of the page size, so a reader can map the
+audio twice in a row and read across the end of the ring in place. Everything is in native byte order.
+
+The fields from sequence on are a seqlock: sequence is odd while they change and while audio is written. A reader
+copies them while sequence is even and unchanged before and after, copies the audio from its cursor up to writeIndex
+and then copies the fields again. If writeIndex has moved more than capacity past the cursor the writer overtook it
+and the copied audio is not valid. The audio from
+formatIndex on has sampleRate and channels, written as 16 bit samples in whole frames. epoch is the playback clock
+epoch of the track, writtenAt and deliveredAt the uv_hrtime (CLOCK_MONOTONIC) in ns of the last write and of the
+delivery of its audio by libspotify.
+**/
+typedef struct audio_shm_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t capacity;
+  uint32_t sequence;
+  uint32_t sampleRate;
+  uint32_t channels;
+  int32_t epoch;
+  uint64_t formatIndex;
+  uint64_t writeIndex;
+  uint64_t frames;
+  uint64_t writtenAt;
+  uint64_t deliveredAt;
+} audio_shm_header_t;
+
+/**
+A shared memory ring and its writer. name is empty for an anonymous memfd, which readers get as an inherited fd or
+through /proc/<pid>/fd. The mutex serializes the writers.
+**/
+typedef struct audio_shm_ring {
+  int fd;
+  char name[AUDIO_SHM_NAME_LENGTH];
+  uint32_t capacity;
+  audio_shm_header_t* header;
+  unsigned char* data;
+  uv_mutex_t mutex;
+} audio_shm_ring_t;
+
+#define AUDIO_HTTP_TITLE_LENGTH 256
+#define AUDIO_HTTP_DEFAULT_BUFFER_SIZE (4 * 1024 * 1024)
+
+/**
+Settings of the HTTP sink. It listens on 127.0.0.1 at port, 0 for any free one. Every listener gets the audio as
+AUDIO_FILE_WAV or AUDIO_FILE_RAW from bufferSize bytes of audio shared by all of them, a listener that falls behind
+by that much is disconnected.
+**/
+typedef struct audio_http_options {
+  int port;
+  int format;
+  int maxListeners;
+  int bufferSize;
+} audio_http_options_t;
+
+/**
+What the HTTP sink reports, written by its thread. rejected counts the listeners turned away because maxListeners
+were connected, evicted the ones disconnected because they fell behind.
+**/
+typedef struct audio_http_stats {
+  int listeners;
+  int accepted;
+  int rejected;
+  int evicted;
+  int64_t bytesSent;
+} audio_http_stats_t;
+
+/**
+The HTTP sink. The titles of the current and the next track, by clock epoch, are set from the main thread under
+titleMutex and sent to listeners asking for ICY metadata.
+**/
+typedef struct audio_http_sink {
+  audio_http_options_t options;
+  audio_http_stats_t stats;
+  int listenFd;
+  int port;
+  uv_mutex_t titleMutex;
+  int titleVersion;
+  int titleEpochs[2];
+  char titles[2][AUDIO_HTTP_TITLE_LENGTH];
+} audio_http_sink_t;
+
+/**
+A ring of audio chunks. libspotify's delivery thread is the only producer, chunks are taken out
+by claiming the tail index with a compare and swap, so a flush from the main thread can race with
+the consumer without a lock. The mutex only protects the condition variable a native consumer sleeps on.
+A queue played by a native consumer has its own consumer thread, which runs until stopThread is set, to
+AUDIO_THREAD_HALT if what the consumer already took should still be played. sink is the
+state of the consumer, if it needs any. tapUsers counts the threads going through the taps, a tap is only gone once
+no thread uses it anymore.
+**/
 typedef struct audio_fifo {
-  TAILQ_HEAD(, audio_fifo_data) queue;
+  audio_fifo_data_t* slots[AUDIO_FIFO_SLOTS];
+  unsigned int head;
+  unsigned int tail;
   int samplesInQueue;
+  audio_clock_t clock;
+  audio_gain_t gain;
+  audio_telemetry_t telemetry;
+  audio_tap_t taps[AUDIO_MAX_TAPS];
+  int tapUsers;
+  audio_output_options_t outputOptions;
+  audio_output_stats_t outputStats;
+  int consumerWaiting;
+  int stopThread;
   uv_mutex_t audioQueueMutex;
-#ifdef NODE_SPOTIFY_NATIVE_SOUND
   uv_cond_t audioCondition;
-#endif
+  uv_thread_t consumerThread;
+  void (*consumer)(void* aux);
+  void* sink;
 } audio_fifo_t;
 
+/**
+Size classes of the chunk pool, in bytes of sample data, and how many chunks are preallocated per class.
+**/
+#define AUDIO_POOL_CLASSES 3
+#define AUDIO_POOL_CLASS_SIZES { 4096, 16384, 65536 }
+#define AUDIO_POOL_CLASS_CHUNKS { 64, 32, 16 }
+#define AUDIO_POOL_MAX_CHUNKS 64
+
+/**
+A set of preallocated audio chunks. Chunks are taken by the delivery thread and can be given back from any thread
+without locking. The pool is freed when its owner released it and the last chunk has come back, so buffers handed
+to JavaScript may outlive the audio handler.
+**/
+struct audio_pool {
+  char* memory[AUDIO_POOL_CLASSES];
+  size_t sampleBytes[AUDIO_POOL_CLASSES];
+  size_t stride[AUDIO_POOL_CLASSES];
+  int chunks[AUDIO_POOL_CLASSES];
+  int inUse[AUDIO_POOL_CLASSES][AUDIO_POOL_MAX_CHUNKS];
+  int refs;
+  int locked;
+  int chunksInUse;
+  unsigned int hits;
+  unsigned int misses;
+  int highWaterMark;
+};
+
+typedef struct audio_pool_stats {
+  unsigned int hits;
+  unsigned int misses;
+  int highWaterMark;
+  int chunksInUse;
+} audio_pool_stats_t;
+
+audio_pool_t* audio_pool_create(void);
+/**
+Drops the owner's reference to the pool.
+**/
+void audio_pool_release(audio_pool_t* pool);
+/**
+Keeps the chunks of the pool in RAM until it is freed. Returns 0 on success, -1 if mlock failed, e.g. because
+RLIMIT_MEMLOCK is too low.
+**/
+int audio_pool_lock(audio_pool_t* pool);
+void audio_pool_get_stats(audio_pool_t* pool, audio_pool_stats_t* stats);
+/**
+Gets a chunk with room for sampleBytes bytes of samples, from the pool if one fits and is free, from the heap
+otherwise. pool may be NULL.
+**/
+audio_fifo_data_t* audio_data_alloc(audio_pool_t* pool, size_t sampleBytes);
+/**
+Drops a reference to the chunk, the last one gives it back to its pool or frees it.
+**/
+void audio_data_free(audio_fifo_data_t* audioData);
+/**
+Takes another reference to the chunk.
+**/
+void audio_data_ref(audio_fifo_data_t* audioData);
+/**
+Returns a chunk with the same audio that only the caller references, the chunk itself if it is not shared.
+Drops the caller's reference to a shared chunk.
+**/
+audio_fifo_data_t* audio_data_unshare(audio_fifo_data_t* audioData);
+/**
+Applies the gain to a chunk taken out of the queue, see audio_gain_apply. Returns the chunk, or a private copy of it
+if it is shared with other sinks and had to be changed.
+**/
+audio_fifo_data_t* audio_data_apply_gain(audio_gain_t* gain, audio_fifo_data_t* audioData);
+
+/**
+Mixes two streams of interleaved samples with a gain per sample in Q15: dst = a * gainA + b * gainB, saturated.
+dst may be a or b. Uses AVX2, SSE2 or NEON if the CPU has it.
+**/
+void audio_dsp_mix(int16_t* dst, const int16_t* a, const int16_t* gainA, const int16_t* b, const int16_t* gainB,
+  int samples);
+/**
+Scales interleaved samples by a gain in Q15: dst = src * gain, saturated. dst may be src.
+**/
+void audio_dsp_gain(int16_t* dst, const int16_t* src, int16_t gain, int samples);
+/**
+Converts samples to floats between -1 and 1. dst must not overlap src.
+**/
+void audio_dsp_to_float(float* dst, const int16_t* src, int samples);
+/**
+Converts interleaved stereo samples to floats between -1 and 1, the left channel into left, the right one into right.
+**/
+void audio_dsp_to_float_stereo(float* left, float* right, const int16_t* src, int frames);
+/**
+Converts interleaved samples to floats between -1 and 1, stored channel after channel: the frames samples of the
+first channel, then those of the second and so on. dst must not overlap src.
+**/
+void audio_dsp_to_float_planar(float* dst, const int16_t* src, int frames, int channels);
+/**
+Two dot products of the same filter: outA = sum(filter * a), outB = sum(filter * b). a may be b.
+**/
+void audio_dsp_fir2(const float* filter, const float* a, const float* b, int taps, float* outA, float* outB);
+/**
+Name of the instruction set the audio_dsp functions use.
+**/
+const char* audio_dsp_name(void);
+
+void audio_resampler_init(audio_resampler_t* resampler, int outputRate, int quality);
+void audio_resampler_destroy(audio_resampler_t* resampler);
+/**
+Most frames audio_resample can put out for frames frames of input at inputRate.
+**/
+int audio_resampler_max_output(audio_resampler_t* resampler, int inputRate, int frames);
+/**
+Resamples interleaved input into interleaved stereo at the output rate and returns the number of frames written to
+dst. The end of the input stays in the filter until the next call. When the input rate, the channels or the epoch
+change the filter starts over, so audio of a track never leaks into the next one or into a seek.
+**/
+int audio_resample(audio_resampler_t* resampler, int16_t* dst, const int16_t* src, int frames, int inputRate,
+  int channels, int epoch);
+
+void audio_gain_init(audio_gain_t* gain);
+void audio_gain_set(audio_gain_t* gain, int target);
+/**
+Takes a changed target. Returns 0 if the gain is unity and audio_gain_apply would leave the samples alone. Only call
+it from the consumer.
+**/
+int audio_gain_begin(audio_gain_t* gain);
+/**
+Applies the gain to interleaved samples, ramping towards a changed target. Only call it from the consumer.
+**/
+void audio_gain_apply(audio_gain_t* gain, int16_t* samples, int frames, int channels, int sampleRate);
+
 extern void audio_fifo_flush(audio_fifo_t *audioFifo);
-#ifdef NODE_SPOTIFY_NATIVE_SOUND
 /**
-Initializes the native audio system and the condition variable.
+Moves the queued audio of from into audioFifo in the same order, together with the playback clock and the volume,
+so the sink of audioFifo goes on where the one of from stopped. Nothing else may use from meanwhile and nothing else
+may put into audioFifo.
+**/
+void audio_fifo_take_over(audio_fifo_t* audioFifo, audio_fifo_t* from);
+/**
+Puts every chunk that is put into audioFifo into tap as well. Only call it from the main thread. Returns -1 if all
+AUDIO_MAX_TAPS taps are in use.
+**/
+int audio_fifo_add_tap(audio_fifo_t* audioFifo, audio_fifo_t* tap, int policy, int capacity);
+/**
+Returns once the producer does not put into tap anymore.
+**/
+void audio_fifo_remove_tap(audio_fifo_t* audioFifo, audio_fifo_t* tap);
+/**
+0 if a tap with the BLOCK policy is full and the next chunk would be refused.
+**/
+int audio_fifo_taps_ready(audio_fifo_t* audioFifo, int sampleRate);
+/**
+Number of chunks that still fit into the queue. Only the producer can make it smaller.
+**/
+int audio_fifo_free_slots(audio_fifo_t* audioFifo);
+/**
+Puts audio data into the queue and its taps. Never blocks, returns 0 if the queue or a tap with the BLOCK policy
+is full.
+**/
+int audio_fifo_put(audio_fifo_t* audioFifo, audio_fifo_data_t* audioData);
+int audio_fifo_samples(audio_fifo_t* audioFifo);
+
+/**
+Starts a new epoch with zero frames played and returns it. Reset and next must only be called from one thread.
+**/
+int audio_clock_reset(audio_clock_t* clock);
+/**
+Starts a new delivery epoch for the next track while the sink keeps counting the current one, returns it.
+**/
+int audio_clock_next(audio_clock_t* clock);
+/**
+The epoch chunks are stamped with when they are delivered.
+**/
+int audio_clock_epoch(audio_clock_t* clock);
+/**
+Called by a sink when frames of a chunk of the given epoch have been played. Frames of older epochs are ignored,
+frames of a newer one that has been delivered start counting that epoch from zero.
+**/
+void audio_clock_advance(audio_clock_t* clock, int epoch, int frames, int sampleRate);
+/**
+Frames played in the played epoch, which is stored in epoch. sampleRate is set to the rate they were played at,
+0 if nothing was played yet.
+**/
+int64_t audio_clock_frames(audio_clock_t* clock, int* sampleRate, int* epoch);
+/**
+A sink asked for audio and the queue was empty.
+**/
+void audio_telemetry_starved(audio_fifo_t* audioFifo);
+void audio_telemetry_dropped(audio_fifo_t* audioFifo, int frames);
+/**
+Audio that was delivered for the queue but never got into it. Counted as delivered and dropped, so the telemetry
+adds up.
+**/
+void audio_telemetry_lost(audio_fifo_t* audioFifo, int frames);
+void audio_telemetry_latency(audio_fifo_t* audioFifo, int64_t microseconds);
+void audio_telemetry_get(audio_fifo_t* audioFifo, audio_telemetry_t* snapshot);
+/**
+Latency in ms that percent percent of the chunks stayed below, rounded up to the end of its bucket. 0 if no chunk
+was played yet.
+**/
+int audio_telemetry_percentile(const audio_telemetry_t* snapshot, int percent);
+/**
+Starts a consumer thread that runs consumer with the queue as its argument, with the scheduling options applied.
+sink is stored in the queue for the consumer. pool holds the chunks that are put into the queue.
+**/
+void audio_init_thread(audio_fifo_t* audioFifo, audio_pool_t* pool, const audio_output_options_t* options,
+  void (*consumer)(void* aux), void* sink);
+void audio_output_get_stats(audio_fifo_t* audioFifo, audio_output_stats_t* stats);
+/**
+Stops the consumer thread and throws away what is queued.
 **/
-void audio_init_native(audio_fifo_t *audioFifo);
 void audio_stop_native(audio_fifo_t* audioFifo);
+/**
+Stops the consumer thread once it played what it already took and keeps what is queued, e.g. to hand it to another
+queue. audio_stop_native still has to be called afterwards.
+**/
+void audio_halt_native(audio_fifo_t* audioFifo);
+/**
+Waits for the next chunk on the consumer thread. NULL once the thread should stop.
+**/
 audio_fifo_data_t* audio_get_native(audio_fifo_t* audioFifo);
+/**
+Like audio_get_native, but also returns NULL if no audio arrived within timeout ns.
+**/
+audio_fifo_data_t* audio_get_native_timed(audio_fifo_t* audioFifo, uint64_t timeout);
+/**
+Wakes up audio_get_native if it is waiting for data.
+**/
+void audio_signal_native(audio_fifo_t* audioFifo);
+/**
+Starts the consumer thread that writes the queue to the files set in the sink's options.
+**/
+void audio_init_file(audio_fifo_t* audioFifo, audio_pool_t* pool, audio_file_sink_t* sink,
+  const audio_output_options_t* options);
+void audio_file_get_stats(audio_file_sink_t* sink, audio_file_stats_t* stats);
+/**
+Fills in the canonical 44 byte header of a 16 bit PCM WAV file. Sizes that do not fit are set to the maximum, like
+other programs do for files above 4 GB and for streams of unknown length.
+**/
+void audio_wav_header(unsigned char* header, int sampleRate, int channels, int64_t dataBytes);
+/**
+Creates a ring of capacity bytes, a power of two and a multiple of the page size. With a name it is a POSIX shared
+memory object other processes can open by that name, otherwise an anonymous memfd that child processes inherit.
+Returns 0, or a negative errno if it could not be created.
+**/
+int audio_shm_open(audio_shm_ring_t* ring, const char* name, uint32_t capacity);
+/**
+Unmaps and closes the ring and removes its name. Readers that mapped it keep their mapping.
+**/
+void audio_shm_close(audio_shm_ring_t* ring);
+/**
+Appends the chunk to the ring, overwriting the oldest audio. Only one thread may write at a time.
+**/
+void audio_shm_write(audio_shm_ring_t* ring, const audio_fifo_data_t* audioData);
+/**
+Writes everything queued into the ring from the calling thread, with the volume applied, and counts it as played.
+**/
+void audio_shm_drain(audio_fifo_t* audioFifo, audio_shm_ring_t* ring);
+/**
+Opens the listening socket of the HTTP sink and sets its port. Returns 0, or a negative errno if the port could not
+be bound.
+**/
+int audio_http_listen(audio_http_sink_t* sink);
+/**
+Starts the consumer thread of the HTTP sink. It takes the audio out of the queue in real time and serves it to the
+listeners, audio_http_listen must have succeeded.
+**/
+void audio_init_http(audio_fifo_t* audioFifo, audio_pool_t* pool, audio_http_sink_t* sink,
+  const audio_output_options_t* options);
+/**
+Closes the listening socket, after the consumer thread was stopped.
+**/
+void audio_http_close(audio_http_sink_t* sink);
+/**
+Sets the title sent as ICY metadata while the audio of the clock epoch is streamed.
+**/
+void audio_http_set_title(audio_http_sink_t* sink, int epoch, const char* title);
+void audio_http_get_stats(audio_http_sink_t* sink, audio_http_stats_t* stats);
+#ifdef NODE_SPOTIFY_NATIVE_SOUND
+/**
+Starts the consumer thread that plays the queue on the sound device.
+**/
+void audio_init_native(audio_fifo_t *audioFifo, audio_pool_t* pool, const audio_output_options_t* options);
 void audio_start(void* aux);
 #endif
 
@@ -63,6 +663,10 @@ void audio_start(void* aux);
 Gets audio data from the queue
 **/
 audio_fifo_data_t* audio_get(audio_fifo_t* audioFifo);
+/**
+Returns the next audio data without removing it. Only safe on the thread that takes data out of the queue.
+**/
+audio_fifo_data_t* audio_peek(audio_fifo_t* audioFifo);
 void audio_init(audio_fifo_t* audioFifo);
 void audio_stop(audio_fifo_t* audioFifo);
 
@@ -0,0 +1,373 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* O_DIRECT, fallocate */
+#endif
+
+#include "audio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+Every write starts at a multiple of this and has a multiple of this as its length, as O_DIRECT needs it.
+**/
+#define AUDIO_FILE_ALIGNMENT 4096
+#define AUDIO_FILE_WRITE_SIZE (1024 * 1024)
+/**
+Without audio for this long what was written is made a complete file, e.g. after the last track.
+**/
+#define AUDIO_FILE_IDLE_NS 500000000ULL
+
+/**
+State of the thread writing the files. The buffer is always written at offset, which stays aligned: a block that is
+only partly filled when the file is completed is written padded and kept in the buffer, so the next write rewrites
+it with the audio that follows.
+**/
+typedef struct audio_file_writer {
+  audio_file_sink_t* sink;
+  int fd;
+  char* buffer;
+  int bufferSize;
+  int used;
+  int64_t offset;
+  int64_t allocated;
+  int64_t written;
+  int64_t dataBytes;
+  int sampleRate;
+  int channels;
+  int epoch;
+  int track;
+  int perTrack;
+  int opened;
+  int dirty;
+  int failed;
+} audio_file_writer_t;
+
+static void audio_file_put32(unsigned char* dst, uint32_t value) {
+  dst[0] = value & 0xff;
+  dst[1] = (value >> 8) & 0xff;
+  dst[2] = (value >> 16) & 0xff;
+  dst[3] = (value >> 24) & 0xff;
+}
+
+static void audio_file_put16(unsigned char* dst, uint16_t value) {
+  dst[0] = value & 0xff;
+  dst[1] = (value >> 8) & 0xff;
+}
+
+void audio_wav_header(unsigned char* header, int sampleRate, int channels, int64_t dataBytes) {
+  if(dataBytes > 0xffffffffLL - 36) {
+    dataBytes = 0xffffffffLL - 36;
+  }
+  memcpy(header, "RIFF", 4);
+  audio_file_put32(header + 4, (uint32_t)(36 + dataBytes));
+  memcpy(header + 8, "WAVEfmt ", 8);
+  audio_file_put32(header + 16, 16);
+  audio_file_put16(header + 20, 1);
+  audio_file_put16(header + 22, (uint16_t)channels);
+  audio_file_put32(header + 24, (uint32_t)sampleRate);
+  audio_file_put32(header + 28, (uint32_t)(sampleRate * channels * sizeof(int16_t)));
+  audio_file_put16(header + 32, (uint16_t)(channels * sizeof(int16_t)));
+  audio_file_put16(header + 34, 16);
+  memcpy(header + 36, "data", 4);
+  audio_file_put32(header + 40, (uint32_t)dataBytes);
+}
+
+static void audio_file_path(audio_file_writer_t* writer, char* path) {
+  const char* pattern = writer->sink->options.path;
+  const char* number = strstr(pattern, "%d");
+  if(number == NULL) {
+    snprintf(path, AUDIO_PATH_LENGTH, "%s", pattern);
+  } else {
+    snprintf(path, AUDIO_PATH_LENGTH, "%.*s%d%s", (int)(number - pattern), pattern, writer->track, number + 2);
+  }
+}
+
+static int audio_file_pwrite(int fd, const char* data, size_t length, int64_t offset) {
+  while(length > 0) {
+    ssize_t r = pwrite(fd, data, length, (off_t)offset);
+    if(r < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    data += r;
+    length -= r;
+    offset += r;
+  }
+  return 0;
+}
+
+static void audio_file_failed(audio_file_writer_t* writer, const char* what) {
+  fprintf(stderr, "audio: %s %s failed (%s), dropping the audio until the next track\n", what,
+    writer->sink->options.path, strerror(errno));
+  __atomic_fetch_add(&writer->sink->stats.writeErrors, 1, __ATOMIC_RELAXED);
+  close(writer->fd);
+  writer->fd = -1;
+  writer->failed = 1;
+}
+
+/**
+Reserves disk space ahead of the writes, without changing the size of the file. Turned off for good if the file
+system can't do it.
+**/
+static void audio_file_preallocate(audio_file_writer_t* writer, int64_t end) {
+  int64_t preallocate = writer->sink->options.preallocate;
+  if(preallocate <= 0 || end <= writer->allocated) {
+    return;
+  }
+#ifdef __linux__
+  if(fallocate(writer->fd, FALLOC_FL_KEEP_SIZE, (off_t)writer->allocated, (off_t)preallocate) == 0) {
+    writer->allocated += preallocate;
+    __atomic_store_n(&writer->sink->stats.preallocated, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  fprintf(stderr, "audio: Unable to preallocate %s (%s)\n", writer->sink->options.path, strerror(errno));
+#else
+  fprintf(stderr, "audio: Preallocating files is not supported on this system\n");
+#endif
+  writer->sink->options.preallocate = 0;
+}
+
+/**
+Writes the buffer. Unless complete is set only whole buffers are written, complete also writes the partly filled
+last block, padded to the alignment if the file is written directly, and cuts the padding off the file again.
+**/
+static int audio_file_flush(audio_file_writer_t* writer, int complete) {
+  int length = writer->used;
+  int64_t end = writer->offset + writer->used;
+  int padded = 0;
+  int whole;
+  if(writer->fd < 0 || length == 0 || (!complete && length < writer->bufferSize)) {
+    return 0;
+  }
+  if(writer->sink->stats.direct && length % AUDIO_FILE_ALIGNMENT != 0) {
+    padded = AUDIO_FILE_ALIGNMENT - length % AUDIO_FILE_ALIGNMENT;
+    memset(writer->buffer + length, 0, padded);
+    length += padded;
+  }
+  audio_file_preallocate(writer, writer->offset + length);
+  if(audio_file_pwrite(writer->fd, writer->buffer, length, writer->offset) < 0) {
+    audio_file_failed(writer, "Writing");
+    return -1;
+  }
+  if(padded > 0 && ftruncate(writer->fd, (off_t)end) < 0) {
+    audio_file_failed(writer, "Truncating");
+    return -1;
+  }
+  __atomic_fetch_add(&writer->sink->stats.writes, 1, __ATOMIC_RELAXED);
+  if(end > writer->written) {
+    __atomic_fetch_add(&writer->sink->stats.bytesWritten, end - writer->written, __ATOMIC_RELAXED);
+    writer->written = end;
+  }
+
+  whole = writer->used - writer->used % AUDIO_FILE_ALIGNMENT;
+  memmove(writer->buffer, writer->buffer + whole, writer->used - whole);
+  writer->offset += whole;
+  writer->used -= whole;
+  return 0;
+}
+
+/**
+Writes everything and patches the header, so the file is complete up to here.
+**/
+static void audio_file_complete(audio_file_writer_t* writer) {
+  unsigned char header[AUDIO_WAV_HEADER_SIZE];
+  if(writer->fd < 0 || !writer->dirty) {
+    return;
+  }
+  writer->dirty = 0;
+  if(writer->sink->options.format != AUDIO_FILE_WAV) {
+    audio_file_flush(writer, 1);
+    return;
+  }
+  audio_wav_header(header, writer->sampleRate, writer->channels, writer->dataBytes);
+  if(writer->offset == 0) {
+    //The header has not been written yet.
+    memcpy(writer->buffer, header, AUDIO_WAV_HEADER_SIZE);
+    audio_file_flush(writer, 1);
+    return;
+  }
+  if(audio_file_flush(writer, 1) < 0) {
+    return;
+  }
+#ifdef O_DIRECT
+  if(writer->sink->stats.direct) {
+    //44 bytes can't be written directly, only for the header the page cache is used.
+    fcntl(writer->fd, F_SETFL, fcntl(writer->fd, F_GETFL) & ~O_DIRECT);
+  }
+#endif
+  if(audio_file_pwrite(writer->fd, (const char*)header, AUDIO_WAV_HEADER_SIZE, 0) < 0) {
+    audio_file_failed(writer, "Writing the header of");
+    return;
+  }
+#ifdef O_DIRECT
+  if(writer->sink->stats.direct) {
+    fcntl(writer->fd, F_SETFL, fcntl(writer->fd, F_GETFL) | O_DIRECT);
+  }
+#endif
+}
+
+static void audio_file_close(audio_file_writer_t* writer) {
+  if(writer->fd < 0) {
+    return;
+  }
+  audio_file_complete(writer);
+  if(writer->fd >= 0) {
+    //Gives back the disk space that was reserved beyond the end.
+    if(writer->allocated > 0 && ftruncate(writer->fd, (off_t)(writer->offset + writer->used)) < 0) {
+      fprintf(stderr, "audio: Unable to give back the space preallocated for %s\n", writer->sink->options.path);
+    }
+    close(writer->fd);
+    writer->fd = -1;
+  }
+}
+
+static int audio_file_open(audio_file_writer_t* writer, audio_fifo_data_t* audioData) {
+  char path[AUDIO_PATH_LENGTH];
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  int direct = writer->sink->options.direct;
+  writer->track++;
+  audio_file_path(writer, path);
+#ifdef O_DIRECT
+  writer->fd = direct ? open(path, flags | O_DIRECT, 0644) : -1;
+  if(writer->fd < 0 && direct && errno == EINVAL) {
+    fprintf(stderr, "audio: The file system of %s does not support direct writes\n", path);
+  }
+#else
+  writer->fd = -1;
+#endif
+  if(writer->fd < 0) {
+    direct = 0;
+    writer->fd = open(path, flags, 0644);
+  }
+  if(writer->fd < 0) {
+    fprintf(stderr, "audio: Unable to open %s (%s), dropping the audio until the next track\n", path, strerror(errno));
+    __atomic_fetch_add(&writer->sink->stats.openFailures, 1, __ATOMIC_RELAXED);
+    writer->failed = 1;
+    return -1;
+  }
+#if defined(F_NOCACHE) && !defined(O_DIRECT)
+  if(writer->sink->options.direct && fcntl(writer->fd, F_NOCACHE, 1) == 0) {
+    direct = 1;
+  }
+#endif
+  __atomic_store_n(&writer->sink->stats.direct, direct, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&writer->sink->stats.files, 1, __ATOMIC_RELAXED);
+  writer->opened = 1;
+  writer->offset = 0;
+  writer->allocated = 0;
+  writer->written = 0;
+  writer->dataBytes = 0;
+  writer->sampleRate = audioData->sampleRate;
+  writer->channels = audioData->channels;
+  writer->used = 0;
+  if(writer->sink->options.format == AUDIO_FILE_WAV) {
+    //Filled in once the size is known.
+    memset(writer->buffer, 0, AUDIO_WAV_HEADER_SIZE);
+    writer->used = AUDIO_WAV_HEADER_SIZE;
+  }
+  return 0;
+}
+
+static void audio_file_append(audio_file_writer_t* writer, audio_fifo_data_t* audioData) {
+  const char* samples = (const char*)audioData->samples;
+  int bytes = audioData->numberOfSamples * audioData->channels * sizeof(int16_t);
+  writer->dataBytes += bytes;
+  writer->dirty = 1;
+  while(bytes > 0 && writer->fd >= 0) {
+    int n = writer->bufferSize - writer->used < bytes ? writer->bufferSize - writer->used : bytes;
+    memcpy(writer->buffer + writer->used, samples, n);
+    writer->used += n;
+    samples += n;
+    bytes -= n;
+    audio_file_flush(writer, 0);
+  }
+}
+
+/**
+The consumer thread. Writes as fast as the disk allows, the audio counts as played once it is in the buffer.
+A new epoch is a new track, or the same track after a seek.
+**/
+static void audio_file_start(void* aux) {
+  audio_fifo_t* audioFifo = aux;
+  audio_file_writer_t writer;
+  audio_fifo_data_t* audioData;
+  void* buffer;
+
+  memset(&writer, 0, sizeof(writer));
+  writer.sink = audioFifo->sink;
+  writer.fd = -1;
+  writer.epoch = -1;
+  writer.perTrack = strstr(writer.sink->options.path, "%d") != NULL;
+  writer.bufferSize = writer.sink->options.writeSize > 0 ? writer.sink->options.writeSize : AUDIO_FILE_WRITE_SIZE;
+  if(posix_memalign(&buffer, AUDIO_FILE_ALIGNMENT, writer.bufferSize) != 0) {
+    fprintf(stderr, "audio: Unable to allocate the file buffer\n");
+    return;
+  }
+  writer.buffer = buffer;
+
+  for(;;) {
+    audioData = audio_get_native_timed(audioFifo, AUDIO_FILE_IDLE_NS);
+    if(audioData == NULL) {
+      if(__atomic_load_n(&audioFifo->stopThread, __ATOMIC_ACQUIRE)) {
+        break;
+      }
+      audio_file_complete(&writer);
+      continue;
+    }
+
+    if(audioData->epoch != writer.epoch) {
+      if(writer.perTrack) {
+        audio_file_close(&writer);
+      } else {
+        audio_file_complete(&writer);
+      }
+      writer.epoch = audioData->epoch;
+      //Opening the one file again would truncate the tracks written before.
+      writer.failed = writer.failed && !writer.perTrack && writer.opened;
+    }
+    if(writer.fd >= 0 && (audioData->sampleRate != writer.sampleRate || audioData->channels != writer.channels)) {
+      if(writer.perTrack) {
+        audio_file_close(&writer);
+      } else if(!writer.failed) {
+        fprintf(stderr, "audio: The audio format changed, set outputRate to write tracks of different formats "
+          "into one file\n");
+        writer.failed = 1;
+      }
+    }
+    if(writer.fd < 0 && !writer.failed) {
+      audio_file_open(&writer, audioData);
+    }
+
+    if(writer.fd >= 0 && !writer.failed) {
+      audio_file_append(&writer, audioData);
+    } else {
+      audio_telemetry_dropped(audioFifo, audioData->numberOfSamples);
+    }
+    audio_clock_advance(&audioFifo->clock, audioData->epoch, audioData->numberOfSamples, audioData->sampleRate);
+    audio_data_free(audioData);
+  }
+  audio_file_close(&writer);
+  free(buffer);
+}
+
+void audio_init_file(audio_fifo_t* audioFifo, audio_pool_t* pool, audio_file_sink_t* sink,
+  const audio_output_options_t* options) {
+  memset(&sink->stats, 0, sizeof(audio_file_stats_t));
+  audio_init_thread(audioFifo, pool, options, audio_file_start, sink);
+}
+
+void audio_file_get_stats(audio_file_sink_t* sink, audio_file_stats_t* stats) {
+  stats->bytesWritten = __atomic_load_n(&sink->stats.bytesWritten, __ATOMIC_RELAXED);
+  stats->writes = __atomic_load_n(&sink->stats.writes, __ATOMIC_RELAXED);
+  stats->files = __atomic_load_n(&sink->stats.files, __ATOMIC_RELAXED);
+  stats->openFailures = __atomic_load_n(&sink->stats.openFailures, __ATOMIC_RELAXED);
+  stats->writeErrors = __atomic_load_n(&sink->stats.writeErrors, __ATOMIC_RELAXED);
+  stats->direct = __atomic_load_n(&sink->stats.direct, __ATOMIC_RELAXED);
+  stats->preallocated = __atomic_load_n(&sink->stats.preallocated, __ATOMIC_RELAXED);
+}
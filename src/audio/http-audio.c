@@ -0,0 +1,684 @@
+#include "audio.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/**
+The thread sleeps at most this long, so it notices audio that arrived in an empty queue and a stop in time.
+**/
+#define AUDIO_HTTP_TICK_MS 20
+/**
+A new listener starts this far back in the audio that was streamed, so its player can fill its buffer at once.
+**/
+#define AUDIO_HTTP_BURST_MS 1000
+#define AUDIO_HTTP_ICY_METAINT 16000
+#define AUDIO_HTTP_REQUEST_SIZE 4096
+#define AUDIO_HTTP_REQUEST_TIMEOUT_NS 5000000000ULL
+#define AUDIO_HTTP_OUT_SIZE 32768
+/**
+Room for the size line and the end of a chunk of the chunked transfer encoding.
+**/
+#define AUDIO_HTTP_CHUNK_HEAD 10
+#define AUDIO_HTTP_CHUNK_TAIL 2
+#define AUDIO_HTTP_TITLE_HISTORY 4
+
+#define AUDIO_HTTP_REQUEST 0
+#define AUDIO_HTTP_WAITING 1
+#define AUDIO_HTTP_STREAMING 2
+#define AUDIO_HTTP_CLOSING 3
+
+/**
+A connected listener. out holds what is sent next: the response, or body bytes copied from the ring with the chunk
+framing and the ICY metadata already in between, so a send that only goes through partly just continues there.
+cursor is the next byte of the ring to copy, the listener is done at end, where the audio format changes.
+**/
+typedef struct audio_http_client {
+  int fd;
+  int state;
+  uint64_t connectedAt;
+  int requestLength;
+  int outStart;
+  int outEnd;
+  int http11;
+  int chunked;
+  int icy;
+  int untilMetadata;
+  int titleSent;
+  unsigned char prefix[AUDIO_WAV_HEADER_SIZE];
+  int prefixLength;
+  int prefixSent;
+  uint64_t cursor;
+  uint64_t end;
+  char request[AUDIO_HTTP_REQUEST_SIZE];
+  char out[AUDIO_HTTP_OUT_SIZE];
+} audio_http_client_t;
+
+/**
+A title and the position in the ring from which it applies.
+**/
+typedef struct audio_http_title {
+  uint64_t index;
+  int generation;
+  char text[AUDIO_HTTP_TITLE_LENGTH];
+} audio_http_title_t;
+
+/**
+State of the consumer thread. The ring holds the last capacity bytes of audio written, byte i at i % capacity, and
+only this thread touches it, the listeners all read from it with their own cursor. Audio from formatIndex on has
+sampleRate and channels. A chunk is taken out of the queue once it is due, paced by the frames written since
+paceStart.
+**/
+typedef struct audio_http_server {
+  audio_fifo_t* audioFifo;
+  audio_http_sink_t* sink;
+  unsigned char* ring;
+  uint64_t capacity;
+  uint64_t writeIndex;
+  uint64_t formatIndex;
+  int sampleRate;
+  int channels;
+  int epoch;
+  int titleVersion;
+  audio_http_title_t titles[AUDIO_HTTP_TITLE_HISTORY];
+  int titleCount;
+  audio_http_client_t* clients;
+  int clientCount;
+  audio_fifo_data_t* due;
+  uint64_t paceStart;
+  int64_t paceFrames;
+  int paceRate;
+} audio_http_server_t;
+
+static void audio_http_close_client(audio_http_server_t* server, int i) {
+  audio_http_client_t* client = &server->clients[i];
+  if(client->state == AUDIO_HTTP_WAITING || client->state == AUDIO_HTTP_STREAMING) {
+    __atomic_fetch_sub(&server->sink->stats.listeners, 1, __ATOMIC_RELAXED);
+  }
+  close(client->fd);
+  //Keeps the array dense, the last client takes the place.
+  if(i != server->clientCount - 1) {
+    memcpy(client, &server->clients[server->clientCount - 1], sizeof(audio_http_client_t));
+  }
+  server->clientCount--;
+}
+
+static void audio_http_respond(audio_http_client_t* client, const char* status) {
+  client->outStart = 0;
+  client->outEnd = snprintf(client->out, AUDIO_HTTP_OUT_SIZE, "HTTP/1.0 %s\r\nConnection: close\r\n"
+    "Content-Length: 0\r\n\r\n", status);
+  client->state = AUDIO_HTTP_CLOSING;
+}
+
+/**
+Sends what is in out. Returns -1 if the listener is gone.
+**/
+static int audio_http_send(audio_http_server_t* server, audio_http_client_t* client) {
+  while(client->outStart < client->outEnd) {
+    ssize_t sent = send(client->fd, client->out + client->outStart, client->outEnd - client->outStart, MSG_NOSIGNAL);
+    if(sent < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    client->outStart += sent;
+    __atomic_fetch_add(&server->sink->stats.bytesSent, sent, __ATOMIC_RELAXED);
+  }
+  return 0;
+}
+
+/**
+The title of the audio at index, or NULL if there is none yet.
+**/
+static const audio_http_title_t* audio_http_title_at(audio_http_server_t* server, uint64_t index) {
+  const audio_http_title_t* title = NULL;
+  int i;
+  for(i = 0; i < server->titleCount; i++) {
+    if(server->titles[i].index <= index) {
+      title = &server->titles[i];
+    }
+  }
+  return title;
+}
+
+/**
+Appends an ICY metadata block to out. Only a changed title is sent, otherwise the block is empty.
+**/
+static int audio_http_metadata(audio_http_server_t* server, audio_http_client_t* client, char* dst, int room) {
+  const audio_http_title_t* title = audio_http_title_at(server, client->cursor);
+  int length, blocks;
+  if(title == NULL || title->generation == client->titleSent) {
+    if(room < 1) {
+      return -1;
+    }
+    dst[0] = 0;
+    return 1;
+  }
+  length = (int)strlen("StreamTitle='';") + (int)strlen(title->text);
+  blocks = (length + 15) / 16;
+  if(room < 1 + blocks * 16) {
+    return -1;
+  }
+  dst[0] = (char)blocks;
+  memset(dst + 1, 0, blocks * 16);
+  memcpy(dst + 1, "StreamTitle='", 13);
+  memcpy(dst + 14, title->text, strlen(title->text));
+  memcpy(dst + 14 + strlen(title->text), "';", 2);
+  client->titleSent = title->generation;
+  return 1 + blocks * 16;
+}
+
+/**
+Fills out with the next body bytes of a streaming listener, the WAV header first and then the audio from the ring,
+with the ICY metadata in between and as one chunk if the transfer encoding is chunked. Returns the number of body
+bytes, 0 if there is nothing to send yet.
+**/
+static int audio_http_fill(audio_http_server_t* server, audio_http_client_t* client) {
+  char* body = client->out + (client->chunked ? AUDIO_HTTP_CHUNK_HEAD : 0);
+  int room = AUDIO_HTTP_OUT_SIZE - AUDIO_HTTP_CHUNK_HEAD - AUDIO_HTTP_CHUNK_TAIL;
+  uint64_t available = (client->end < server->writeIndex ? client->end : server->writeIndex) - client->cursor;
+  int length = 0;
+
+  client->outStart = 0;
+  client->outEnd = 0;
+  while(room > length) {
+    int n = room - length;
+    if(client->icy && client->untilMetadata == 0) {
+      int metadata = audio_http_metadata(server, client, body + length, room - length);
+      if(metadata < 0) {
+        break;
+      }
+      length += metadata;
+      client->untilMetadata = AUDIO_HTTP_ICY_METAINT;
+      continue;
+    }
+    if(client->icy && n > client->untilMetadata) {
+      n = client->untilMetadata;
+    }
+    if(client->prefixSent < client->prefixLength) {
+      if(n > client->prefixLength - client->prefixSent) {
+        n = client->prefixLength - client->prefixSent;
+      }
+      memcpy(body + length, client->prefix + client->prefixSent, n);
+      client->prefixSent += n;
+    } else {
+      uint64_t offset = client->cursor % server->capacity;
+      if((uint64_t)n > available) {
+        n = (int)available;
+      }
+      if((uint64_t)n > server->capacity - offset) {
+        n = (int)(server->capacity - offset);
+      }
+      if(n == 0) {
+        break;
+      }
+      memcpy(body + length, server->ring + offset, n);
+      client->cursor += n;
+      available -= n;
+    }
+    length += n;
+    if(client->icy) {
+      client->untilMetadata -= n;
+    }
+  }
+  if(length == 0 || !client->chunked) {
+    client->outEnd = length;
+    return length;
+  }
+  {
+    char head[AUDIO_HTTP_CHUNK_HEAD + 1];
+    int headLength = snprintf(head, sizeof(head), "%x\r\n", length);
+    client->outStart = AUDIO_HTTP_CHUNK_HEAD - headLength;
+    memcpy(client->out + client->outStart, head, headLength);
+    memcpy(body + length, "\r\n", AUDIO_HTTP_CHUNK_TAIL);
+    client->outEnd = AUDIO_HTTP_CHUNK_HEAD + length + AUDIO_HTTP_CHUNK_TAIL;
+  }
+  return length;
+}
+
+/**
+Starts streaming to a listener waiting for the format: the response headers, the WAV header and the audio from a
+burst before the newest.
+**/
+static void audio_http_start_stream(audio_http_server_t* server, audio_http_client_t* client) {
+  uint64_t frameBytes = (uint64_t)server->channels * sizeof(int16_t);
+  uint64_t burst = (uint64_t)server->sampleRate * AUDIO_HTTP_BURST_MS / 1000 * frameBytes;
+  int wav = server->sink->options.format == AUDIO_FILE_WAV;
+
+  if(burst > server->writeIndex - server->formatIndex) {
+    burst = server->writeIndex - server->formatIndex;
+  }
+  if(burst > server->capacity / 2) {
+    burst = server->capacity / 2 / frameBytes * frameBytes;
+  }
+  client->cursor = server->writeIndex - burst;
+  client->end = UINT64_MAX;
+  client->chunked = client->http11 && !client->icy;
+  client->untilMetadata = AUDIO_HTTP_ICY_METAINT;
+  client->titleSent = 0;
+  client->prefixSent = 0;
+  client->prefixLength = 0;
+  if(wav) {
+    audio_wav_header(client->prefix, server->sampleRate, server->channels, INT64_MAX);
+    client->prefixLength = AUDIO_WAV_HEADER_SIZE;
+  }
+  client->outStart = 0;
+  client->outEnd = snprintf(client->out, AUDIO_HTTP_OUT_SIZE, "%s 200 OK\r\n"
+    "Content-Type: %s\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "X-Sample-Rate: %d\r\n"
+    "X-Channels: %d\r\n"
+    "%s%s\r\n",
+    client->http11 ? "HTTP/1.1" : "HTTP/1.0", wav ? "audio/wav" : "application/octet-stream",
+    server->sampleRate, server->channels, client->chunked ? "Transfer-Encoding: chunked\r\n" : "",
+    client->icy ? "icy-name: node-spotify\r\nicy-metaint: 16000\r\n" : "");
+  client->state = AUDIO_HTTP_STREAMING;
+}
+
+/**
+Parses the request once it is complete. Any path streams the audio, with ICY metadata if the request asks for it.
+**/
+static void audio_http_parse(audio_http_server_t* server, audio_http_client_t* client) {
+  char* line;
+  char* next;
+  client->request[client->requestLength] = '\0';
+  if(strstr(client->request, "\r\n\r\n") == NULL) {
+    if(client->requestLength == AUDIO_HTTP_REQUEST_SIZE - 1) {
+      audio_http_respond(client, "431 Request Header Fields Too Large");
+    }
+    return;
+  }
+  if(strncmp(client->request, "GET ", 4) != 0) {
+    audio_http_respond(client, "405 Method Not Allowed");
+    return;
+  }
+  line = client->request;
+  next = strstr(line, "\r\n");
+  *next = '\0';
+  client->http11 = strstr(line, " HTTP/1.1") != NULL;
+  for(line = next + 2; (next = strstr(line, "\r\n")) != NULL && next != line; line = next + 2) {
+    *next = '\0';
+    if(strncasecmp(line, "Icy-MetaData:", 13) == 0) {
+      client->icy = atoi(line + 13) == 1;
+    }
+  }
+  client->state = AUDIO_HTTP_WAITING;
+  __atomic_fetch_add(&server->sink->stats.listeners, 1, __ATOMIC_RELAXED);
+  if(server->sampleRate > 0) {
+    audio_http_start_stream(server, client);
+  }
+}
+
+static void audio_http_accept(audio_http_server_t* server) {
+  audio_http_sink_t* sink = server->sink;
+  int fd;
+  while((fd = accept(sink->listenFd, NULL, NULL)) >= 0) {
+    audio_http_client_t* client;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    {
+      int on = 1;
+      setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    }
+#endif
+    if(server->clientCount == sink->options.maxListeners) {
+      static const char busy[] = "HTTP/1.0 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+      //Best effort, the listener is closed either way.
+      if(send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL) < 0) {
+        errno = 0;
+      }
+      close(fd);
+      __atomic_fetch_add(&sink->stats.rejected, 1, __ATOMIC_RELAXED);
+      continue;
+    }
+    client = &server->clients[server->clientCount++];
+    memset(client, 0, offsetof(audio_http_client_t, request));
+    client->fd = fd;
+    client->state = AUDIO_HTTP_REQUEST;
+    client->connectedAt = uv_hrtime();
+    __atomic_fetch_add(&sink->stats.accepted, 1, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+Reads from a listener: the request, and afterwards only whether it hung up. Returns -1 if it is gone.
+**/
+static int audio_http_read(audio_http_server_t* server, audio_http_client_t* client) {
+  char discard[512];
+  for(;;) {
+    ssize_t r;
+    if(client->state == AUDIO_HTTP_REQUEST) {
+      r = recv(client->fd, client->request + client->requestLength,
+        AUDIO_HTTP_REQUEST_SIZE - 1 - client->requestLength, 0);
+    } else {
+      r = recv(client->fd, discard, sizeof(discard), 0);
+    }
+    if(r == 0) {
+      return -1;
+    }
+    if(r < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    if(client->state == AUDIO_HTTP_REQUEST) {
+      client->requestLength += r;
+      audio_http_parse(server, client);
+    }
+  }
+}
+
+/**
+Sends to every listener as much as it takes and disconnects the ones that are done or gone.
+**/
+static void audio_http_serve(audio_http_server_t* server) {
+  int i = 0;
+  while(i < server->clientCount) {
+    audio_http_client_t* client = &server->clients[i];
+    int gone = 0;
+    if(client->state == AUDIO_HTTP_STREAMING || client->state == AUDIO_HTTP_CLOSING) {
+      for(;;) {
+        if(audio_http_send(server, client) < 0) {
+          gone = 1;
+          break;
+        }
+        if(client->outStart < client->outEnd) {
+          break;
+        }
+        if(client->state == AUDIO_HTTP_CLOSING || (client->cursor == client->end && !client->chunked)) {
+          //Responded, or streamed up to a change of the format the listener can't follow.
+          gone = 1;
+          break;
+        }
+        if(client->cursor == client->end) {
+          //The last chunk, so the listener knows the stream is complete.
+          client->outStart = 0;
+          client->outEnd = snprintf(client->out, AUDIO_HTTP_OUT_SIZE, "0\r\n\r\n");
+          client->state = AUDIO_HTTP_CLOSING;
+          __atomic_fetch_sub(&server->sink->stats.listeners, 1, __ATOMIC_RELAXED);
+          continue;
+        }
+        if(audio_http_fill(server, client) == 0) {
+          break;
+        }
+      }
+    } else if(client->state == AUDIO_HTTP_REQUEST && uv_hrtime() - client->connectedAt > AUDIO_HTTP_REQUEST_TIMEOUT_NS) {
+      gone = 1;
+    }
+    if(gone) {
+      audio_http_close_client(server, i);
+    } else {
+      i++;
+    }
+  }
+}
+
+/**
+Looks up the title of the epoch if the epoch or the titles changed and remembers from where in the ring it applies.
+**/
+static void audio_http_update_title(audio_http_server_t* server, int epoch) {
+  audio_http_sink_t* sink = server->sink;
+  int version = __atomic_load_n(&sink->titleVersion, __ATOMIC_ACQUIRE);
+  char text[AUDIO_HTTP_TITLE_LENGTH] = "";
+  audio_http_title_t* title;
+  int i;
+  if(epoch == server->epoch && version == server->titleVersion) {
+    return;
+  }
+  server->epoch = epoch;
+  server->titleVersion = version;
+  uv_mutex_lock(&sink->titleMutex);
+  for(i = 0; i < 2; i++) {
+    if(sink->titleEpochs[i] == epoch) {
+      memcpy(text, sink->titles[i], AUDIO_HTTP_TITLE_LENGTH);
+    }
+  }
+  uv_mutex_unlock(&sink->titleMutex);
+  if(server->titleCount > 0 && strcmp(server->titles[server->titleCount - 1].text, text) == 0) {
+    return;
+  }
+  if(server->titleCount == AUDIO_HTTP_TITLE_HISTORY) {
+    memmove(server->titles, server->titles + 1, sizeof(audio_http_title_t) * (AUDIO_HTTP_TITLE_HISTORY - 1));
+    server->titleCount--;
+  }
+  title = &server->titles[server->titleCount++];
+  title->index = server->writeIndex;
+  title->generation = server->titleCount > 1 ? server->titles[server->titleCount - 2].generation + 1 : 1;
+  memcpy(title->text, text, AUDIO_HTTP_TITLE_LENGTH);
+}
+
+/**
+Writes a chunk into the ring. Listeners that would lose audio they have not sent yet are disconnected first, and
+listeners of another format are ended where the format changes.
+**/
+static void audio_http_write(audio_http_server_t* server, audio_fifo_data_t* audioData) {
+  const unsigned char* samples = (const unsigned char*)audioData->samples;
+  uint64_t bytes = (uint64_t)audioData->numberOfSamples * audioData->channels * sizeof(int16_t);
+  int i = 0;
+
+  if(audioData->sampleRate != server->sampleRate || audioData->channels != server->channels) {
+    for(i = 0; i < server->clientCount; i++) {
+      if(server->clients[i].state == AUDIO_HTTP_STREAMING && server->clients[i].end == UINT64_MAX) {
+        server->clients[i].end = server->writeIndex;
+      }
+    }
+    server->formatIndex = server->writeIndex;
+    server->sampleRate = audioData->sampleRate;
+    server->channels = audioData->channels;
+  }
+  audio_http_update_title(server, audioData->epoch);
+  i = 0;
+  while(i < server->clientCount) {
+    audio_http_client_t* client = &server->clients[i];
+    if(client->state == AUDIO_HTTP_STREAMING && client->cursor < client->end &&
+      server->writeIndex + bytes - client->cursor > server->capacity) {
+      __atomic_fetch_add(&server->sink->stats.evicted, 1, __ATOMIC_RELAXED);
+      audio_http_close_client(server, i);
+      continue;
+    }
+    i++;
+  }
+  if(bytes > server->capacity) {
+    samples += bytes - server->capacity;
+    server->writeIndex += bytes - server->capacity;
+    bytes = server->capacity;
+  }
+  while(bytes > 0) {
+    uint64_t offset = server->writeIndex % server->capacity;
+    uint64_t n = bytes < server->capacity - offset ? bytes : server->capacity - offset;
+    memcpy(server->ring + offset, samples, n);
+    samples += n;
+    bytes -= n;
+    server->writeIndex += n;
+  }
+  for(i = 0; i < server->clientCount; i++) {
+    if(server->clients[i].state == AUDIO_HTTP_WAITING) {
+      audio_http_start_stream(server, &server->clients[i]);
+    }
+  }
+}
+
+/**
+Takes the chunks out of the queue that are due by now, in real time like a sound card would. Returns how many ms
+until the next one is due, at most AUDIO_HTTP_TICK_MS.
+**/
+static int audio_http_pace(audio_http_server_t* server) {
+  audio_fifo_t* audioFifo = server->audioFifo;
+  for(;;) {
+    uint64_t now = uv_hrtime();
+    uint64_t dueAt;
+    audio_fifo_data_t* audioData = server->due;
+    if(audioData == NULL && (audioData = audio_get(audioFifo)) == NULL) {
+      //Ran empty, the audio that comes next is due at once instead of making up for the wait.
+      if(server->paceRate != 0) {
+        audio_telemetry_starved(audioFifo);
+      }
+      server->paceRate = 0;
+      return AUDIO_HTTP_TICK_MS;
+    }
+    server->due = audioData;
+    if(audioData->sampleRate != server->paceRate) {
+      server->paceRate = audioData->sampleRate;
+      server->paceStart = now;
+      server->paceFrames = 0;
+    }
+    dueAt = server->paceStart + (uint64_t)(server->paceFrames * 1000000000LL / server->paceRate);
+    if(dueAt > now) {
+      uint64_t wait = (dueAt - now + 999999) / 1000000;
+      return wait < AUDIO_HTTP_TICK_MS ? (int)wait : AUDIO_HTTP_TICK_MS;
+    }
+    server->due = NULL;
+    server->paceFrames += audioData->numberOfSamples;
+    audio_http_write(server, audioData);
+    audio_clock_advance(&audioFifo->clock, audioData->epoch, audioData->numberOfSamples, audioData->sampleRate);
+    audio_data_free(audioData);
+  }
+}
+
+/**
+The consumer thread. Waits in poll for the listeners and wakes up at least every AUDIO_HTTP_TICK_MS for the audio.
+**/
+static void audio_http_start(void* aux) {
+  audio_fifo_t* audioFifo = aux;
+  audio_http_sink_t* sink = audioFifo->sink;
+  audio_http_server_t server;
+  struct pollfd* fds;
+  int i;
+
+  memset(&server, 0, sizeof(server));
+  server.audioFifo = audioFifo;
+  server.sink = sink;
+  server.capacity = sink->options.bufferSize;
+  server.epoch = -1;
+  server.titleVersion = -1;
+  server.ring = malloc(server.capacity);
+  server.clients = malloc(sizeof(audio_http_client_t) * sink->options.maxListeners);
+  fds = malloc(sizeof(struct pollfd) * (sink->options.maxListeners + 1));
+  if(server.ring == NULL || server.clients == NULL || fds == NULL) {
+    fprintf(stderr, "audio: Unable to allocate the buffers of the HTTP server\n");
+    free(server.ring);
+    free(server.clients);
+    free(fds);
+    return;
+  }
+
+  while(!__atomic_load_n(&audioFifo->stopThread, __ATOMIC_ACQUIRE)) {
+    int timeout = audio_http_pace(&server);
+    audio_http_serve(&server);
+    fds[0].fd = sink->listenFd;
+    fds[0].events = POLLIN;
+    for(i = 0; i < server.clientCount; i++) {
+      audio_http_client_t* client = &server.clients[i];
+      fds[i + 1].fd = client->fd;
+      fds[i + 1].events = POLLIN | (client->outStart < client->outEnd ? POLLOUT : 0);
+      fds[i + 1].revents = 0;
+    }
+    if(poll(fds, server.clientCount + 1, timeout) <= 0) {
+      continue;
+    }
+    //Backwards, closing a client moves the last one into its place.
+    for(i = server.clientCount - 1; i >= 0; i--) {
+      if((fds[i + 1].revents & (POLLIN | POLLERR | POLLHUP)) && audio_http_read(&server, &server.clients[i]) < 0) {
+        audio_http_close_client(&server, i);
+      }
+    }
+    if(fds[0].revents & POLLIN) {
+      audio_http_accept(&server);
+    }
+  }
+  if(server.due != NULL) {
+    //Already out of the queue, a halted thread can't give it back to the next handler.
+    audio_clock_advance(&audioFifo->clock, server.due->epoch, server.due->numberOfSamples, server.due->sampleRate);
+    audio_data_free(server.due);
+  }
+  while(server.clientCount > 0) {
+    audio_http_close_client(&server, server.clientCount - 1);
+  }
+  free(server.ring);
+  free(server.clients);
+  free(fds);
+}
+
+int audio_http_listen(audio_http_sink_t* sink) {
+  struct sockaddr_in address;
+  socklen_t length = sizeof(address);
+  int on = 1;
+  int error;
+
+  memset(&sink->stats, 0, sizeof(audio_http_stats_t));
+  sink->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if(sink->listenFd < 0) {
+    return -errno;
+  }
+  setsockopt(sink->listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons((uint16_t)sink->options.port);
+  if(bind(sink->listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(sink->listenFd, 16) != 0 ||
+    getsockname(sink->listenFd, (struct sockaddr*)&address, &length) != 0) {
+    error = -errno;
+    close(sink->listenFd);
+    sink->listenFd = -1;
+    return error;
+  }
+  fcntl(sink->listenFd, F_SETFL, fcntl(sink->listenFd, F_GETFL) | O_NONBLOCK);
+  fcntl(sink->listenFd, F_SETFD, FD_CLOEXEC);
+  sink->port = ntohs(address.sin_port);
+  sink->titleVersion = 0;
+  sink->titleEpochs[0] = -1;
+  sink->titleEpochs[1] = -1;
+  uv_mutex_init(&sink->titleMutex);
+  return 0;
+}
+
+void audio_init_http(audio_fifo_t* audioFifo, audio_pool_t* pool, audio_http_sink_t* sink,
+  const audio_output_options_t* options) {
+  audio_init_thread(audioFifo, pool, options, audio_http_start, sink);
+}
+
+void audio_http_close(audio_http_sink_t* sink) {
+  if(sink->listenFd >= 0) {
+    close(sink->listenFd);
+    sink->listenFd = -1;
+    uv_mutex_destroy(&sink->titleMutex);
+  }
+}
+
+void audio_http_set_title(audio_http_sink_t* sink, int epoch, const char* title) {
+  int slot;
+  uv_mutex_lock(&sink->titleMutex);
+  //The title of the older epoch goes, the other one is still streamed or the next to come.
+  slot = sink->titleEpochs[0] == epoch || (sink->titleEpochs[1] != epoch && sink->titleEpochs[0] < sink->titleEpochs[1])
+    ? 0 : 1;
+  sink->titleEpochs[slot] = epoch;
+  snprintf(sink->titles[slot], AUDIO_HTTP_TITLE_LENGTH, "%s", title);
+  uv_mutex_unlock(&sink->titleMutex);
+  __atomic_fetch_add(&sink->titleVersion, 1, __ATOMIC_RELEASE);
+}
+
+void audio_http_get_stats(audio_http_sink_t* sink, audio_http_stats_t* stats) {
+  stats->listeners = __atomic_load_n(&sink->stats.listeners, __ATOMIC_RELAXED);
+  stats->accepted = __atomic_load_n(&sink->stats.accepted, __ATOMIC_RELAXED);
+  stats->rejected = __atomic_load_n(&sink->stats.rejected, __ATOMIC_RELAXED);
+  stats->evicted = __atomic_load_n(&sink->stats.evicted, __ATOMIC_RELAXED);
+  stats->bytesSent = __atomic_load_n(&sink->stats.bytesSent, __ATOMIC_RELAXED);
+}
@@ -38,25 +38,36 @@
 
 #define NUM_BUFFERS 3
 
-extern int audio_stopThread;
+/* What is queued in each buffer, to advance the clock once it was played */
+static int bufferEpoch[NUM_BUFFERS];
+static int bufferFrames[NUM_BUFFERS];
+static int bufferRate[NUM_BUFFERS];
+
+static void remember_buffer(int index, audio_fifo_data_t *audioData) {
+  bufferEpoch[index] = audioData->epoch;
+  bufferFrames[index] = audioData->numberOfSamples;
+  bufferRate[index] = audioData->sampleRate;
+}
 
 static void error_exit(const char *msg) {
   puts(msg);
   exit(1);
 }
 
-static int queue_buffer(ALuint source, audio_fifo_t *audioFifo, ALuint buffer) {
+static int queue_buffer(ALuint source, audio_fifo_t *audioFifo, ALuint* buffers, int index) {
+  ALuint buffer = buffers[index];
   audio_fifo_data_t *audioData = audio_get_native(audioFifo);
   if(audioData == NULL) {
     return 0;
   }
+  remember_buffer(index, audioData);
   alBufferData(buffer,
     audioData->channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16,
     audioData->samples,
     audioData->numberOfSamples * audioData->channels * sizeof(short),
     audioData->sampleRate);
   alSourceQueueBuffers(source, 1, &buffer);
-  free(audioData);
+  audio_data_free(audioData);
   return 1;
 }
 
@@ -72,7 +83,8 @@ void audio_start(void *aux) {
   ALenum error;
   ALint rate;
   ALint channels;
-  device = alcOpenDevice(NULL); /* Use the default device */
+  /* An empty device name is the default device */
+  device = alcOpenDevice(audioFifo->outputOptions.device[0] ? audioFifo->outputOptions.device : NULL);
   if (!device) {
     error_exit("failed to open device");
   }
@@ -85,16 +97,16 @@ void audio_start(void *aux) {
 
   /* First prebuffer some audio */
   int prebuffer = 1;
-  prebuffer = queue_buffer(source, audioFifo, buffers[0]);
+  prebuffer = queue_buffer(source, audioFifo, buffers, 0);
   if(prebuffer == 1) {
-    prebuffer = queue_buffer(source, audioFifo, buffers[1]);
+    prebuffer = queue_buffer(source, audioFifo, buffers, 1);
   }
   if(prebuffer == 1) {
-    prebuffer = queue_buffer(source, audioFifo, buffers[2]);
+    prebuffer = queue_buffer(source, audioFifo, buffers, 2);
   }
-  for (;!audio_stopThread;) {
+  for (;!audioFifo->stopThread;) {
     alSourcePlay(source);
-    for (;!audio_stopThread;) {
+    for (;!audioFifo->stopThread;) {
       /* Wait for some audio to play */
       do {
         alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
@@ -103,6 +115,8 @@ void audio_start(void *aux) {
 
       /* Remove old audio from the queue.. */
       alSourceUnqueueBuffers(source, 1, &buffers[frame % NUM_BUFFERS]);
+      audio_clock_advance(&audioFifo->clock, bufferEpoch[frame % NUM_BUFFERS],
+        bufferFrames[frame % NUM_BUFFERS], bufferRate[frame % NUM_BUFFERS]);
 
       /* and queue some more audio */
       audioData = audio_get_native(audioFifo);
@@ -122,7 +136,7 @@ void audio_start(void *aux) {
       alGetBufferi(buffers[frame % NUM_BUFFERS], AL_CHANNELS, &channels);
       if (audioData->sampleRate != rate || audioData->channels != channels) {
         printf("rate or channel count changed, resetting\n");
-        free(audioData);
+        audio_data_free(audioData);
         break;
       }
       alBufferData(buffers[frame % NUM_BUFFERS],
@@ -130,7 +144,8 @@ void audio_start(void *aux) {
              audioData->samples,
              audioData->numberOfSamples * audioData->channels * sizeof(short),
              audioData->sampleRate);
-      free(audioData);
+      remember_buffer(frame % NUM_BUFFERS, audioData);
+      audio_data_free(audioData);
       alSourceQueueBuffers(source, 1, &buffers[frame % NUM_BUFFERS]);
 
       if ((error = alcGetError(device)) != AL_NO_ERROR) {
@@ -139,7 +154,7 @@ void audio_start(void *aux) {
       }
       frame++;
     }
-    if(!audio_stopThread) {
+    if(!audioFifo->stopThread) {
       /* Format or rate changed, so we need to reset all buffers */
       alSourcei(source, AL_BUFFER, 0);
       alSourceStop(source);
@@ -150,10 +165,11 @@ void audio_start(void *aux) {
              audioData->samples,
              audioData->numberOfSamples * audioData->channels * sizeof(short),
              audioData->sampleRate);
+      remember_buffer(0, audioData);
 
       alSourceQueueBuffers(source, 1, &buffers[0]);
-      queue_buffer(source, audioFifo, buffers[1]);
-      queue_buffer(source, audioFifo, buffers[2]);
+      queue_buffer(source, audioFifo, buffers, 1);
+      queue_buffer(source, audioFifo, buffers, 2);
       frame = 0;
     }
   }
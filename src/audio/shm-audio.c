@@ -0,0 +1,145 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* memfd_create */
+#endif
+
+#include "audio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+Creates the shared memory object, by name or anonymous. Returns the fd or a negative errno.
+**/
+static int audio_shm_create(audio_shm_ring_t* ring) {
+  int fd;
+#ifdef MFD_CLOEXEC
+  if(ring->name[0] == '\0') {
+    //Not close on exec, child processes are meant to inherit it.
+    fd = memfd_create("node-spotify-audio", 0);
+    return fd < 0 ? -errno : fd;
+  }
+#endif
+  if(ring->name[0] == '\0') {
+    //No memfd, an object nobody can open by its name once it is unlinked is just as anonymous.
+    char name[AUDIO_SHM_NAME_LENGTH];
+    snprintf(name, sizeof(name), "/node-spotify-%d-%p", (int)getpid(), (void*)ring);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd >= 0) {
+      shm_unlink(name);
+    }
+    return fd < 0 ? -errno : fd;
+  }
+  fd = shm_open(ring->name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  return fd < 0 ? -errno : fd;
+}
+
+int audio_shm_open(audio_shm_ring_t* ring, const char* name, uint32_t capacity) {
+  size_t size = AUDIO_SHM_HEADER_SIZE + (size_t)capacity;
+  void* memory;
+  int error;
+
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+  if(capacity == 0 || (capacity & (capacity - 1)) != 0 || capacity % AUDIO_SHM_HEADER_SIZE != 0) {
+    return -EINVAL;
+  }
+  if(name != NULL) {
+    if(strlen(name) >= AUDIO_SHM_NAME_LENGTH) {
+      return -ENAMETOOLONG;
+    }
+    strcpy(ring->name, name);
+  }
+  if((ring->fd = audio_shm_create(ring)) < 0) {
+    error = ring->fd;
+    ring->fd = -1;
+    return error;
+  }
+  if(ftruncate(ring->fd, (off_t)size) != 0) {
+    error = -errno;
+    audio_shm_close(ring);
+    return error;
+  }
+  memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+  if(memory == MAP_FAILED) {
+    error = -errno;
+    audio_shm_close(ring);
+    return error;
+  }
+  ring->capacity = capacity;
+  ring->header = memory;
+  ring->data = (unsigned char*)memory + AUDIO_SHM_HEADER_SIZE;
+  ring->header->headerSize = AUDIO_SHM_HEADER_SIZE;
+  ring->header->capacity = capacity;
+  ring->header->version = AUDIO_SHM_VERSION;
+  //Last, a reader that sees the magic sees a complete header.
+  __atomic_store_n(&ring->header->magic, AUDIO_SHM_MAGIC, __ATOMIC_RELEASE);
+  uv_mutex_init(&ring->mutex);
+  return 0;
+}
+
+void audio_shm_close(audio_shm_ring_t* ring) {
+  if(ring->header != NULL) {
+    munmap(ring->header, AUDIO_SHM_HEADER_SIZE + (size_t)ring->capacity);
+    ring->header = NULL;
+    uv_mutex_destroy(&ring->mutex);
+  }
+  if(ring->fd >= 0) {
+    close(ring->fd);
+    ring->fd = -1;
+    if(ring->name[0] != '\0') {
+      shm_unlink(ring->name);
+    }
+  }
+}
+
+void audio_shm_write(audio_shm_ring_t* ring, const audio_fifo_data_t* audioData) {
+  audio_shm_header_t* header = ring->header;
+  const unsigned char* samples = (const unsigned char*)audioData->samples;
+  size_t bytes = (size_t)audioData->numberOfSamples * audioData->channels * sizeof(int16_t);
+  uint64_t writeIndex = header->writeIndex;
+  uint64_t end = writeIndex + bytes;
+  uint32_t sequence = header->sequence;
+  size_t offset, first;
+
+  //A chunk larger than the ring only leaves its end.
+  if(bytes > ring->capacity) {
+    samples += bytes - ring->capacity;
+    writeIndex += bytes - ring->capacity;
+    bytes = ring->capacity;
+  }
+  //Odd while the audio is written too, it overwrites the oldest audio a reader may be copying.
+  __atomic_store_n(&header->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  offset = (size_t)(writeIndex & (ring->capacity - 1));
+  first = bytes < ring->capacity - offset ? bytes : ring->capacity - offset;
+  memcpy(ring->data + offset, samples, first);
+  memcpy(ring->data, samples + first, bytes - first);
+  if(header->sampleRate != (uint32_t)audioData->sampleRate || header->channels != (uint32_t)audioData->channels) {
+    header->formatIndex = header->writeIndex;
+    header->sampleRate = audioData->sampleRate;
+    header->channels = audioData->channels;
+  }
+  header->epoch = audioData->epoch;
+  header->frames += audioData->numberOfSamples;
+  header->writtenAt = uv_hrtime();
+  header->deliveredAt = audioData->deliveredAt;
+  __atomic_store_n(&header->writeIndex, end, __ATOMIC_RELAXED);
+  __atomic_store_n(&header->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+void audio_shm_drain(audio_fifo_t* audioFifo, audio_shm_ring_t* ring) {
+  audio_fifo_data_t* audioData;
+  uv_mutex_lock(&ring->mutex);
+  while((audioData = audio_get(audioFifo))) {
+    audioData = audio_data_apply_gain(&audioFifo->gain, audioData);
+    audio_shm_write(ring, audioData);
+    audio_clock_advance(&audioFifo->clock, audioData->epoch, audioData->numberOfSamples, audioData->sampleRate);
+    audio_data_free(audioData);
+  }
+  uv_mutex_unlock(&ring->mutex);
+}
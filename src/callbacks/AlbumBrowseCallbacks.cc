@@ -1,8 +1,13 @@
 #include "AlbumBrowseCallbacks.h"
+#include "../Engine.h"
 #include "../objects/spotify/Album.h"
 
 void AlbumBrowseCallbacks::albumBrowseComplete(sp_albumbrowse* result, void* userdata) {
   Album* album = static_cast<Album*>(userdata);
+  if(!Engine::onMainThread()) {
+    Engine::post(album, [=]() { albumBrowseComplete(result, userdata); });
+    return;
+  }
   if(album->nodeObject != nullptr) {
     album->nodeObject->callBrowseComplete();
   }
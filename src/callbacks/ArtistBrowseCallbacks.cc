@@ -1,8 +1,13 @@
 #include "ArtistBrowseCallbacks.h"
+#include "../Engine.h"
 #include "../objects/spotify/Artist.h"
 
 void ArtistBrowseCallbacks::artistBrowseComplete(sp_artistbrowse* result, void* userdata) {
   Artist* artist = static_cast<Artist*>(userdata);
+  if(!Engine::onMainThread()) {
+    Engine::post(artist, [=]() { artistBrowseComplete(result, userdata); });
+    return;
+  }
   if(artist->nodeObject != nullptr) {
     artist->nodeObject->callBrowseComplete();
   }
@@ -1,4 +1,5 @@
 #include "PlaylistCallbacksHolder.h"
+#include "../Engine.h"
 #include "../objects/node/NodeTrackExtended.h"
 #include "../objects/node/NodeUser.h"
 #include "../objects/spotify/TrackExtended.h"
@@ -6,12 +7,16 @@
 #include "../objects/spotify/User.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 PlaylistCallbacksHolder::PlaylistCallbacksHolder(node::ObjectWrap* _userdata, sp_playlist* _playlist) : userdata(_userdata), playlist(_playlist) {
   playlistCallbacks = new sp_playlist_callbacks();
 }
 
 PlaylistCallbacksHolder::~PlaylistCallbacksHolder() {
+  SessionLock sessionLock;
+  Engine::forget(this);
   sp_playlist_remove_callbacks(playlist, playlistCallbacks, this);
   delete playlistCallbacks;
 }
@@ -22,23 +27,50 @@ void PlaylistCallbacksHolder::call(std::unique_ptr<NanCallback>& callback, std::
   callback->Call(argc, argv);
 }
 
+static void releaseTracks(std::vector<sp_track*>* tracks) {
+  for(sp_track* track : *tracks) {
+    sp_track_release(track);
+  }
+  delete tracks;
+}
+
+/**
+ * On the engine thread the callbacks are queued to call themselves again on the main thread. Arguments that are only
+ * valid during the callback are copied, libspotify objects are referenced until the queued call is done or forgotten.
+ **/
 void PlaylistCallbacksHolder::playlistRenamed(sp_playlist* spPlaylist, void* userdata) {
   auto holder = static_cast<PlaylistCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    Engine::post(holder, [=]() { playlistRenamed(spPlaylist, userdata); });
+    return;
+  }
   holder->call(holder->playlistRenamedCallback, { NanUndefined(), NanObjectWrapHandle(holder->userdata) });
 }
 
 void PlaylistCallbacksHolder::tracksAdded(sp_playlist* spPlaylist, sp_track *const *tracks, int num_tracks, int position, void *userdata) {
   auto holder = static_cast<PlaylistCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    std::shared_ptr<std::vector<sp_track*>> addedTracks(new std::vector<sp_track*>(tracks, tracks + num_tracks), releaseTracks);
+    for(sp_track* track : *addedTracks) {
+      sp_track_add_ref(track);
+    }
+    Engine::post(holder, [=]() { tracksAdded(spPlaylist, addedTracks->data(), num_tracks, position, userdata); });
+    return;
+  }
   Handle<Array> nodeTracks = NanNew<Array>(num_tracks);
   for(int i = 0; i < num_tracks; i++) {
-    NodeTrack* nodeTrackExtended = new NodeTrackExtended(std::make_shared<TrackExtended>(tracks[i], spPlaylist, position + i));
-    nodeTracks->Set(NanNew<Number>(i), nodeTrackExtended->createInstance());
+    nodeTracks->Set(NanNew<Number>(i), NodeTrackExtended::fromCache(std::make_shared<TrackExtended>(tracks[i], spPlaylist, position + i)));
   }
   holder->call(holder->tracksAddedCallback, { NanUndefined(), NanObjectWrapHandle(holder->userdata), nodeTracks, NanNew<Number>(position) });
 }
 
 void PlaylistCallbacksHolder::tracksMoved(sp_playlist* spPlaylist, const int* tracks, int num_tracks, int new_position, void *userdata) {
   auto holder = static_cast<PlaylistCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    std::vector<int> movedTracks(tracks, tracks + num_tracks);
+    Engine::post(holder, [=]() { tracksMoved(spPlaylist, movedTracks.data(), num_tracks, new_position, userdata); });
+    return;
+  }
   Handle<Array> movedTrackIndices = NanNew<Array>(num_tracks);
   for(int i = 0; i < num_tracks; i++) {
     movedTrackIndices->Set(NanNew<Number>(i), NanNew<Number>(tracks[i]));
@@ -48,6 +80,11 @@ void PlaylistCallbacksHolder::tracksMoved(sp_playlist* spPlaylist, const int* tr
 
 void PlaylistCallbacksHolder::tracksRemoved(sp_playlist* spPlaylist, const int *tracks, int num_tracks, void *userdata) {
   auto holder = static_cast<PlaylistCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    std::vector<int> removedTracks(tracks, tracks + num_tracks);
+    Engine::post(holder, [=]() { tracksRemoved(spPlaylist, removedTracks.data(), num_tracks, userdata); });
+    return;
+  }
   Handle<Array> removedTrackIndexes = NanNew<Array>(num_tracks);
   for(int i = 0; i < num_tracks; i++) {
     removedTrackIndexes->Set(NanNew<Number>(i), NanNew<Number>(tracks[i]));
@@ -57,18 +94,33 @@ void PlaylistCallbacksHolder::tracksRemoved(sp_playlist* spPlaylist, const int *
 
 void PlaylistCallbacksHolder::trackCreatedChanged(sp_playlist* spPlaylist, int position, sp_user* spUser, int when, void* userdata) {
   auto holder = static_cast<PlaylistCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    sp_user_add_ref(spUser);
+    std::shared_ptr<sp_user> user(spUser, &sp_user_release);
+    Engine::post(holder, [=]() { trackCreatedChanged(spPlaylist, position, user.get(), when, userdata); });
+    return;
+  }
   double date = (double)when * 1000;
-  NodeUser* nodeUser = new NodeUser(std::unique_ptr<User>(new User(spUser)));
-  holder->call(holder->trackCreatedChangedCallback, { NanUndefined(), NanObjectWrapHandle(holder->userdata), NanNew<Integer>(position), NanObjectWrapHandle(nodeUser), NanNew<Date>(date) });
+  Handle<Object> nodeUser = NodeUser::fromCache(std::unique_ptr<User>(new User(spUser)));
+  holder->call(holder->trackCreatedChangedCallback, { NanUndefined(), NanObjectWrapHandle(holder->userdata), NanNew<Integer>(position), nodeUser, NanNew<Date>(date) });
 }
 
 void PlaylistCallbacksHolder::trackSeenChanged(sp_playlist* spPlaylist, int position, bool seen, void* userdata) {
   auto holder = static_cast<PlaylistCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    Engine::post(holder, [=]() { trackSeenChanged(spPlaylist, position, seen, userdata); });
+    return;
+  }
   holder->call(holder->trackSeenChangedCallback, { NanUndefined(), NanObjectWrapHandle(holder->userdata), NanNew<Integer>(position), NanNew<Boolean>(seen) });
 }
 
 void PlaylistCallbacksHolder::trackMessageChanged(sp_playlist* spPlaylist, int position, const char* message, void* userdata) {
   auto holder = static_cast<PlaylistCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    std::string text(message != nullptr ? message : "");
+    Engine::post(holder, [=]() { trackMessageChanged(spPlaylist, position, text.c_str(), userdata); });
+    return;
+  }
   holder->call(holder->trackMessageChangedCallback, { NanUndefined(), NanObjectWrapHandle(holder->userdata), NanNew<Integer>(position), NanNew<String>(message) });
 }
 
@@ -1,4 +1,5 @@
 #include "PlaylistContainerCallbacksHolder.h"
+#include "../Engine.h"
 #include "../objects/node/NodePlaylist.h"
 #include "../objects/node/NodePlaylistFolder.h"
 #include "../objects/spotify/Playlist.h"
@@ -11,6 +12,8 @@ PlaylistContainerCallbacksHolder::PlaylistContainerCallbacksHolder(sp_playlistco
   }
 
 PlaylistContainerCallbacksHolder::~PlaylistContainerCallbacksHolder() {
+  SessionLock sessionLock;
+  Engine::forget(this);
   sp_playlistcontainer_remove_callbacks(playlistContainer, playlistContainerCallbacks, this);
   delete playlistContainerCallbacks;
 }
@@ -23,17 +26,30 @@ void PlaylistContainerCallbacksHolder::call(std::unique_ptr<NanCallback>& callba
 
 void PlaylistContainerCallbacksHolder::playlistAdded(sp_playlistcontainer* pc, sp_playlist* spPlaylist, int position, void* userdata) {
   auto holder = static_cast<PlaylistContainerCallbacksHolder*>(userdata);
+  //The container may have changed by the time a queued call runs, read it now.
   sp_playlist_type playlistType = sp_playlistcontainer_playlist_type(pc, position);
-  std::shared_ptr<PlaylistBase> playlistBase;
+  std::string folderName;
+  if(playlistType == SP_PLAYLIST_TYPE_START_FOLDER) {
+    char buf[256];
+    sp_playlistcontainer_playlist_folder_name(pc, position, buf, 256);
+    folderName = buf;
+  }
+  if(!Engine::onMainThread()) {
+    sp_playlist_add_ref(spPlaylist);
+    std::shared_ptr<sp_playlist> playlist(spPlaylist, &sp_playlist_release);
+    Engine::post(holder, [=]() { holder->callPlaylistAdded(playlist.get(), playlistType, folderName, position); });
+    return;
+  }
+  holder->callPlaylistAdded(spPlaylist, playlistType, folderName, position);
+}
+
+void PlaylistContainerCallbacksHolder::callPlaylistAdded(sp_playlist* spPlaylist, sp_playlist_type playlistType, const std::string& folderName, int position) {
   Handle<Object> playlistV8;
   if(playlistType == SP_PLAYLIST_TYPE_PLAYLIST) {
-    playlistBase = Playlist::fromCache(spPlaylist);
     NodeWrapped<NodePlaylist>* nodePlaylist = new NodePlaylist(Playlist::fromCache(spPlaylist));
     playlistV8 = nodePlaylist->createInstance();
   } else if(playlistType == SP_PLAYLIST_TYPE_START_FOLDER) {
-    char buf[256];
-    sp_playlistcontainer_playlist_folder_name(pc, position, buf, 256);
-    NodeWrapped<NodePlaylistFolder>* nodePlaylist = new NodePlaylistFolder(std::make_shared<PlaylistFolder>(buf, playlistType));
+    NodeWrapped<NodePlaylistFolder>* nodePlaylist = new NodePlaylistFolder(std::make_shared<PlaylistFolder>(folderName, playlistType));
     playlistV8 = nodePlaylist->createInstance();
   } else if(playlistType == SP_PLAYLIST_TYPE_END_FOLDER) {
     NodeWrapped<NodePlaylistFolder>* nodePlaylist = new NodePlaylistFolder(std::make_shared<PlaylistFolder>(playlistType));
@@ -41,11 +57,15 @@ void PlaylistContainerCallbacksHolder::playlistAdded(sp_playlistcontainer* pc, s
   } else {
     return;
   }
-  holder->call(holder->playlistAddedCallback, {NanUndefined(), playlistV8, NanNew<Number>(position)});
+  call(playlistAddedCallback, {NanUndefined(), playlistV8, NanNew<Number>(position)});
 }
 
 void PlaylistContainerCallbacksHolder::playlistRemoved(sp_playlistcontainer* pc, sp_playlist* spPlaylist, int position, void *userdata) {
   auto holder = static_cast<PlaylistContainerCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    Engine::post(holder, [=]() { playlistRemoved(pc, spPlaylist, position, userdata); });
+    return;
+  }
   node::ObjectWrap* nodePlaylist = nullptr; //FIXME what??
   if(nodePlaylist != nullptr) {
     holder->call(holder->playlistRemovedCallback, {NanUndefined(), NanNew<Number>(position), NanObjectWrapHandle(nodePlaylist)});
@@ -56,6 +76,10 @@ void PlaylistContainerCallbacksHolder::playlistRemoved(sp_playlistcontainer* pc,
 
 void PlaylistContainerCallbacksHolder::playlistMoved(sp_playlistcontainer* pc, sp_playlist* spPlaylist, int position, int new_position, void *userdata) {
   auto holder = static_cast<PlaylistContainerCallbacksHolder*>(userdata);
+  if(!Engine::onMainThread()) {
+    Engine::post(holder, [=]() { playlistMoved(pc, spPlaylist, position, new_position, userdata); });
+    return;
+  }
   node::ObjectWrap* nodePlaylist = nullptr; //FIXME what?
   if(nodePlaylist != nullptr) {
     holder->call(holder->playlistMovedCallback, {NanUndefined(), NanNew<Number>(position), NanNew<Number>(new_position), NanObjectWrapHandle(nodePlaylist)});
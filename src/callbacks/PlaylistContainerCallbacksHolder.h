@@ -7,6 +7,7 @@
 #include <libspotify/api.h>
 #include <nan.h>
 #include <memory>
+#include <string>
 
 class PlaylistContainerCallbacksHolder {
 private:
@@ -14,6 +15,7 @@ private:
   sp_playlistcontainer_callbacks* playlistContainerCallbacks;
   node::ObjectWrap* userdata;
   void call(std::unique_ptr<NanCallback>& callback, std::initializer_list<v8::Handle<v8::Value>> args);
+  void callPlaylistAdded(sp_playlist* spPlaylist, sp_playlist_type playlistType, const std::string& folderName, int position);
 public:
   PlaylistContainerCallbacksHolder(sp_playlistcontainer* pc, node::ObjectWrap* userdata);
   ~PlaylistContainerCallbacksHolder();
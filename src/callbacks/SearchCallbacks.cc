@@ -1,7 +1,12 @@
 #include "SearchCallbacks.h"
+#include "../Engine.h"
 #include "../objects/spotify/Search.h"
 
 void SearchCallbacks::searchComplete(sp_search* spSearch, void* userdata) {
   Search* search = static_cast<Search*>(userdata);
+  if(!Engine::onMainThread()) {
+    Engine::post(search, [=]() { searchComplete(spSearch, userdata); });
+    return;
+  }
   search->nodeObject->callBrowseComplete();
 }
\ No newline at end of file
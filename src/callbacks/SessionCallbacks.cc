@@ -1,8 +1,11 @@
 #include "SessionCallbacks.h"
 #include "../Application.h"
+#include "../Engine.h"
+#include "../objects/node/LoadWatcher.h"
 #include "../objects/spotify/PlaylistContainer.h"
 #include "../objects/spotify/Player.h"
 
+#include <atomic>
 #include <string.h>
 #include <uv.h>
 #include <node_version.h>
@@ -14,23 +17,39 @@ static void handleNotify(uv_async_t* handle);
 #else
 static void handleNotify(uv_async_t* handle, int status);
 #endif
+static void pumpEvents();
 
 static sp_playlistcontainer_callbacks rootPlaylistContainerCallbacks;
 //Timer to call sp_session_process_events after a timeout
 static std::unique_ptr<uv_timer_t> processEventsTimer;
 static std::unique_ptr<uv_async_t> notifyHandle;
+//Runs the next pump once the event loop had a turn, when a pump used up its budget
+static std::unique_ptr<uv_idle_t> yieldHandle;
+//Merges the metadata_updated notifications until the JS callback is called
+static std::unique_ptr<uv_timer_t> metadataTimer;
+static int pendingMetadataUpdates = 0;
+//Notifications on the engine thread that were not handed to the main thread yet
+static std::atomic<int> engineMetadataUpdates(0);
 
 std::unique_ptr<NanCallback> SessionCallbacks::loginCallback;
 std::unique_ptr<NanCallback> SessionCallbacks::logoutCallback;
 std::unique_ptr<NanCallback> SessionCallbacks::metadataUpdatedCallback;
 std::unique_ptr<NanCallback> SessionCallbacks::endOfTrackCallback;
 std::unique_ptr<NanCallback> SessionCallbacks::playTokenLostCallback;
+int SessionCallbacks::metadataInterval = 0;
+int SessionCallbacks::metadataNotifications = 0;
+int SessionCallbacks::metadataDispatches = 0;
 
 void SessionCallbacks::init() {
   processEventsTimer = std::unique_ptr<uv_timer_t>(new uv_timer_t());
   notifyHandle = std::unique_ptr<uv_async_t>(new uv_async_t());
+  yieldHandle = std::unique_ptr<uv_idle_t>(new uv_idle_t());
+  metadataTimer = std::unique_ptr<uv_timer_t>(new uv_timer_t());
   uv_async_init(uv_default_loop(), notifyHandle.get(), handleNotify);
   uv_timer_init(uv_default_loop(), processEventsTimer.get());
+  uv_idle_init(uv_default_loop(), yieldHandle.get());
+  uv_timer_init(uv_default_loop(), metadataTimer.get());
+  initAudio();
 }
 
 /**
@@ -38,19 +57,35 @@ void SessionCallbacks::init() {
  **/
 #if NODE_VERSION_AT_LEAST(0, 11, 0)
 static void processEventsTimeout(uv_timer_t* timer) {
-  handleNotify(notifyHandle.get());
+  pumpEvents();
 }
 #else
 static void processEventsTimeout(uv_timer_t* timer, int status) {
-  handleNotify(notifyHandle.get(), 0);
+  pumpEvents();
 }
 #endif
 
+/**
+ * Like setImmediate, an active idle handle keeps the loop from blocking in poll. I/O callbacks that were waiting
+ * run before the pump goes on.
+ **/
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+static void handleYield(uv_idle_t* handle) {
+#else
+static void handleYield(uv_idle_t* handle, int status) {
+#endif
+  pumpEvents();
+}
+
 
 /**
  * This is a callback function that will be called by spotify.
  **/
 void SessionCallbacks::notifyMainThread(sp_session* session) {
+  if(Engine::isThreaded()) {
+    Engine::notify();
+    return;
+  }
   //effectively calls handleNotify in another thread
   uv_async_send(notifyHandle.get());
 }
@@ -64,26 +99,90 @@ static void handleNotify(uv_async_t* handle) {
 #else
 static void handleNotify(uv_async_t* handle, int status) {
 #endif
+  pumpEvents();
+}
+
+/**
+ * Calls sp_session_process_events until libspotify wants to be called again later. After the pump budget it
+ * yields to the event loop and goes on in the next turn.
+ **/
+static void pumpEvents() {
   uv_timer_stop(processEventsTimer.get()); //a new timeout will be set at the end
+  uv_idle_stop(yieldHandle.get());
+  uint64_t start = uv_hrtime();
+  uint64_t budget = (uint64_t)Engine::pumpBudget() * 1000000;
   int nextTimeout = 0;
+  int iterations = 0;
+  bool yielded = false;
   while(nextTimeout == 0) {
     sp_session_process_events(application->session, &nextTimeout);
+    iterations++;
+    if(nextTimeout == 0 && budget > 0 && uv_hrtime() - start >= budget) {
+      yielded = true;
+      break;
+    }
+  }
+  Engine::recordPump(uv_hrtime() - start, iterations, yielded);
+  if(yielded) {
+    uv_idle_start(yieldHandle.get(), handleYield);
+  } else {
+    uv_timer_start(processEventsTimer.get(), &processEventsTimeout, nextTimeout, 0);
   }
-  uv_timer_start(processEventsTimer.get(), &processEventsTimeout, nextTimeout, 0);
 }
 
 void SessionCallbacks::metadata_updated(sp_session* session) {
+  if(!Engine::onMainThread()) {
+    //Only the first notification since the last hand over queues a call, it takes all of them.
+    if(engineMetadataUpdates++ == 0) {
+      Engine::post(nullptr, []() { mergeMetadataUpdates(engineMetadataUpdates.exchange(0)); });
+    }
+    return;
+  }
+  mergeMetadataUpdates(1);
+}
+
+/**
+ * Calls the JS callback once for all notifications since the last call, with their number. Then hands the objects
+ * from spotify.waitForLoaded that are loaded now to their callbacks.
+ **/
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+static void dispatchMetadataUpdated(uv_timer_t* timer) {
+#else
+static void dispatchMetadataUpdated(uv_timer_t* timer, int status) {
+#endif
+  SessionLock sessionLock;
+  int notifications = pendingMetadataUpdates;
+  pendingMetadataUpdates = 0;
+  SessionCallbacks::metadataDispatches++;
+  if(SessionCallbacks::metadataUpdatedCallback && !SessionCallbacks::metadataUpdatedCallback->IsEmpty()) {
+    v8::Handle<v8::Value> argv[1] = { NanNew<v8::Integer>(notifications) };
+    SessionCallbacks::metadataUpdatedCallback->Call(1, argv);
+  }
+  LoadWatcher::check();
+}
+
+/**
+ * libspotify notifies about metadata thousands of times a second while a library loads. The JS callback is called
+ * once per metadataInterval ms for all of them, with 0 in the next turn of the loop.
+ **/
+void SessionCallbacks::mergeMetadataUpdates(int notifications) {
   //If sp_session_player_load did not load the track it must be retried to play. Bug #26.
   if(application->player->isLoading) {
     application->player->retryPlay();
   }
-  
-  if(metadataUpdatedCallback && !metadataUpdatedCallback->IsEmpty()) {
-    metadataUpdatedCallback->Call(0, {});
+
+  metadataNotifications += notifications;
+  if(pendingMetadataUpdates == 0) {
+    uv_timer_start(metadataTimer.get(), &dispatchMetadataUpdated, metadataInterval, 0);
   }
+  pendingMetadataUpdates += notifications;
 }
 
 void SessionCallbacks::loggedIn(sp_session* session, sp_error error) {
+  if(!Engine::onMainThread()) {
+    Engine::post(nullptr, [=]() { loggedIn(session, error); });
+    return;
+  }
   if(SP_ERROR_OK != error) {
     unsigned int argc = 1;
     v8::Handle<v8::Value> argv[1] = { NanError(sp_error_message(error)) };
@@ -98,19 +197,31 @@ void SessionCallbacks::loggedIn(sp_session* session, sp_error error) {
   sp_playlistcontainer_add_callbacks(pc, &rootPlaylistContainerCallbacks, nullptr); 
 }
 
+static void callLoginCallback() {
+  if(SessionCallbacks::loginCallback && !SessionCallbacks::loginCallback->IsEmpty()) {
+    SessionCallbacks::loginCallback->Call(0, {});
+  }
+}
+
 /**
  * This is the "ready" hook for users. Playlists should be available at this point.
  **/
 void SessionCallbacks::rootPlaylistContainerLoaded(sp_playlistcontainer* sp, void* userdata) {
-  if(loginCallback && !loginCallback->IsEmpty()) {
-    loginCallback->Call(0, {});
-  }
   //Issue 35, rootPlaylistContainerLoaded can be called multiple times throughout the lifetime of a session.
   //loginCallback must only be called once.
-  sp_playlistcontainer_remove_callbacks(sp, &rootPlaylistContainerCallbacks, nullptr);    
+  sp_playlistcontainer_remove_callbacks(sp, &rootPlaylistContainerCallbacks, nullptr);
+  if(!Engine::onMainThread()) {
+    Engine::post(nullptr, callLoginCallback);
+    return;
+  }
+  callLoginCallback();
 }
 
 void SessionCallbacks::playTokenLost(sp_session *session) {
+  if(!Engine::onMainThread()) {
+    Engine::post(nullptr, [=]() { playTokenLost(session); });
+    return;
+  }
   application->audioHandler->setStopped(true);
   application->player->isPaused = true;
   if(playTokenLostCallback && !playTokenLostCallback->IsEmpty()) {
@@ -119,6 +230,10 @@ void SessionCallbacks::playTokenLost(sp_session *session) {
 }
 
 void SessionCallbacks::loggedOut(sp_session* session) {
+  if(!Engine::onMainThread()) {
+    Engine::post(nullptr, [=]() { loggedOut(session); });
+    return;
+  }
   if(logoutCallback && !logoutCallback->IsEmpty()) {
     logoutCallback->Call(0, {});
   }
@@ -13,6 +13,7 @@ public:
   static void playTokenLost(sp_session* session);
   static void end_of_track(sp_session* session);
   static void init();
+  static void initAudio();
   static void metadata_updated(sp_session* session);
   static void start_playback(sp_session* session);
   static void stop_playback(sp_session* session);
@@ -22,6 +23,14 @@ public:
   static std::unique_ptr<NanCallback> metadataUpdatedCallback;
   static std::unique_ptr<NanCallback> endOfTrackCallback;
   static std::unique_ptr<NanCallback> playTokenLostCallback;
+  /**
+   * ms to merge metadata_updated notifications before metadataUpdatedCallback is called, 0 for one call per loop turn.
+   **/
+  static int metadataInterval;
+  static int metadataNotifications;
+  static int metadataDispatches;
+private:
+  static void mergeMetadataUpdates(int notifications);
 };
 
 #endif
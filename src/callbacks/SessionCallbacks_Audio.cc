@@ -3,15 +3,43 @@ Everything audio related in Session Callbacks.
 **/
 #include "SessionCallbacks.h"
 #include "../Application.h"
+#include "../Engine.h"
+#include "../objects/spotify/Player.h"
+
+#include <uv.h>
+#include <node_version.h>
 
 extern Application* application;
 
-void SessionCallbacks::end_of_track(sp_session* session) {
-  sp_session_player_unload(application->session);
+//end_of_track is called from libspotify's audio thread, the rest happens on the main thread.
+static std::unique_ptr<uv_async_t> endOfTrackHandle;
 
-  if(endOfTrackCallback && !endOfTrackCallback->IsEmpty()) {
-    endOfTrackCallback->Call(0, {});
+#if NODE_VERSION_AT_LEAST(0, 11, 0)
+static void handleEndOfTrack(uv_async_t* handle) {
+#else
+static void handleEndOfTrack(uv_async_t* handle, int status) {
+#endif
+  SessionLock sessionLock;
+  //Switch to the next track natively, its audio goes into the queue right behind the end of the current one.
+  if(!application->player->playNext()) {
+    if(application->audioHandler) {
+      application->audioHandler->releaseHeldBack();
+    }
+    sp_session_player_unload(application->session);
   }
+
+  if(SessionCallbacks::endOfTrackCallback && !SessionCallbacks::endOfTrackCallback->IsEmpty()) {
+    SessionCallbacks::endOfTrackCallback->Call(0, {});
+  }
+}
+
+void SessionCallbacks::initAudio() {
+  endOfTrackHandle = std::unique_ptr<uv_async_t>(new uv_async_t());
+  uv_async_init(uv_default_loop(), endOfTrackHandle.get(), handleEndOfTrack);
+}
+
+void SessionCallbacks::end_of_track(sp_session* session) {
+  uv_async_send(endOfTrackHandle.get());
 }
 
 void SessionCallbacks::start_playback(sp_session* session) {
@@ -26,5 +26,6 @@ CREATE_EXCEPTION_WITH_MESSAGE(PlaylistNotMoveableException)
 CREATE_EXCEPTION_WITH_MESSAGE(TracksNotReorderableException)
 CREATE_EXCEPTION_WITH_MESSAGE(SessionCreationException)
 CREATE_EXCEPTION_WITH_MESSAGE(TracksNotAddedException)
+CREATE_EXCEPTION_WITH_MESSAGE(AudioHandlerCreationException)
 
 #endif
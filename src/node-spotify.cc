@@ -57,7 +57,7 @@ NAN_METHOD(CreateNodespotify) {
   application = new Application();
 
 #ifdef NODE_SPOTIFY_NATIVE_SOUND
-  application->audioHandler = std::unique_ptr<AudioHandler>(new NativeAudioHandler());
+  AudioHandler::replace(application->audioHandler, std::unique_ptr<AudioHandler>(new NativeAudioHandler()));
 #endif
 
   v8::Handle<v8::Object> options;
@@ -0,0 +1,138 @@
+#include "LoadWatcher.h"
+#include "NodeAlbum.h"
+#include "NodeArtist.h"
+#include "NodePlaylist.h"
+#include "NodePlaylistContainer.h"
+#include "NodeTrack.h"
+#include "NodeUser.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+using namespace v8;
+
+struct Watch {
+  uint32_t id;
+  std::shared_ptr<NanCallback> callback;
+};
+
+struct WatchedObject {
+  std::function<bool()> isLoaded;
+  std::vector<Watch> watches;
+};
+
+//Objects of node-spotify by their libspotify object.
+static std::map<const void*, WatchedObject> nativeWatches;
+//Other objects, checked one by one by their isLoaded property.
+static std::vector<Watch> propertyWatches;
+static int watchCount = 0;
+//The watched objects by id, they are kept alive until they are loaded.
+static Persistent<Object> watchedObjects;
+static uint32_t nextId = 0;
+
+int LoadWatcher::resolved = 0;
+int LoadWatcher::checks = 0;
+
+std::function<bool()> LoadWatcher::nativeCheck(Handle<Object> object, const void*& spObject) {
+  //The object is kept alive while it is watched, and with it the wrapped object.
+  if(NanNew(NodeTrack::constructorTemplate)->HasInstance(object)) {
+    Track* track = node::ObjectWrap::Unwrap<NodeTrack>(object)->track.get();
+    spObject = track->track;
+    return [track]() { return track->isLoaded(); };
+  }
+  if(NanNew(NodeAlbum::constructorTemplate)->HasInstance(object)) {
+    Album* album = node::ObjectWrap::Unwrap<NodeAlbum>(object)->album.get();
+    spObject = album->album;
+    return [album]() { return album->isLoaded(); };
+  }
+  if(NanNew(NodeArtist::constructorTemplate)->HasInstance(object)) {
+    Artist* artist = node::ObjectWrap::Unwrap<NodeArtist>(object)->artist.get();
+    spObject = artist->artist;
+    return [artist]() { return artist->isLoaded(); };
+  }
+  if(NanNew(NodePlaylist::constructorTemplate)->HasInstance(object)) {
+    Playlist* playlist = node::ObjectWrap::Unwrap<NodePlaylist>(object)->playlist.get();
+    spObject = playlist->playlist;
+    return [playlist]() { return playlist->isLoaded(); };
+  }
+  if(NanNew(NodePlaylistContainer::constructorTemplate)->HasInstance(object)) {
+    PlaylistContainer* playlistContainer = node::ObjectWrap::Unwrap<NodePlaylistContainer>(object)->playlistContainer.get();
+    spObject = playlistContainer->playlistContainer;
+    return [playlistContainer]() { return playlistContainer->isLoaded(); };
+  }
+  if(NanNew(NodeUser::constructorTemplate)->HasInstance(object)) {
+    User* user = node::ObjectWrap::Unwrap<NodeUser>(object)->user.get();
+    spObject = user->user;
+    return [user]() { return user->isLoaded(); };
+  }
+  return nullptr;
+}
+
+void LoadWatcher::watch(Handle<Object> object, std::shared_ptr<NanCallback> callback) {
+  NanScope();
+  if(watchedObjects.IsEmpty()) {
+    NanAssignPersistent(watchedObjects, NanNew<Object>());
+  }
+  Watch watch;
+  watch.id = nextId++;
+  watch.callback = callback;
+  NanNew(watchedObjects)->Set(watch.id, object);
+  watchCount++;
+  const void* spObject = nullptr;
+  std::function<bool()> isLoaded = nativeCheck(object, spObject);
+  if(!isLoaded) {
+    propertyWatches.push_back(std::move(watch));
+    return;
+  }
+  WatchedObject& watchedObject = nativeWatches[spObject];
+  if(!watchedObject.isLoaded) {
+    //The first object watched stays alive as long as the entry, the check can use it for all of them.
+    watchedObject.isLoaded = isLoaded;
+  }
+  watchedObject.watches.push_back(std::move(watch));
+}
+
+int LoadWatcher::check() {
+  if(watchCount == 0) {
+    return 0;
+  }
+  NanScope();
+  Local<Object> objects = NanNew(watchedObjects);
+  Handle<String> isLoadedKey = NanNew<String>("isLoaded");
+  std::vector<Watch> loaded;
+  std::vector<Watch> notLoaded;
+  checks++;
+  //Taken out before the callbacks run, they may watch more objects.
+  for(auto it = nativeWatches.begin(); it != nativeWatches.end();) {
+    if(it->second.isLoaded()) {
+      std::move(it->second.watches.begin(), it->second.watches.end(), std::back_inserter(loaded));
+      it = nativeWatches.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for(Watch& watch : propertyWatches) {
+    if(objects->Get(watch.id)->ToObject()->Get(isLoadedKey)->BooleanValue()) {
+      loaded.push_back(std::move(watch));
+    } else {
+      notLoaded.push_back(std::move(watch));
+    }
+  }
+  propertyWatches.swap(notLoaded);
+  watchCount -= loaded.size();
+  std::sort(loaded.begin(), loaded.end(), [](const Watch& a, const Watch& b) { return a.id < b.id; });
+  for(Watch& watch : loaded) {
+    Handle<Value> argv[1] = { objects->Get(watch.id) };
+    objects->Delete(watch.id);
+    resolved++;
+    watch.callback->Call(1, argv);
+  }
+  return loaded.size();
+}
+
+int LoadWatcher::pending() {
+  return watchCount;
+}
@@ -0,0 +1,35 @@
+#ifndef _LOAD_WATCHER_H
+#define _LOAD_WATCHER_H
+
+#include <v8.h>
+#include <nan.h>
+#include <functional>
+#include <memory>
+
+/**
+ * Objects from spotify.waitForLoaded that are not loaded yet. After metadata updates they are checked natively, with
+ * the isLoaded of their libspotify object, and only those that became loaded are handed back to JS.
+ *
+ * metadata_updated does not say which object changed, so a check still looks at every pending object. The watches are
+ * indexed by their libspotify object, each one is checked once however often it is watched.
+ **/
+class LoadWatcher {
+public:
+  static void watch(v8::Handle<v8::Object> object, std::shared_ptr<NanCallback> callback);
+  /**
+   * Calls the callback of every watched object that is loaded now, in the order they were watched.
+   * Returns how many there were.
+   **/
+  static int check();
+  static int pending();
+  static int resolved;
+  static int checks;
+private:
+  /**
+   * The check for an object of node-spotify, nullptr for other objects which are checked by their isLoaded property.
+   * spObject is set to the libspotify object it checks.
+   **/
+  static std::function<bool()> nativeCheck(v8::Handle<v8::Object> object, const void*& spObject);
+};
+
+#endif
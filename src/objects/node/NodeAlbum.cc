@@ -2,37 +2,57 @@
 #include "NodeTrack.h"
 #include "NodeArtist.h"
 #include "../spotify/Track.h"
+#include "../../Engine.h"
+
+WrapperCache<sp_album*, NodeAlbum> NodeAlbum::cache;
 
 NodeAlbum::NodeAlbum(std::unique_ptr<Album> _album) : album(std::move(_album)) {
   album->nodeObject = this;
 };
 
 NodeAlbum::~NodeAlbum() {
+  cache.remove(album->album, this);
   if(album->nodeObject == this) {
     album->nodeObject = nullptr;
   }
 }
 
+Handle<Object> NodeAlbum::fromCache(std::unique_ptr<Album> album) {
+  NodeAlbum* nodeAlbum = cache.find(album->album);
+  if(nodeAlbum != nullptr) {
+    return NanObjectWrapHandle(nodeAlbum);
+  }
+  sp_album* key = album->album;
+  nodeAlbum = new NodeAlbum(std::move(album));
+  Handle<Object> object = nodeAlbum->createInstance();
+  cache.add(key, nodeAlbum);
+  return object;
+}
+
 NAN_GETTER(NodeAlbum::getName) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   NanReturnValue(NanNew<String>(nodeAlbum->album->name().c_str()));
 }
 
 NAN_GETTER(NodeAlbum::getLink) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   NanReturnValue(NanNew<String>(nodeAlbum->album->link().c_str()));
 }
 
 NAN_METHOD(NodeAlbum::getCoverBase64) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   NanReturnValue(NanNew<String>(nodeAlbum->album->coverBase64().c_str()));
 }
 
 NAN_METHOD(NodeAlbum::browse) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   if(nodeAlbum->album->albumBrowse == nullptr) {
     nodeAlbum->makePersistent();
@@ -54,24 +74,26 @@ NAN_METHOD(NodeAlbum::browse) {
 
 NAN_GETTER(NodeAlbum::getTracks) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   std::vector<std::shared_ptr<Track>> tracks = nodeAlbum->album->tracks();
   Handle<Array> nodeTracks = NanNew<Array>(tracks.size());
   for(int i = 0; i < (int)tracks.size(); i++) {
-    NodeTrack* nodeTrack = new NodeTrack(tracks[i]);
-    nodeTracks->Set(NanNew<Number>(i), nodeTrack->createInstance());
+    nodeTracks->Set(NanNew<Number>(i), NodeTrack::fromCache(tracks[i]));
   }
   NanReturnValue(nodeTracks);
 }
 
 NAN_GETTER(NodeAlbum::getReview) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   NanReturnValue(NanNew<String>(nodeAlbum->album->review().c_str()));
 }
 
 NAN_GETTER(NodeAlbum::getCopyrights) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   std::vector<std::string> copyrights = nodeAlbum->album->copyrights();
   Handle<Array> nodeCopyrights = NanNew<Array>(copyrights.size());
@@ -83,13 +105,14 @@ NAN_GETTER(NodeAlbum::getCopyrights) {
 
 NAN_GETTER(NodeAlbum::getArtist) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
-  NodeArtist* nodeArtist = new NodeArtist(nodeAlbum->album->artist());
-  NanReturnValue(nodeArtist->createInstance());
+  NanReturnValue(NodeArtist::fromCache(nodeAlbum->album->artist()));
 }
 
 NAN_GETTER(NodeAlbum::isLoaded) {
   NanScope();
+  SessionLock sessionLock;
   NodeAlbum* nodeAlbum = node::ObjectWrap::Unwrap<NodeAlbum>(args.This());
   NanReturnValue(NanNew<Boolean>(nodeAlbum->album->isLoaded()));
 }
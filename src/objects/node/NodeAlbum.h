@@ -2,6 +2,7 @@
 #define _NODE_ALBUM_H
 
 #include "V8Browseable.h"
+#include "WrapperCache.h"
 #include "../spotify/Album.h"
 
 #include <nan.h>
@@ -11,11 +12,14 @@ using namespace v8;
 
 class NodeAlbum : public V8Browseable<NodeAlbum> {
 friend class AlbumBrowseCallbacks;
+friend class LoadWatcher;
 private:
   std::unique_ptr<Album> album;
 public:
   NodeAlbum(std::unique_ptr<Album> album);
   ~NodeAlbum();
+  static Handle<Object> fromCache(std::unique_ptr<Album> album);
+  static WrapperCache<sp_album*, NodeAlbum> cache;
   static void init();
   static NAN_GETTER(getName);
   static NAN_GETTER(getLink);
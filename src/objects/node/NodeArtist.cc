@@ -1,31 +1,50 @@
 #include "NodeArtist.h"
 #include "NodeTrack.h"
 #include "NodeAlbum.h"
+#include "../../Engine.h"
+
+WrapperCache<sp_artist*, NodeArtist> NodeArtist::cache;
 
 NodeArtist::NodeArtist(std::unique_ptr<Artist> _artist) : artist(std::move(_artist)) {
   artist->nodeObject = this;
 }
 
 NodeArtist::~NodeArtist() {
+  cache.remove(artist->artist, this);
   if(artist->nodeObject == this) {
     artist->nodeObject = nullptr;
   }
 }
 
+Handle<Object> NodeArtist::fromCache(std::unique_ptr<Artist> artist) {
+  NodeArtist* nodeArtist = cache.find(artist->artist);
+  if(nodeArtist != nullptr) {
+    return NanObjectWrapHandle(nodeArtist);
+  }
+  sp_artist* key = artist->artist;
+  nodeArtist = new NodeArtist(std::move(artist));
+  Handle<Object> object = nodeArtist->createInstance();
+  cache.add(key, nodeArtist);
+  return object;
+}
+
 NAN_GETTER(NodeArtist::getName) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   NanReturnValue(NanNew<String>(nodeArtist->artist->name().c_str()));
 }
 
 NAN_GETTER(NodeArtist::getLink) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   NanReturnValue(NanNew<String>(nodeArtist->artist->link().c_str()));
 }
 
 NAN_METHOD(NodeArtist::browse) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   if(nodeArtist->artist->artistBrowse == nullptr) {
     nodeArtist->makePersistent();
@@ -50,54 +69,55 @@ NAN_METHOD(NodeArtist::browse) {
 
 NAN_GETTER(NodeArtist::getTracks) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   std::vector<std::shared_ptr<Track>> tracks = nodeArtist->artist->tracks();
   Local<Array> nodeTracks = NanNew<Array>(tracks.size());
   for(int i = 0; i < (int)tracks.size(); i++) {
-    NodeTrack* nodeTrack = new NodeTrack(tracks[i]);
-    nodeTracks->Set(NanNew<Number>(i), nodeTrack->createInstance());
+    nodeTracks->Set(NanNew<Number>(i), NodeTrack::fromCache(tracks[i]));
   }
   NanReturnValue(nodeTracks);
 }
 
 NAN_GETTER(NodeArtist::getTophitTracks) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   std::vector<std::shared_ptr<Track>> tophitTracks = nodeArtist->artist->tophitTracks();
   Local<Array> nodeTophitTracks = NanNew<Array>(tophitTracks.size());
   for(int i = 0; i < (int)tophitTracks.size(); i++) {
-    NodeTrack* nodeTrack = new NodeTrack(tophitTracks[i]);
-    nodeTophitTracks->Set(NanNew<Number>(i), nodeTrack->createInstance());
+    nodeTophitTracks->Set(NanNew<Number>(i), NodeTrack::fromCache(tophitTracks[i]));
   }
   NanReturnValue(nodeTophitTracks);
 }
 
 NAN_GETTER(NodeArtist::getAlbums) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   std::vector<std::unique_ptr<Album>> albums = nodeArtist->artist->albums();
   Local<Array> nodeAlbums = NanNew<Array>(albums.size());
   for(int i = 0; i < (int)albums.size(); i++) {
-    NodeAlbum* nodeAlbum = new NodeAlbum(std::move(albums[i]));
-    nodeAlbums->Set(NanNew<Number>(i), nodeAlbum->createInstance());
+    nodeAlbums->Set(NanNew<Number>(i), NodeAlbum::fromCache(std::move(albums[i])));
   }
   NanReturnValue(nodeAlbums);
 }
 
 NAN_GETTER(NodeArtist::getSimilarArtists) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   std::vector<std::unique_ptr<Artist>> similarArtists = nodeArtist->artist->similarArtists();
   Local<Array> nodeSimilarArtists = NanNew<Array>(similarArtists.size());
   for(int i = 0; i < (int)similarArtists.size(); i++) {
-    NodeArtist* nodeArtist = new NodeArtist(std::move(similarArtists[i]));
-    nodeSimilarArtists->Set(NanNew<Number>(i), nodeArtist->createInstance());
+    nodeSimilarArtists->Set(NanNew<Number>(i), NodeArtist::fromCache(std::move(similarArtists[i])));
   }
   NanReturnValue(nodeSimilarArtists);
 }
 
 NAN_GETTER(NodeArtist::getBiography) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   std::string biography = nodeArtist->artist->biography();
   NanReturnValue(NanNew<String>(biography.c_str()));
@@ -105,6 +125,7 @@ NAN_GETTER(NodeArtist::getBiography) {
 
 NAN_GETTER(NodeArtist::isLoaded) {
   NanScope();
+  SessionLock sessionLock;
   NodeArtist* nodeArtist = node::ObjectWrap::Unwrap<NodeArtist>(args.This());
   NanReturnValue(NanNew<Boolean>(nodeArtist->artist->isLoaded()));
 }
@@ -2,6 +2,7 @@
 #define _NODE_ARTIST_H
 
 #include "V8Browseable.h"
+#include "WrapperCache.h"
 #include "../spotify/Artist.h"
 
 #include <nan.h>
@@ -10,11 +11,14 @@
 using namespace v8;
 
 class NodeArtist : public V8Browseable<NodeArtist> {
+friend class LoadWatcher;
 private:
   std::unique_ptr<Artist> artist;
 public:
   NodeArtist(std::unique_ptr<Artist> artist);
   ~NodeArtist();
+  static Handle<Object> fromCache(std::unique_ptr<Artist> artist);
+  static WrapperCache<sp_artist*, NodeArtist> cache;
   static NAN_GETTER(getName);
   static NAN_GETTER(getLink);
   static NAN_METHOD(browse);
@@ -3,6 +3,7 @@
 #include "../../callbacks/SessionCallbacks.h"
 #include "../../exceptions.h"
 #include "../../utils/V8Utils.h"
+#include "../../Engine.h"
 
 NodePlayer::NodePlayer(std::shared_ptr<Player> _player) : player(_player) {}
 
@@ -16,6 +17,7 @@ NodePlayer::NodePlayer(const NodePlayer& other) {
 
 NAN_METHOD(NodePlayer::pause) {
   NanScope();
+  SessionLock sessionLock;
   NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
   nodePlayer->player->pause();
   NanReturnUndefined();
@@ -23,6 +25,7 @@ NAN_METHOD(NodePlayer::pause) {
 
 NAN_METHOD(NodePlayer::stop) {
   NanScope();
+  SessionLock sessionLock;
   NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
   nodePlayer->player->stop();
   NanReturnUndefined();
@@ -30,6 +33,7 @@ NAN_METHOD(NodePlayer::stop) {
 
 NAN_METHOD(NodePlayer::resume) {
   NanScope();
+  SessionLock sessionLock;
   NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
   nodePlayer->player->resume();
   NanReturnUndefined();
@@ -37,6 +41,7 @@ NAN_METHOD(NodePlayer::resume) {
 
 NAN_METHOD(NodePlayer::play) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1) {
     return NanThrowError("play needs a track as its first argument.");
   }
@@ -58,6 +63,7 @@ NAN_METHOD(NodePlayer::play) {
 
 NAN_METHOD(NodePlayer::seek) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("seek needs an integer as its first argument.");
   }
@@ -67,10 +73,45 @@ NAN_METHOD(NodePlayer::seek) {
   NanReturnUndefined();
 }
 
+NAN_METHOD(NodePlayer::setNext) {
+  NanScope();
+  SessionLock sessionLock;
+  NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
+  if(args.Length() < 1 || args[0]->IsNull() || args[0]->IsUndefined()) {
+    nodePlayer->player->setNext(nullptr);
+    NanReturnUndefined();
+  }
+  if(!args[0]->IsObject()) {
+    return NanThrowError("setNext needs a track or null as its first argument.");
+  }
+  NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args[0]->ToObject());
+  nodePlayer->player->setNext(nodeTrack->track);
+  NanReturnUndefined();
+}
+
 NAN_GETTER(NodePlayer::getCurrentSecond) {
   NanScope();
   NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
-  NanReturnValue(NanNew<Integer>(nodePlayer->player->currentSecond));
+  int currentSecond = static_cast<int>(nodePlayer->player->position() / 1000);
+  NanReturnValue(NanNew<Integer>(currentSecond));
+}
+
+NAN_GETTER(NodePlayer::getPosition) {
+  NanScope();
+  NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
+  NanReturnValue(NanNew<Number>(nodePlayer->player->position()));
+}
+
+NAN_GETTER(NodePlayer::getVolume) {
+  NanScope();
+  NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
+  NanReturnValue(NanNew<Number>(nodePlayer->player->getVolume()));
+}
+
+NAN_SETTER(NodePlayer::setVolume) {
+  NanScope();
+  NodePlayer* nodePlayer = node::ObjectWrap::Unwrap<NodePlayer>(args.This());
+  nodePlayer->player->setVolume(value->NumberValue());
 }
 
 NAN_METHOD(NodePlayer::on) {
@@ -103,6 +144,9 @@ void NodePlayer::init() {
   NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "resume", resume);
   NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "stop", stop);
   NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "seek", seek);
+  NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "setNext", setNext);
   constructorTemplate->InstanceTemplate()->SetAccessor(NanNew<String>("currentSecond"), &getCurrentSecond);
+  constructorTemplate->InstanceTemplate()->SetAccessor(NanNew<String>("position"), &getPosition);
+  constructorTemplate->InstanceTemplate()->SetAccessor(NanNew<String>("volume"), &getVolume, &setVolume);
   NanAssignPersistent(NodePlayer::constructorTemplate, constructorTemplate);
 }
@@ -21,7 +21,11 @@ public:
   static NAN_METHOD(resume);
   static NAN_METHOD(play);
   static NAN_GETTER(getCurrentSecond);
+  static NAN_GETTER(getPosition);
+  static NAN_GETTER(getVolume);
+  static NAN_SETTER(setVolume);
   static NAN_METHOD(seek);
+  static NAN_METHOD(setNext);
   static NAN_METHOD(on);
   static NAN_METHOD(off);
   static void init();
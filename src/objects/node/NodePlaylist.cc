@@ -6,6 +6,7 @@
 #include "NodeTrackExtended.h"
 #include "NodeUser.h"
 #include "../../utils/V8Utils.h"
+#include "../../Engine.h"
 
 NodePlaylist::NodePlaylist(std::shared_ptr<Playlist> _playlist) : playlist(_playlist),
   playlistCallbacksHolder(this, _playlist->playlist) {
@@ -17,6 +18,7 @@ NodePlaylist::~NodePlaylist() {
 
 NAN_SETTER(NodePlaylist::setName) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   NanUtf8String newName(value);
   nodePlaylist->playlist->name(*newName);
@@ -24,42 +26,49 @@ NAN_SETTER(NodePlaylist::setName) {
 
 NAN_GETTER(NodePlaylist::getName) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   NanReturnValue(NanNew<String>(nodePlaylist->playlist->name().c_str()));
 }
 
 NAN_SETTER(NodePlaylist::setCollaborative) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   nodePlaylist->playlist->setCollaborative(value->ToBoolean()->Value());
 }
 
 NAN_GETTER(NodePlaylist::getCollaborative) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   NanReturnValue(NanNew<Boolean>(nodePlaylist->playlist->isCollaborative()));
 }
 
 NAN_GETTER(NodePlaylist::getLink) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   NanReturnValue(NanNew<String>(nodePlaylist->playlist->link().c_str()));
 }
 
 NAN_GETTER(NodePlaylist::getDescription) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   NanReturnValue(NanNew<String>(nodePlaylist->playlist->description().c_str()));
 }
 
 NAN_GETTER(NodePlaylist::getNumTracks) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   NanReturnValue(NanNew<Integer>(nodePlaylist->playlist->numTracks()));
 }
 
 NAN_METHOD(NodePlaylist::getTrack) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("getTrack needs a number as its first argument.");
@@ -69,12 +78,12 @@ NAN_METHOD(NodePlaylist::getTrack) {
     return NanThrowError("Track index out of bounds");
   }
   std::shared_ptr<TrackExtended> track = nodePlaylist->playlist->getTrack(position);
-  NodeTrackExtended* nodeTrack = new NodeTrackExtended(track);
-  NanReturnValue(nodeTrack->createInstance());
+  NanReturnValue(NodeTrackExtended::fromCache(track));
 }
 
 NAN_METHOD(NodePlaylist::addTracks) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 2 || !args[0]->IsArray() || !args[1]->IsNumber()) {
     return NanThrowError("addTracks needs an array and a number as its arguments.");
   }
@@ -98,6 +107,7 @@ NAN_METHOD(NodePlaylist::addTracks) {
 
 NAN_METHOD(NodePlaylist::removeTracks) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1 || !args[0]->IsArray()) {
     return NanThrowError("removeTracks needs an array as its first argument.");
   }
@@ -118,6 +128,7 @@ NAN_METHOD(NodePlaylist::removeTracks) {
 
 NAN_METHOD(NodePlaylist::reorderTracks) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 2 || !args[0]->IsArray() || !args[1]->IsNumber()) {
     return NanThrowError("reorderTracks needs an array and a numer as its arguments.");
   }
@@ -139,16 +150,18 @@ NAN_METHOD(NodePlaylist::reorderTracks) {
 
 NAN_GETTER(NodePlaylist::isLoaded) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   NanReturnValue(NanNew<Boolean>(nodePlaylist->playlist->isLoaded()));
 }
 
 NAN_GETTER(NodePlaylist::getOwner) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   Handle<Value> owner;
   if(nodePlaylist->playlist->owner()) {
-    owner = (new NodeUser(nodePlaylist->playlist->owner()))->createInstance();
+    owner = NodeUser::fromCache(nodePlaylist->playlist->owner());
   }
   NanReturnValue(owner);
 }
@@ -158,6 +171,7 @@ NAN_GETTER(NodePlaylist::getOwner) {
 **/
 NAN_METHOD(NodePlaylist::on) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   if(args.Length() < 1 || !args[0]->IsObject()) {
     return NanThrowError("on needs an object as its first argument.");
@@ -183,6 +197,7 @@ NAN_METHOD(NodePlaylist::on) {
 
 NAN_METHOD(NodePlaylist::off) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylist* nodePlaylist = node::ObjectWrap::Unwrap<NodePlaylist>(args.This());
   nodePlaylist->playlistCallbacksHolder.unsetCallbacks();
   NanReturnUndefined();
@@ -13,6 +13,7 @@
 using namespace v8;
 
 class NodePlaylist : public NodeWrapped<NodePlaylist> {
+friend class LoadWatcher;
 private:
   std::shared_ptr<Playlist> playlist;
   PlaylistCallbacksHolder playlistCallbacksHolder;
@@ -4,6 +4,7 @@
 #include "NodeUser.h"
 #include "../../exceptions.h"
 #include "../../utils/V8Utils.h"
+#include "../../Engine.h"
 
 NodePlaylistContainer::NodePlaylistContainer(std::shared_ptr<PlaylistContainer> _playlistContainer) : playlistContainer(_playlistContainer),
   playlistContainerCallbacksHolder(playlistContainer->playlistContainer, this) {
@@ -14,19 +15,21 @@ NodePlaylistContainer::~NodePlaylistContainer() {
 
 NAN_GETTER(NodePlaylistContainer::getOwner) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylistContainer* nodePlaylistContainer = node::ObjectWrap::Unwrap<NodePlaylistContainer>(args.This());
-  NodeUser* nodeUser = new NodeUser(nodePlaylistContainer->playlistContainer->owner());
-  NanReturnValue(nodeUser->createInstance());
+  NanReturnValue(NodeUser::fromCache(nodePlaylistContainer->playlistContainer->owner()));
 }
 
 NAN_GETTER(NodePlaylistContainer::getNumPlaylists) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylistContainer* nodePlaylistContainer = node::ObjectWrap::Unwrap<NodePlaylistContainer>(args.This());
   NanReturnValue(NanNew<Integer>(nodePlaylistContainer->playlistContainer->numPlaylists()));
 }
 
 NAN_METHOD(NodePlaylistContainer::getPlaylist) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("getPlaylist needs an interger as its first argument.");
   }
@@ -51,6 +54,7 @@ NAN_METHOD(NodePlaylistContainer::getPlaylist) {
 
 NAN_METHOD(NodePlaylistContainer::addPlaylist) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1 || !args[0]->IsString()) {
     return NanThrowError("addPlaylist needs a string as its argument");
   }
@@ -66,6 +70,7 @@ NAN_METHOD(NodePlaylistContainer::addPlaylist) {
 
 NAN_METHOD(NodePlaylistContainer::addFolder) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 2 || !args[0]->IsNumber() || !args[1]->IsString()) {
     return NanThrowError("addFolder needs a number and a string as arguments.");
   }
@@ -82,6 +87,7 @@ NAN_METHOD(NodePlaylistContainer::addFolder) {
 
 NAN_METHOD(NodePlaylistContainer::deletePlaylist) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("deletePlaylist needs an integer as its first argument.");
   }
@@ -93,6 +99,7 @@ NAN_METHOD(NodePlaylistContainer::deletePlaylist) {
 
 NAN_METHOD(NodePlaylistContainer::movePlaylist) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 2 || !args[0]->IsNumber() || !args[1]->IsNumber()) {
     return NanThrowError("Move playlist needs 2 numbers as its first arguments.");
   }
@@ -109,12 +116,14 @@ NAN_METHOD(NodePlaylistContainer::movePlaylist) {
 
 NAN_GETTER(NodePlaylistContainer::isLoaded) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylistContainer* nodePlaylistContainer = node::ObjectWrap::Unwrap<NodePlaylistContainer>(args.This());
   NanReturnValue(NanNew<Boolean>(nodePlaylistContainer->playlistContainer->isLoaded()));
 }
 
 NAN_METHOD(NodePlaylistContainer::on) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1 || !args[0]->IsObject()) {
     return NanThrowError("on needs an object as its first argument.");
   }
@@ -132,6 +141,7 @@ NAN_METHOD(NodePlaylistContainer::on) {
 
 NAN_METHOD(NodePlaylistContainer::off) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylistContainer* nodePlaylistContainer = node::ObjectWrap::Unwrap<NodePlaylistContainer>(args.This());
   nodePlaylistContainer->playlistContainerCallbacksHolder.unsetCallbacks();
   NanReturnUndefined();
@@ -11,6 +11,7 @@
 using namespace v8;
 
 class NodePlaylistContainer : public NodeWrapped<NodePlaylistContainer> {
+friend class LoadWatcher;
 private:
   std::shared_ptr<PlaylistContainer> playlistContainer;
   PlaylistContainerCallbacksHolder playlistContainerCallbacksHolder;
@@ -4,6 +4,7 @@
 #include "NodeArtist.h"
 #include "NodePlaylist.h"
 #include "../../Application.h"
+#include "../../Engine.h"
 
 extern Application* application;
 
@@ -24,6 +25,7 @@ NodeSearch::NodeSearch(const char* _searchQuery, int offset, int limit) : search
 
 NAN_METHOD(NodeSearch::execute) {
   NanScope();
+  SessionLock sessionLock;
   if(args.Length() < 1) {//TODO: how to check if it is a function? ->IsFunction() does not work, it does not recoginze functions.
     return NanThrowError("execute needs a callback function as its argument.");
   }
@@ -180,18 +182,21 @@ NAN_METHOD(NodeSearch::New) {
 
 NAN_GETTER(NodeSearch::didYouMean) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<String>(nodeSearch->search->didYouMeanText().c_str()));
 }
 
 NAN_GETTER(NodeSearch::getLink) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<String>(nodeSearch->search->link().c_str()));
 }
 
 NAN_METHOD(NodeSearch::getTrack) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("getTrack needs a number as its first argument.");
@@ -202,12 +207,12 @@ NAN_METHOD(NodeSearch::getTrack) {
     return NanThrowError("Track index out of bounds");
   }
 
-  NodeTrack* nodeTrack = new NodeTrack(nodeSearch->search->getTrack(position));
-  NanReturnValue(nodeTrack->createInstance());
+  NanReturnValue(NodeTrack::fromCache(nodeSearch->search->getTrack(position)));
 }
 
 NAN_METHOD(NodeSearch::getAlbum) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("getAlbum needs a number as its first argument.");
@@ -218,12 +223,12 @@ NAN_METHOD(NodeSearch::getAlbum) {
     return NanThrowError("Album index out of bounds");
   }
 
-  NodeAlbum* nodeAlbum = new NodeAlbum(nodeSearch->search->getAlbum(position));
-  NanReturnValue(nodeAlbum->createInstance());
+  NanReturnValue(NodeAlbum::fromCache(nodeSearch->search->getAlbum(position)));
 }
 
 NAN_METHOD(NodeSearch::getArtist) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("getArtist needs a number as its first argument.");
@@ -234,12 +239,12 @@ NAN_METHOD(NodeSearch::getArtist) {
     return NanThrowError("Artist index out of bounds");
   }
 
-  NodeArtist* nodeArtist = new NodeArtist(nodeSearch->search->getArtist(position));
-  NanReturnValue(nodeArtist->createInstance());
+  NanReturnValue(NodeArtist::fromCache(nodeSearch->search->getArtist(position)));
 }
 
 NAN_METHOD(NodeSearch::getPlaylist) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   if(args.Length() < 1 || !args[0]->IsNumber()) {
     return NanThrowError("getPlaylist needs a number as its first argument.");
@@ -256,48 +261,56 @@ NAN_METHOD(NodeSearch::getPlaylist) {
 
 NAN_GETTER(NodeSearch::getTotalTracks) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->totalTracks()));
 }
 
 NAN_GETTER(NodeSearch::getNumTracks) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->numTracks()));
 }
 
 NAN_GETTER(NodeSearch::getTotalAlbums) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->totalAlbums()));
 }
 
 NAN_GETTER(NodeSearch::getNumAlbums) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->numAlbums()));
 }
 
 NAN_GETTER(NodeSearch::getTotalArtists) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->totalArtists()));
 }
 
 NAN_GETTER(NodeSearch::getNumArtists) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->numArtists()));
 }
 
 NAN_GETTER(NodeSearch::getTotalPlaylists) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->totalPlaylists()));
 }
 
 NAN_GETTER(NodeSearch::getNumPlaylists) {
   NanScope();
+  SessionLock sessionLock;
   NodeSearch* nodeSearch = node::ObjectWrap::Unwrap<NodeSearch>(args.This());
   NanReturnValue(NanNew<Integer>(nodeSearch->search->numPlaylists()));
 }
@@ -1,8 +1,12 @@
 #include "NodeSpotify.h"
 #include "../../audio/AudioHandler.h"
+#include "../../audio/FileAudioHandler.h"
+#include "../../audio/HttpAudioHandler.h"
 #include "../../audio/NativeAudioHandler.h"
 #include "../../audio/NodeAudioHandler.h"
+#include "../../audio/SharedMemoryAudioHandler.h"
 #include "../../Application.h"
+#include "../../Engine.h"
 #include "../../exceptions.h"
 #include "../../callbacks/SessionCallbacks.h"
 #include "../spotify/SpotifyOptions.h"
@@ -13,26 +17,25 @@
 #include "NodeArtist.h"
 #include "NodeAlbum.h"
 #include "NodeTrack.h"
+#include "NodeTrackExtended.h"
 #include "NodeUser.h"
+#include "LoadWatcher.h"
 #include "../../utils/V8Utils.h"
 
+#include <string.h>
+
 extern Application* application;
 
 NodeSpotify::NodeSpotify(Handle<Object> options) {
-  /*
-   * Important note: The session callbacks must be initialized before
-   * the sp_session is started. The uv timer and async handle must be set up
-   * as they will be used as soon as the sp_session is created, which happens in the
-   * NodeSpotify ctor.
-   */
-  SessionCallbacks::init();
-
   SpotifyOptions _options;
   NanScope();
   Handle<String> settingsFolderKey = NanNew<String>("settingsFolder");
   Handle<String> cacheFolderKey = NanNew<String>("cacheFolder");
   Handle<String> traceFileKey = NanNew<String>("traceFile");
   Handle<String> appkeyFileKey = NanNew<String>("appkeyFile");
+  Handle<String> engineKey = NanNew<String>("engine");
+  Handle<String> pumpBudgetKey = NanNew<String>("pumpBudget");
+  Handle<String> metadataIntervalKey = NanNew<String>("metadataInterval");
   if(options->Has(settingsFolderKey)) {
     String::Utf8Value settingsFolderValue(options->Get(settingsFolderKey)->ToString());
     _options.settingsFolder = *settingsFolderValue;
@@ -53,7 +56,33 @@ NodeSpotify::NodeSpotify(Handle<Object> options) {
     String::Utf8Value appkeyFileValue(options->Get(appkeyFileKey)->ToString());
     _options.appkeyFile = *appkeyFileValue;
   }
+  bool threadedEngine = false;
+  if(options->Has(engineKey)) {
+    String::Utf8Value engineValue(options->Get(engineKey)->ToString());
+    if(strcmp(*engineValue, "thread") == 0) {
+      threadedEngine = true;
+    } else if(strcmp(*engineValue, "loop") != 0) {
+      throw SessionCreationException("engine must be 'loop' or 'thread'.");
+    }
+  }
+  int pumpBudget = V8Utils::getIntegerFromObject(options, pumpBudgetKey, 2);
+  if(pumpBudget < 0) {
+    throw SessionCreationException("pumpBudget must not be negative.");
+  }
+  SessionCallbacks::metadataInterval = V8Utils::getIntegerFromObject(options, metadataIntervalKey, 0);
+  if(SessionCallbacks::metadataInterval < 0) {
+    throw SessionCreationException("metadataInterval must not be negative.");
+  }
+
+  /*
+   * Important note: The session callbacks and the engine must be initialized before
+   * the sp_session is started. The uv timer and async handle must be set up
+   * as they will be used as soon as the sp_session is created.
+   */
+  Engine::init(threadedEngine, pumpBudget);
+  SessionCallbacks::init();
   spotify = std::unique_ptr<Spotify>(new Spotify(_options));
+  Engine::start(spotify->session);
 }
 
 NodeSpotify::~NodeSpotify() {
@@ -62,6 +91,7 @@ NodeSpotify::~NodeSpotify() {
 
 NAN_METHOD(NodeSpotify::createFromLink) {
   NanScope();
+  SessionLock sessionLock;
   Handle<Value> out;
   String::Utf8Value linkToParse(args[0]->ToString());
   sp_link* parsedLink = sp_link_create_from_string(*linkToParse);
@@ -71,29 +101,25 @@ NAN_METHOD(NodeSpotify::createFromLink) {
       case SP_LINKTYPE_TRACK:
       {
         sp_track* track = sp_link_as_track(parsedLink);
-        NodeTrack* nodeTrack = new NodeTrack(std::make_shared<Track>(track));
-        out = nodeTrack->createInstance();
+        out = NodeTrack::fromCache(std::make_shared<Track>(track));
         break;
       }
       case SP_LINKTYPE_ALBUM:
       {
         sp_album* album = sp_link_as_album(parsedLink);
-        NodeAlbum* nodeAlbum = new NodeAlbum(std::unique_ptr<Album>(new Album(album)));
-        out = nodeAlbum->createInstance();
+        out = NodeAlbum::fromCache(std::unique_ptr<Album>(new Album(album)));
         break;
       }
       case SP_LINKTYPE_ARTIST:
       {
         sp_artist* artist = sp_link_as_artist(parsedLink);
-        NodeArtist* nodeArtist = new NodeArtist(std::unique_ptr<Artist>(new Artist(artist)));
-        out = nodeArtist->createInstance();
+        out = NodeArtist::fromCache(std::unique_ptr<Artist>(new Artist(artist)));
         break;
       }
       case SP_LINKTYPE_PROFILE:
       {
         sp_user* user = sp_link_as_user(parsedLink);
-        NodeUser* nodeUser = new NodeUser(std::unique_ptr<User>(new User(user)));
-        out = nodeUser->createInstance();
+        out = NodeUser::fromCache(std::unique_ptr<User>(new User(user)));
         break;
       }
       case SP_LINKTYPE_PLAYLIST:
@@ -107,8 +133,7 @@ NAN_METHOD(NodeSpotify::createFromLink) {
       case SP_LINKTYPE_LOCALTRACK:
       {
         sp_track* track = sp_link_as_track(parsedLink);
-        NodeTrack* nodeTrack = new NodeTrack(std::make_shared<Track>(track));
-        out = nodeTrack->createInstance();
+        out = NodeTrack::fromCache(std::make_shared<Track>(track));
         break;
       }
       default:
@@ -123,6 +148,7 @@ NAN_METHOD(NodeSpotify::createFromLink) {
 
 NAN_METHOD(NodeSpotify::login) {
   NanScope();
+  SessionLock sessionLock;
   NodeSpotify* nodeSpotify = node::ObjectWrap::Unwrap<NodeSpotify>(args.This());
   String::Utf8Value v8User(args[0]->ToString());
   String::Utf8Value v8Password(args[1]->ToString());
@@ -140,27 +166,30 @@ NAN_METHOD(NodeSpotify::logout) {
     SessionCallbacks::logoutCallback = std::unique_ptr<NanCallback>(new NanCallback(args[0].As<Function>()));
   }
   NodeSpotify* nodeSpotify = node::ObjectWrap::Unwrap<NodeSpotify>(args.This());
+  SessionLock sessionLock;
   nodeSpotify->spotify->logout();
   NanReturnUndefined();
 }
 
 NAN_GETTER(NodeSpotify::getPlaylistContainer) {
   NanScope();
+  SessionLock sessionLock;
   NodePlaylistContainer* nodePlaylistContainer = new NodePlaylistContainer(application->playlistContainer);
   NanReturnValue(nodePlaylistContainer->createInstance());
 }
 
 NAN_GETTER(NodeSpotify::getRememberedUser) {
   NanScope();
+  SessionLock sessionLock;
   NodeSpotify* nodeSpotify = node::ObjectWrap::Unwrap<NodeSpotify>(args.This());
   NanReturnValue(NanNew<String>(nodeSpotify->spotify->rememberedUser().c_str()));
 }
 
 NAN_GETTER(NodeSpotify::getSessionUser) {
   NanScope();
+  SessionLock sessionLock;
   NodeSpotify* nodeSpotify = node::ObjectWrap::Unwrap<NodeSpotify>(args.This());
-  NodeUser* nodeUser = new NodeUser(std::move(nodeSpotify->spotify->sessionUser()));
-  NanReturnValue(nodeUser->createInstance());
+  NanReturnValue(NodeUser::fromCache(nodeSpotify->spotify->sessionUser()));
 }
 
 NAN_GETTER(NodeSpotify::getConstants) {
@@ -184,12 +213,141 @@ NAN_GETTER(NodeSpotify::getConstants) {
   NanReturnValue(constants);
 }
 
+/**
+ * Read the options all audio handlers share. Returns an error message if they make no sense, nullptr otherwise.
+ **/
+static const char* readAudioHandlerOptions(Handle<Object> optionsObject, AudioHandlerOptions& options) {
+  options.highWatermark = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("highWatermark"), options.highWatermark);
+  if(options.highWatermark > AUDIO_MAX_WATERMARK) {
+    //The audio queue has a fixed number of slots, a higher watermark would never be reached.
+    return "highWatermark must not be above 10000 ms.";
+  }
+  //Without an explicit low watermark there is no hysteresis, like with the defaults.
+  options.lowWatermark = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("lowWatermark"), options.highWatermark);
+  if(options.lowWatermark < 0 || options.lowWatermark > options.highWatermark) {
+    return "lowWatermark must be between 0 and highWatermark.";
+  }
+  options.crossfadeDuration = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("crossfade"), 0);
+  if(options.crossfadeDuration < 0) {
+    return "crossfade must not be negative.";
+  }
+  Handle<Value> crossfadeCurve = optionsObject->Get(NanNew<String>("crossfadeCurve"));
+  if(!crossfadeCurve->IsUndefined()) {
+    String::Utf8Value curve(crossfadeCurve->ToString());
+    if(strcmp(*curve, "linear") == 0) {
+      options.crossfadeCurve = CROSSFADE_LINEAR;
+    } else if(strcmp(*curve, "equalPower") == 0) {
+      options.crossfadeCurve = CROSSFADE_EQUAL_POWER;
+    } else {
+      return "crossfadeCurve must be 'linear' or 'equalPower'.";
+    }
+  }
+  options.outputRate = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("outputRate"), 0);
+  if(options.outputRate < 0 || options.outputRate > 384000) {
+    return "outputRate must be between 0 and 384000.";
+  }
+  Handle<Value> resampleQuality = optionsObject->Get(NanNew<String>("resampleQuality"));
+  if(!resampleQuality->IsUndefined()) {
+    String::Utf8Value quality(resampleQuality->ToString());
+    if(strcmp(*quality, "low") == 0) {
+      options.resampleQuality = AUDIO_RESAMPLE_LOW;
+    } else if(strcmp(*quality, "medium") == 0) {
+      options.resampleQuality = AUDIO_RESAMPLE_MEDIUM;
+    } else if(strcmp(*quality, "high") == 0) {
+      options.resampleQuality = AUDIO_RESAMPLE_HIGH;
+    } else {
+      return "resampleQuality must be 'low', 'medium' or 'high'.";
+    }
+  }
+  options.addSink = V8Utils::getBooleanFromObject(optionsObject, NanNew<String>("add"), false);
+  Handle<Value> backpressure = optionsObject->Get(NanNew<String>("backpressure"));
+  if(!backpressure->IsUndefined()) {
+    String::Utf8Value policy(backpressure->ToString());
+    if(strcmp(*policy, "block") == 0) {
+      options.backpressure = AUDIO_TAP_BLOCK;
+    } else if(strcmp(*policy, "dropOldest") == 0) {
+      options.backpressure = AUDIO_TAP_DROP_OLDEST;
+    } else if(strcmp(*policy, "skip") == 0) {
+      options.backpressure = AUDIO_TAP_SKIP;
+    } else {
+      return "backpressure must be 'block', 'dropOldest' or 'skip'.";
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Make audioHandler the audio handler, or another sink of the current one if the options say so and there is one.
+ * Returns an error message if it could not be added, nullptr otherwise.
+ **/
+static const char* installAudioHandler(std::unique_ptr<AudioHandler> audioHandler, const AudioHandlerOptions& options) {
+  if(options.addSink && application->audioHandler) {
+    audioHandler->setVolume(application->player->getVolume());
+    if(!application->audioHandler->addSink(std::move(audioHandler), options.backpressure)) {
+      return "No more sinks can be added.";
+    }
+    return nullptr;
+  }
+  //The old handler goes away only once libspotify is done with it, what it has queued is played by the new one.
+  application->player->useAudioHandler(std::move(audioHandler));
+  return nullptr;
+}
+
 #ifdef NODE_SPOTIFY_NATIVE_SOUND
 NAN_METHOD(NodeSpotify::useNativeAudio) {
   NanScope();
-  //Since the old audio handler has to be deleted first, do an empty reset.
-  application->audioHandler.reset();
-  application->audioHandler = std::unique_ptr<AudioHandler>(new NativeAudioHandler());
+  NativeAudioOptions options;
+  if(args.Length() > 0 && args[0]->IsObject()) {
+    Handle<Object> optionsObject = args[0]->ToObject();
+    const char* error = readAudioHandlerOptions(optionsObject, options);
+    if(error != nullptr) {
+      return NanThrowError(error);
+    }
+    Handle<Value> device = optionsObject->Get(NanNew<String>("device"));
+    if(!device->IsUndefined()) {
+      String::Utf8Value deviceName(device->ToString());
+      if(deviceName.length() >= AUDIO_DEVICE_NAME_LENGTH) {
+        return NanThrowError("The device name is too long.");
+      }
+      options.device = *deviceName;
+    }
+    options.periodSize = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("periodSize"), 0);
+    options.bufferSize = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("bufferSize"), 0);
+    if(options.periodSize < 0 || options.bufferSize < 0 || (options.bufferSize > 0 && options.bufferSize < options.periodSize)) {
+      return NanThrowError("periodSize and bufferSize must not be negative and bufferSize must hold at least one period.");
+    }
+    Handle<Value> realtime = optionsObject->Get(NanNew<String>("realtime"));
+    if(!realtime->IsUndefined() && !realtime->IsFalse()) {
+      String::Utf8Value policy(realtime->ToString());
+      if(strcmp(*policy, "fifo") == 0) {
+        options.schedPolicy = AUDIO_SCHED_FIFO;
+      } else if(strcmp(*policy, "rr") == 0) {
+        options.schedPolicy = AUDIO_SCHED_RR;
+      } else {
+        return NanThrowError("realtime must be 'fifo' or 'rr'.");
+      }
+    }
+    options.schedPriority = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("priority"), 10);
+    Handle<Value> cpus = optionsObject->Get(NanNew<String>("cpus"));
+    if(!cpus->IsUndefined()) {
+      if(!cpus->IsArray()) {
+        return NanThrowError("cpus must be an array of CPU numbers.");
+      }
+      Handle<Array> cpuArray = Handle<Array>::Cast(cpus);
+      for(unsigned int i = 0; i < cpuArray->Length(); i++) {
+        Handle<Value> cpu = cpuArray->Get(i);
+        if(!cpu->IsNumber() || cpu->IntegerValue() < 0 || cpu->IntegerValue() > 63) {
+          return NanThrowError("cpus must contain CPU numbers from 0 to 63.");
+        }
+        options.cpuMask |= (uint64_t)1 << cpu->IntegerValue();
+      }
+    }
+    options.lockMemory = V8Utils::getBooleanFromObject(optionsObject, NanNew<String>("lockMemory"), false);
+  }
+  const char* error = installAudioHandler(std::unique_ptr<AudioHandler>(new NativeAudioHandler(options)), options);
+  if(error != nullptr) {
+    return NanThrowError(error);
+  }
   NanReturnUndefined();
 }
 #endif
@@ -199,15 +357,384 @@ NAN_METHOD(NodeSpotify::useNodejsAudio) {
   if(args.Length() < 1) {
     return NanThrowError("useNodjsAudio needs a function as its first argument.");
   }
-  //Since the old audio handler has to be deleted first, do an empty reset.
-  application->audioHandler.reset();
+  NodeAudioOptions options;
+  if(args.Length() > 1 && args[1]->IsObject()) {
+    Handle<Object> optionsObject = args[1]->ToObject();
+    options.bufferDuration = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("bufferDuration"), 0);
+    options.pull = V8Utils::getBooleanFromObject(optionsObject, NanNew<String>("pull"), false);
+    const char* error = readAudioHandlerOptions(optionsObject, options);
+    if(error != nullptr) {
+      return NanThrowError(error);
+    }
+    Handle<Value> sampleFormat = optionsObject->Get(NanNew<String>("sampleFormat"));
+    if(!sampleFormat->IsUndefined()) {
+      String::Utf8Value format(sampleFormat->ToString());
+      if(strcmp(*format, "s16") == 0) {
+        options.sampleFormat = SAMPLE_FORMAT_S16;
+      } else if(strcmp(*format, "f32") == 0) {
+        options.sampleFormat = SAMPLE_FORMAT_F32;
+      } else if(strcmp(*format, "f32-planar") == 0) {
+        options.sampleFormat = SAMPLE_FORMAT_F32_PLANAR;
+      } else {
+        return NanThrowError("sampleFormat must be 's16', 'f32' or 'f32-planar'.");
+      }
+#if !NODE_VERSION_AT_LEAST(0, 11, 0)
+      if(options.sampleFormat != SAMPLE_FORMAT_S16) {
+        return NanThrowError("The float sample formats need node.js 0.12 or newer.");
+      }
+#endif
+    }
+  }
   auto callback = std::unique_ptr<NanCallback>(new NanCallback(args[0].As<Function>()));
-  application->audioHandler = std::unique_ptr<AudioHandler>(new NodeAudioHandler(std::move(callback)));
+  NodeAudioHandler* nodeAudioHandler = new NodeAudioHandler(std::move(callback), options);
+  //The functions stay bound to this handler, also if it is only a sink or gets replaced.
+  Handle<Value> id = NanNew<Integer>(nodeAudioHandler->getId());
+  const char* error = installAudioHandler(std::unique_ptr<AudioHandler>(nodeAudioHandler), options);
+  if(error != nullptr) {
+    return NanThrowError(error);
+  }
 
-  Handle<Function> needMoreDataSetter = NanNew<FunctionTemplate>(NodeAudioHandler::setNeedMoreData)->GetFunction();
+  if(options.pull) {
+    Handle<Function> read = NanNew<FunctionTemplate>(NodeAudioHandler::read, id)->GetFunction();
+    NanReturnValue(read);
+  }
+  Handle<Function> needMoreDataSetter = NanNew<FunctionTemplate>(NodeAudioHandler::setNeedMoreData, id)->GetFunction();
   NanReturnValue(needMoreDataSetter);
 }
 
+NAN_METHOD(NodeSpotify::useFileAudio) {
+  NanScope();
+  if(args.Length() < 1 || !args[0]->IsString()) {
+    return NanThrowError("useFileAudio needs a path as its first argument.");
+  }
+  FileAudioOptions options;
+  String::Utf8Value path(args[0]->ToString());
+  if(path.length() >= AUDIO_PATH_LENGTH) {
+    return NanThrowError("The path is too long.");
+  }
+  options.path = *path;
+  //Raw PCM if the file name says so, WAV otherwise.
+  size_t extension = options.path.rfind('.');
+  if(extension != std::string::npos && (options.path.compare(extension, std::string::npos, ".raw") == 0 ||
+    options.path.compare(extension, std::string::npos, ".pcm") == 0)) {
+    options.format = AUDIO_FILE_RAW;
+  }
+  if(args.Length() > 1 && args[1]->IsObject()) {
+    Handle<Object> optionsObject = args[1]->ToObject();
+    const char* error = readAudioHandlerOptions(optionsObject, options);
+    if(error != nullptr) {
+      return NanThrowError(error);
+    }
+    Handle<Value> format = optionsObject->Get(NanNew<String>("format"));
+    if(!format->IsUndefined()) {
+      String::Utf8Value formatName(format->ToString());
+      if(strcmp(*formatName, "wav") == 0) {
+        options.format = AUDIO_FILE_WAV;
+      } else if(strcmp(*formatName, "raw") == 0) {
+        options.format = AUDIO_FILE_RAW;
+      } else {
+        return NanThrowError("format must be 'wav' or 'raw'.");
+      }
+    }
+    options.writeSize = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("writeSize"), 0);
+    if(options.writeSize < 0 || options.writeSize % 4096 != 0) {
+      return NanThrowError("writeSize must be a multiple of 4096.");
+    }
+    options.direct = V8Utils::getBooleanFromObject(optionsObject, NanNew<String>("direct"), false);
+    Handle<Value> preallocate = optionsObject->Get(NanNew<String>("preallocate"));
+    if(!preallocate->IsUndefined()) {
+      if(!preallocate->IsNumber() || preallocate->IntegerValue() < 0) {
+        return NanThrowError("preallocate must be a number of bytes.");
+      }
+      options.preallocate = preallocate->IntegerValue();
+    }
+  }
+  const char* error = installAudioHandler(std::unique_ptr<AudioHandler>(new FileAudioHandler(options)), options);
+  if(error != nullptr) {
+    return NanThrowError(error);
+  }
+  NanReturnUndefined();
+}
+
+NAN_METHOD(NodeSpotify::useSharedMemoryAudio) {
+  NanScope();
+  SharedMemoryAudioOptions options;
+  if(args.Length() > 0 && args[0]->IsObject()) {
+    Handle<Object> optionsObject = args[0]->ToObject();
+    const char* error = readAudioHandlerOptions(optionsObject, options);
+    if(error != nullptr) {
+      return NanThrowError(error);
+    }
+    Handle<Value> name = optionsObject->Get(NanNew<String>("name"));
+    if(!name->IsUndefined()) {
+      String::Utf8Value objectName(name->ToString());
+      if(objectName.length() < 2 || objectName.length() >= AUDIO_SHM_NAME_LENGTH || (*objectName)[0] != '/' ||
+        strchr(*objectName + 1, '/') != nullptr) {
+        return NanThrowError("name must start with a / and contain no other.");
+      }
+      options.name = *objectName;
+    }
+    int size = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("size"), AUDIO_SHM_DEFAULT_CAPACITY);
+    if(size < 65536 || size > 1024 * 1024 * 1024 || (size & (size - 1)) != 0) {
+      return NanThrowError("size must be a power of two from 65536 to 1073741824.");
+    }
+    options.capacity = (uint32_t)size;
+  }
+  SharedMemoryAudioHandler* sharedMemoryAudioHandler;
+  try {
+    sharedMemoryAudioHandler = new SharedMemoryAudioHandler(options);
+  } catch (const AudioHandlerCreationException& e) {
+    return NanThrowError(("The shared memory could not be created: " + e.message + ".").c_str());
+  }
+  Local<Object> ring = NanNew<Object>();
+  ring->Set(NanNew<String>("fd"), NanNew<Integer>(sharedMemoryAudioHandler->getFd()));
+  if(!options.name.empty()) {
+    ring->Set(NanNew<String>("name"), NanNew<String>(sharedMemoryAudioHandler->getName()));
+  }
+  ring->Set(NanNew<String>("headerSize"), NanNew<Integer>(AUDIO_SHM_HEADER_SIZE));
+  ring->Set(NanNew<String>("size"), NanNew<Number>(sharedMemoryAudioHandler->getCapacity()));
+  const char* error = installAudioHandler(std::unique_ptr<AudioHandler>(sharedMemoryAudioHandler), options);
+  if(error != nullptr) {
+    return NanThrowError(error);
+  }
+  NanReturnValue(ring);
+}
+
+NAN_METHOD(NodeSpotify::useHttpAudio) {
+  NanScope();
+  HttpAudioOptions options;
+  if(args.Length() > 0 && args[0]->IsObject()) {
+    Handle<Object> optionsObject = args[0]->ToObject();
+    const char* error = readAudioHandlerOptions(optionsObject, options);
+    if(error != nullptr) {
+      return NanThrowError(error);
+    }
+    options.port = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("port"), 0);
+    if(options.port < 0 || options.port > 65535) {
+      return NanThrowError("port must be between 0 and 65535.");
+    }
+    Handle<Value> format = optionsObject->Get(NanNew<String>("format"));
+    if(!format->IsUndefined()) {
+      String::Utf8Value formatName(format->ToString());
+      if(strcmp(*formatName, "wav") == 0) {
+        options.format = AUDIO_FILE_WAV;
+      } else if(strcmp(*formatName, "raw") == 0) {
+        options.format = AUDIO_FILE_RAW;
+      } else {
+        return NanThrowError("format must be 'wav' or 'raw'.");
+      }
+    }
+    options.maxListeners = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("maxListeners"), 32);
+    if(options.maxListeners < 1 || options.maxListeners > 1024) {
+      return NanThrowError("maxListeners must be between 1 and 1024.");
+    }
+    options.bufferSize = V8Utils::getIntegerFromObject(optionsObject, NanNew<String>("bufferSize"),
+      AUDIO_HTTP_DEFAULT_BUFFER_SIZE);
+    if(options.bufferSize < 65536 || options.bufferSize > 256 * 1024 * 1024) {
+      return NanThrowError("bufferSize must be between 65536 and 268435456.");
+    }
+  }
+  HttpAudioHandler* httpAudioHandler;
+  try {
+    httpAudioHandler = new HttpAudioHandler(options);
+  } catch (const AudioHandlerCreationException& e) {
+    return NanThrowError(("The port could not be opened: " + e.message + ".").c_str());
+  }
+  int port = httpAudioHandler->getPort();
+  const char* error = installAudioHandler(std::unique_ptr<AudioHandler>(httpAudioHandler), options);
+  if(error != nullptr) {
+    return NanThrowError(error);
+  }
+  NanReturnValue(NanNew<Integer>(port));
+}
+
+/**
+ * The stats of one audio handler, see spotify.audioStats.
+ **/
+static Local<Object> audioHandlerStats(AudioHandler* audioHandler) {
+  Local<Object> stats = NanNew<Object>();
+  audio_pool_stats_t poolStats;
+  audioHandler->getPoolStats(&poolStats);
+  Local<Object> pool = NanNew<Object>();
+  pool->Set(NanNew<String>("hits"), NanNew<Number>(poolStats.hits));
+  pool->Set(NanNew<String>("misses"), NanNew<Number>(poolStats.misses));
+  pool->Set(NanNew<String>("highWaterMark"), NanNew<Integer>(poolStats.highWaterMark));
+  pool->Set(NanNew<String>("chunksInUse"), NanNew<Integer>(poolStats.chunksInUse));
+  stats->Set(NanNew<String>("pool"), pool);
+
+  AudioBufferStats bufferStats;
+  audioHandler->getBufferStats(&bufferStats);
+  Local<Object> buffer = NanNew<Object>();
+  buffer->Set(NanNew<String>("samples"), NanNew<Integer>(bufferStats.samples));
+  buffer->Set(NanNew<String>("milliseconds"), NanNew<Integer>(bufferStats.milliseconds));
+  buffer->Set(NanNew<String>("lowWatermark"), NanNew<Integer>(bufferStats.lowWatermark));
+  buffer->Set(NanNew<String>("highWatermark"), NanNew<Integer>(bufferStats.highWatermark));
+  buffer->Set(NanNew<String>("refills"), NanNew<Integer>(bufferStats.refills));
+  stats->Set(NanNew<String>("buffer"), buffer);
+
+  audio_output_stats_t outputStats = {};
+  if(audioHandler->getOutputStats(&outputStats)) {
+    Local<Object> output = NanNew<Object>();
+    output->Set(NanNew<String>("xruns"), NanNew<Integer>(outputStats.xruns));
+    output->Set(NanNew<String>("openFailures"), NanNew<Integer>(outputStats.openFailures));
+    output->Set(NanNew<String>("periodSize"), NanNew<Integer>(outputStats.periodSize));
+    output->Set(NanNew<String>("bufferSize"), NanNew<Integer>(outputStats.bufferSize));
+    output->Set(NanNew<String>("mmap"), NanNew<Boolean>(outputStats.mmap != 0));
+    output->Set(NanNew<String>("realtime"), NanNew<Boolean>(outputStats.realtime != 0));
+    output->Set(NanNew<String>("affinity"), NanNew<Boolean>(outputStats.affinity != 0));
+    output->Set(NanNew<String>("memoryLocked"), NanNew<Boolean>(outputStats.memoryLocked != 0));
+    stats->Set(NanNew<String>("output"), output);
+  }
+
+  audio_file_stats_t fileStats;
+  if(audioHandler->getFileStats(&fileStats)) {
+    Local<Object> file = NanNew<Object>();
+    file->Set(NanNew<String>("bytesWritten"), NanNew<Number>(fileStats.bytesWritten));
+    file->Set(NanNew<String>("writes"), NanNew<Integer>(fileStats.writes));
+    file->Set(NanNew<String>("files"), NanNew<Integer>(fileStats.files));
+    file->Set(NanNew<String>("openFailures"), NanNew<Integer>(fileStats.openFailures));
+    file->Set(NanNew<String>("writeErrors"), NanNew<Integer>(fileStats.writeErrors));
+    file->Set(NanNew<String>("direct"), NanNew<Boolean>(fileStats.direct != 0));
+    file->Set(NanNew<String>("preallocated"), NanNew<Boolean>(fileStats.preallocated != 0));
+    stats->Set(NanNew<String>("file"), file);
+  }
+
+  audio_http_stats_t httpStats;
+  if(audioHandler->getHttpStats(&httpStats)) {
+    Local<Object> http = NanNew<Object>();
+    http->Set(NanNew<String>("listeners"), NanNew<Integer>(httpStats.listeners));
+    http->Set(NanNew<String>("accepted"), NanNew<Integer>(httpStats.accepted));
+    http->Set(NanNew<String>("rejected"), NanNew<Integer>(httpStats.rejected));
+    http->Set(NanNew<String>("evicted"), NanNew<Integer>(httpStats.evicted));
+    http->Set(NanNew<String>("bytesSent"), NanNew<Number>(httpStats.bytesSent));
+    stats->Set(NanNew<String>("http"), http);
+  }
+
+  audio_telemetry_t telemetry;
+  audioHandler->getTelemetry(&telemetry);
+  Local<Object> telemetryObject = NanNew<Object>();
+  telemetryObject->Set(NanNew<String>("framesDelivered"), NanNew<Number>(telemetry.framesDelivered));
+  telemetryObject->Set(NanNew<String>("framesConsumed"), NanNew<Number>(telemetry.framesConsumed));
+  telemetryObject->Set(NanNew<String>("framesDropped"), NanNew<Number>(telemetry.framesDropped));
+  telemetryObject->Set(NanNew<String>("underruns"), NanNew<Integer>(telemetry.underruns));
+  telemetryObject->Set(NanNew<String>("xruns"), NanNew<Integer>(outputStats.xruns));
+  static const int depthLimits[AUDIO_DEPTH_BUCKETS - 1] = AUDIO_DEPTH_LIMITS_MS;
+  Local<Array> depthLimitsArray = NanNew<Array>(AUDIO_DEPTH_BUCKETS - 1);
+  Local<Array> depthCounts = NanNew<Array>(AUDIO_DEPTH_BUCKETS);
+  for(int i = 0; i < AUDIO_DEPTH_BUCKETS; i++) {
+    if(i < AUDIO_DEPTH_BUCKETS - 1) {
+      depthLimitsArray->Set(i, NanNew<Integer>(depthLimits[i]));
+    }
+    depthCounts->Set(i, NanNew<Number>(telemetry.depth[i]));
+  }
+  Local<Object> queueDepth = NanNew<Object>();
+  queueDepth->Set(NanNew<String>("limits"), depthLimitsArray);
+  queueDepth->Set(NanNew<String>("counts"), depthCounts);
+  telemetryObject->Set(NanNew<String>("queueDepth"), queueDepth);
+  Local<Object> latency = NanNew<Object>();
+  latency->Set(NanNew<String>("p50"), NanNew<Integer>(audio_telemetry_percentile(&telemetry, 50)));
+  latency->Set(NanNew<String>("p90"), NanNew<Integer>(audio_telemetry_percentile(&telemetry, 90)));
+  latency->Set(NanNew<String>("p99"), NanNew<Integer>(audio_telemetry_percentile(&telemetry, 99)));
+  latency->Set(NanNew<String>("max"), NanNew<Number>(telemetry.maxLatency / 1000.0));
+  telemetryObject->Set(NanNew<String>("latency"), latency);
+  stats->Set(NanNew<String>("telemetry"), telemetryObject);
+  return stats;
+}
+
+NAN_METHOD(NodeSpotify::audioStats) {
+  NanScope();
+  Local<Object> stats = NanNew<Object>();
+  if(application->audioHandler) {
+    stats = audioHandlerStats(application->audioHandler.get());
+    std::vector<AudioHandler*> sinks = application->audioHandler->getSinks();
+    Local<Array> sinkStats = NanNew<Array>(sinks.size());
+    for(unsigned int i = 0; i < sinks.size(); i++) {
+      sinkStats->Set(i, audioHandlerStats(sinks[i]));
+    }
+    stats->Set(NanNew<String>("sinks"), sinkStats);
+  }
+  NanReturnValue(stats);
+}
+
+NAN_METHOD(NodeSpotify::waitForLoaded) {
+  NanScope();
+  SessionLock sessionLock;
+  if(args.Length() < 2 || !args[0]->IsArray() || !args[1]->IsFunction()) {
+    return NanThrowError("waitForLoaded needs an array of objects and a callback function.");
+  }
+  Handle<Array> objects = args[0].As<Array>();
+  auto callback = std::make_shared<NanCallback>(args[1].As<Function>());
+  for(unsigned int i = 0; i < objects->Length(); i++) {
+    Handle<Value> object = objects->Get(i);
+    if(object->IsObject()) {
+      LoadWatcher::watch(object->ToObject(), callback);
+    }
+  }
+  NanReturnUndefined();
+}
+
+static Local<Object> histogram(const int* limits, const unsigned int* counts, int buckets) {
+  Local<Array> limitsArray = NanNew<Array>(buckets - 1);
+  Local<Array> countsArray = NanNew<Array>(buckets);
+  for(int i = 0; i < buckets; i++) {
+    if(i < buckets - 1) {
+      limitsArray->Set(i, NanNew<Integer>(limits[i]));
+    }
+    countsArray->Set(i, NanNew<Number>(counts[i]));
+  }
+  Local<Object> histogramObject = NanNew<Object>();
+  histogramObject->Set(NanNew<String>("limits"), limitsArray);
+  histogramObject->Set(NanNew<String>("counts"), countsArray);
+  return histogramObject;
+}
+
+template <class K, class T>
+static Local<Object> cacheStats(const WrapperCache<K, T>& cache) {
+  Local<Object> cacheObject = NanNew<Object>();
+  cacheObject->Set(NanNew<String>("size"), NanNew<Integer>(cache.size()));
+  cacheObject->Set(NanNew<String>("hits"), NanNew<Integer>(cache.hits));
+  cacheObject->Set(NanNew<String>("misses"), NanNew<Integer>(cache.misses));
+  cacheObject->Set(NanNew<String>("evictions"), NanNew<Integer>(cache.evictions));
+  return cacheObject;
+}
+
+NAN_METHOD(NodeSpotify::engineStats) {
+  NanScope();
+  static const int durationLimits[ENGINE_DURATION_BUCKETS - 1] = ENGINE_DURATION_LIMITS_US;
+  static const int iterationLimits[ENGINE_ITERATION_BUCKETS - 1] = ENGINE_ITERATION_LIMITS;
+  PumpStats pumpStats;
+  Engine::getPumpStats(&pumpStats);
+  Local<Object> stats = NanNew<Object>();
+  stats->Set(NanNew<String>("engine"), NanNew<String>(Engine::isThreaded() ? "thread" : "loop"));
+  stats->Set(NanNew<String>("pumpBudget"), NanNew<Integer>(Engine::pumpBudget()));
+  stats->Set(NanNew<String>("pumps"), NanNew<Integer>(pumpStats.pumps));
+  stats->Set(NanNew<String>("yields"), NanNew<Integer>(pumpStats.yields));
+  Local<Object> duration = histogram(durationLimits, pumpStats.duration, ENGINE_DURATION_BUCKETS);
+  duration->Set(NanNew<String>("max"), NanNew<Number>((double)pumpStats.maxDuration));
+  stats->Set(NanNew<String>("duration"), duration);
+  Local<Object> iterations = histogram(iterationLimits, pumpStats.iterations, ENGINE_ITERATION_BUCKETS);
+  iterations->Set(NanNew<String>("max"), NanNew<Integer>(pumpStats.maxIterations));
+  stats->Set(NanNew<String>("iterations"), iterations);
+  Local<Object> metadataUpdated = NanNew<Object>();
+  metadataUpdated->Set(NanNew<String>("interval"), NanNew<Integer>(SessionCallbacks::metadataInterval));
+  metadataUpdated->Set(NanNew<String>("notifications"), NanNew<Integer>(SessionCallbacks::metadataNotifications));
+  metadataUpdated->Set(NanNew<String>("dispatches"), NanNew<Integer>(SessionCallbacks::metadataDispatches));
+  stats->Set(NanNew<String>("metadataUpdated"), metadataUpdated);
+  Local<Object> loadWatch = NanNew<Object>();
+  loadWatch->Set(NanNew<String>("pending"), NanNew<Integer>(LoadWatcher::pending()));
+  loadWatch->Set(NanNew<String>("resolved"), NanNew<Integer>(LoadWatcher::resolved));
+  loadWatch->Set(NanNew<String>("checks"), NanNew<Integer>(LoadWatcher::checks));
+  stats->Set(NanNew<String>("loadWatch"), loadWatch);
+  Local<Object> wrappers = NanNew<Object>();
+  wrappers->Set(NanNew<String>("tracks"), cacheStats(NodeTrack::cache));
+  wrappers->Set(NanNew<String>("playlistTracks"), cacheStats(NodeTrackExtended::cache));
+  wrappers->Set(NanNew<String>("albums"), cacheStats(NodeAlbum::cache));
+  wrappers->Set(NanNew<String>("artists"), cacheStats(NodeArtist::cache));
+  wrappers->Set(NanNew<String>("users"), cacheStats(NodeUser::cache));
+  stats->Set(NanNew<String>("wrappers"), wrappers);
+  NanReturnValue(stats);
+}
+
 NAN_METHOD(NodeSpotify::on) {
   NanScope();
   if(args.Length() < 1 || !args[0]->IsObject()) {
@@ -236,6 +763,12 @@ void NodeSpotify::init() {
   NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "useNativeAudio", useNativeAudio);
 #endif
   NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "useNodejsAudio", useNodejsAudio);
+  NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "useFileAudio", useFileAudio);
+  NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "useSharedMemoryAudio", useSharedMemoryAudio);
+  NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "useHttpAudio", useHttpAudio);
+  NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "audioStats", audioStats);
+  NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "engineStats", engineStats);
+  NODE_SET_PROTOTYPE_METHOD(constructorTemplate, "waitForLoaded", waitForLoaded);
   constructorTemplate->InstanceTemplate()->SetAccessor(NanNew<String>("rememberedUser"), getRememberedUser);
   constructorTemplate->InstanceTemplate()->SetAccessor(NanNew<String>("sessionUser"), getSessionUser);
   constructorTemplate->InstanceTemplate()->SetAccessor(NanNew<String>("playlistContainer"), getPlaylistContainer);
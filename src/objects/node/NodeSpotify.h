@@ -24,6 +24,12 @@ public:
   static NAN_METHOD(useNativeAudio);
 #endif
   static NAN_METHOD(useNodejsAudio);
+  static NAN_METHOD(useFileAudio);
+  static NAN_METHOD(useSharedMemoryAudio);
+  static NAN_METHOD(useHttpAudio);
+  static NAN_METHOD(audioStats);
+  static NAN_METHOD(engineStats);
+  static NAN_METHOD(waitForLoaded);
   static NAN_METHOD(on);
   static void init();
 private:
@@ -1,53 +1,72 @@
 #include "NodeTrack.h"
 #include "NodeArtist.h"
 #include "NodeAlbum.h"
+#include "../../Engine.h"
+
+WrapperCache<sp_track*, NodeTrack> NodeTrack::cache;
 
 NodeTrack::NodeTrack(std::shared_ptr<Track> _track) : track(_track) {
 
 };
 
 NodeTrack::~NodeTrack() {
+  cache.remove(track->track, this);
+}
 
+Handle<Object> NodeTrack::fromCache(std::shared_ptr<Track> track) {
+  NodeTrack* nodeTrack = cache.find(track->track);
+  if(nodeTrack != nullptr) {
+    return NanObjectWrapHandle(nodeTrack);
+  }
+  nodeTrack = new NodeTrack(track);
+  Handle<Object> object = nodeTrack->createInstance();
+  cache.add(track->track, nodeTrack);
+  return object;
 }
 
 NAN_GETTER(NodeTrack::getName) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   NanReturnValue(NanNew<String>(nodeTrack->track->name().c_str()));
 }
 
 NAN_GETTER(NodeTrack::getLink) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   NanReturnValue(NanNew<String>(nodeTrack->track->link().c_str()));
 }
 
 NAN_GETTER(NodeTrack::getDuration) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   NanReturnValue(NanNew<Integer>(nodeTrack->track->duration()/1000));
 }
 
 NAN_GETTER(NodeTrack::getAvailability) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   NanReturnValue(NanNew<Integer>(nodeTrack->track->getAvailability()));
 }
 
 NAN_GETTER(NodeTrack::getPopularity) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   NanReturnValue(NanNew<Integer>(nodeTrack->track->popularity()));
 }
 
 NAN_GETTER(NodeTrack::getArtists) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   Local<Array> jsArtists = NanNew<Array>(nodeTrack->track->artists().size());
   for(int i = 0; i < (int)nodeTrack->track->artists().size(); i++) {
     if(nodeTrack->track->artists()[i]) {
-      NodeArtist* nodeArtist = new NodeArtist(std::move(nodeTrack->track->artists()[i]));
-      jsArtists->Set(NanNew<Number>(i), nodeArtist->createInstance());
+      jsArtists->Set(NanNew<Number>(i), NodeArtist::fromCache(std::move(nodeTrack->track->artists()[i])));
     } else {
       jsArtists->Set(NanNew<Number>(i), NanUndefined());
     }
@@ -57,10 +76,10 @@ NAN_GETTER(NodeTrack::getArtists) {
 
 NAN_GETTER(NodeTrack::getAlbum) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   if(nodeTrack->track->album()) {
-    NodeAlbum* nodeAlbum = new NodeAlbum(nodeTrack->track->album());
-    NanReturnValue(nodeAlbum->createInstance());
+    NanReturnValue(NodeAlbum::fromCache(nodeTrack->track->album()));
   } else {
     NanReturnUndefined();
   }
@@ -68,18 +87,21 @@ NAN_GETTER(NodeTrack::getAlbum) {
 
 NAN_GETTER(NodeTrack::getStarred) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   NanReturnValue(NanNew<Boolean>(nodeTrack->track->starred()));
 }
 
 NAN_SETTER(NodeTrack::setStarred) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   nodeTrack->track->setStarred(value->ToBoolean()->Value());
 }
 
 NAN_GETTER(NodeTrack::isLoaded) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrack* nodeTrack = node::ObjectWrap::Unwrap<NodeTrack>(args.This());
   NanReturnValue(NanNew<Boolean>(nodeTrack->track->isLoaded()));
 }
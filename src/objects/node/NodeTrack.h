@@ -2,6 +2,7 @@
 #define _NODE_TRACK_H
 
 #include "NodeWrapped.h"
+#include "WrapperCache.h"
 #include "../spotify/Track.h"
 
 #include <nan.h>
@@ -12,11 +13,17 @@ using namespace v8;
 class NodeTrack : public NodeWrapped<NodeTrack> {
 friend class NodePlayer;
 friend class NodePlaylist;
+friend class LoadWatcher;
 private:
   std::shared_ptr<Track> track;
 public:
   NodeTrack(std::shared_ptr<Track> track);
   ~NodeTrack();
+  /**
+   * The JS object of the track, the one that is already alive if there is one.
+   **/
+  static Handle<Object> fromCache(std::shared_ptr<Track> track);
+  static WrapperCache<sp_track*, NodeTrack> cache;
   static NAN_GETTER(getName);
   static NAN_GETTER(getLink);
   static NAN_GETTER(getArtists);
@@ -1,18 +1,41 @@
 #include "NodeTrackExtended.h"
 #include "NodeUser.h"
+#include "../../Engine.h"
 
 //Since NodeWrapped uses a templating technique to assign the static constructor to each childclass we need to improvise here.
 Persistent<FunctionTemplate> NodeTrackExtended::constructorTemplate;
 
+WrapperCache<std::tuple<sp_playlist*, sp_track*, int>, NodeTrackExtended> NodeTrackExtended::cache;
+
+std::tuple<sp_playlist*, sp_track*, int> NodeTrackExtended::cacheKey(TrackExtended* trackExtended) {
+  return std::make_tuple(trackExtended->playlist, trackExtended->track, trackExtended->position);
+}
+
 NodeTrackExtended::NodeTrackExtended(std::shared_ptr<TrackExtended> _trackExtended) : NodeTrack(_trackExtended), trackExtended(_trackExtended) {
 }
 
+NodeTrackExtended::~NodeTrackExtended() {
+  cache.remove(cacheKey(trackExtended.get()), this);
+}
+
+Handle<Object> NodeTrackExtended::fromCache(std::shared_ptr<TrackExtended> trackExtended) {
+  NodeTrackExtended* nodeTrackExtended = cache.find(cacheKey(trackExtended.get()));
+  if(nodeTrackExtended != nullptr) {
+    return NanObjectWrapHandle(nodeTrackExtended);
+  }
+  nodeTrackExtended = new NodeTrackExtended(trackExtended);
+  Handle<Object> object = nodeTrackExtended->createInstance();
+  cache.add(cacheKey(trackExtended.get()), nodeTrackExtended);
+  return object;
+}
+
 /**
   We need rewrite this method because we need to use our own constructor, not the one from NodeTrack.
+  Wrap makes the handle weak, so the wrapper is deleted when the JS object is collected.
 **/
 Handle<Object> NodeTrackExtended::createInstance() {
   Local<Object> object = getConstructor()->NewInstance();
-  NanSetInternalFieldPointer(object, 0, this);
+  this->Wrap(object);
   return object;
 }
 
@@ -25,35 +48,39 @@ Handle<Function> NodeTrackExtended::getConstructor() {
 
 NAN_GETTER(NodeTrackExtended::getCreator) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrackExtended* nodeTrackExtended = node::ObjectWrap::Unwrap<NodeTrackExtended>(args.This());
   Handle<Value> nodeCreator = NanUndefined();
   if(nodeTrackExtended->trackExtended->creator()) {
-    NodeUser* nodeUser = new NodeUser(nodeTrackExtended->trackExtended->creator());
-    nodeCreator = nodeUser->createInstance();
+    nodeCreator = NodeUser::fromCache(nodeTrackExtended->trackExtended->creator());
   }
   NanReturnValue(nodeCreator);
 }
 
 NAN_GETTER(NodeTrackExtended::getSeen) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrackExtended* nodeTrackExtended = node::ObjectWrap::Unwrap<NodeTrackExtended>(args.This());
   NanReturnValue(NanNew<Boolean>(nodeTrackExtended->trackExtended->seen()));
 }
 
 NAN_SETTER(NodeTrackExtended::setSeen) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrackExtended* nodeTrackExtended = node::ObjectWrap::Unwrap<NodeTrackExtended>(args.This());
   nodeTrackExtended->trackExtended->seen(value->ToBoolean()->Value());
 }
 
 NAN_GETTER(NodeTrackExtended::getCreateTime) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrackExtended* nodeTrackExtended = node::ObjectWrap::Unwrap<NodeTrackExtended>(args.This());
   NanReturnValue(NanNew<Date>(nodeTrackExtended->trackExtended->createTime() * 1000));
 }
 
 NAN_GETTER(NodeTrackExtended::getMessage) {
   NanScope();
+  SessionLock sessionLock;
   NodeTrackExtended* nodeTrackExtended = node::ObjectWrap::Unwrap<NodeTrackExtended>(args.This());
   NanReturnValue(NanNew<String>(nodeTrackExtended->trackExtended->message().c_str()));
 }
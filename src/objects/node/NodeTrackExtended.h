@@ -6,14 +6,22 @@
 
 #include <nan.h>
 #include <memory>
+#include <tuple>
 
 using namespace v8;
 
 class NodeTrackExtended : public NodeTrack {
 private:
   std::shared_ptr<TrackExtended> trackExtended;
+  static std::tuple<sp_playlist*, sp_track*, int> cacheKey(TrackExtended* trackExtended);
 public:
   NodeTrackExtended(std::shared_ptr<TrackExtended> trackExtended);
+  ~NodeTrackExtended();
+  /**
+   * The same track may be in a playlist more than once, the position is part of the key.
+   **/
+  static Handle<Object> fromCache(std::shared_ptr<TrackExtended> trackExtended);
+  static WrapperCache<std::tuple<sp_playlist*, sp_track*, int>, NodeTrackExtended> cache;
   static NAN_GETTER(getCreator);
   static NAN_GETTER(getSeen);
   static NAN_SETTER(setSeen);
@@ -1,37 +1,59 @@
 #include "NodeUser.h"
 #include "NodePlaylistContainer.h"
 #include "NodePlaylist.h"
+#include "../../Engine.h"
+
+WrapperCache<sp_user*, NodeUser> NodeUser::cache;
 
 NodeUser::NodeUser(std::unique_ptr<User> _user) : user(std::move(_user)) {}
 
-NodeUser::~NodeUser() {}
+NodeUser::~NodeUser() {
+  cache.remove(user->user, this);
+}
+
+Handle<Object> NodeUser::fromCache(std::unique_ptr<User> user) {
+  NodeUser* nodeUser = cache.find(user->user);
+  if(nodeUser != nullptr) {
+    return NanObjectWrapHandle(nodeUser);
+  }
+  sp_user* key = user->user;
+  nodeUser = new NodeUser(std::move(user));
+  Handle<Object> object = nodeUser->createInstance();
+  cache.add(key, nodeUser);
+  return object;
+}
 
 NAN_GETTER(NodeUser::getLink) {
   NanScope();
+  SessionLock sessionLock;
   NodeUser* nodeUser = node::ObjectWrap::Unwrap<NodeUser>(args.This());
   NanReturnValue(NanNew<String>(nodeUser->user->link().c_str()));
 }
 
 NAN_GETTER(NodeUser::getCanonicalName) {
   NanScope();
+  SessionLock sessionLock;
   NodeUser* nodeUser = node::ObjectWrap::Unwrap<NodeUser>(args.This());
   NanReturnValue(NanNew<String>(nodeUser->user->canonicalName().c_str()));
 }
 
 NAN_GETTER(NodeUser::getDisplayName) {
   NanScope();
+  SessionLock sessionLock;
   NodeUser* nodeUser = node::ObjectWrap::Unwrap<NodeUser>(args.This());
   NanReturnValue(NanNew<String>(nodeUser->user->displayName().c_str()));
 }
 
 NAN_GETTER(NodeUser::isLoaded) {
   NanScope();
+  SessionLock sessionLock;
   NodeUser* nodeUser = node::ObjectWrap::Unwrap<NodeUser>(args.This());
   NanReturnValue(NanNew<Boolean>(nodeUser->user->isLoaded()));
 }
 
 NAN_GETTER(NodeUser::getPublishedPlaylistsContainer) {
   NanScope();
+  SessionLock sessionLock;
   NodeUser* nodeUser = node::ObjectWrap::Unwrap<NodeUser>(args.This());
   auto playlistContainer = nodeUser->user->publishedPlaylists();
   NodePlaylistContainer* nodePlaylistContainer = new NodePlaylistContainer(playlistContainer);
@@ -40,6 +62,7 @@ NAN_GETTER(NodeUser::getPublishedPlaylistsContainer) {
 
 NAN_GETTER(NodeUser::getStarredPlaylist) {
   NanScope();
+  SessionLock sessionLock;
   NodeUser* nodeUser = node::ObjectWrap::Unwrap<NodeUser>(args.This());
   auto playlist = nodeUser->user->starredPlaylist();
   NodePlaylist* nodePlaylist = new NodePlaylist(playlist);
@@ -2,6 +2,7 @@
 #define _NODE_USER_H
 
 #include "NodeWrapped.h"
+#include "WrapperCache.h"
 #include "../spotify/User.h"
 
 #include <nan.h>
@@ -10,11 +11,14 @@
 using namespace v8;
 
 class NodeUser : public NodeWrapped<NodeUser> {
+friend class LoadWatcher;
 private:
   std::unique_ptr<User> user;
 public:
   NodeUser(std::unique_ptr<User> user);
   ~NodeUser();
+  static Handle<Object> fromCache(std::unique_ptr<User> user);
+  static WrapperCache<sp_user*, NodeUser> cache;
   static NAN_GETTER(getCanonicalName);
   static NAN_GETTER(getDisplayName);
   static NAN_GETTER(isLoaded);
@@ -0,0 +1,52 @@
+#ifndef _WRAPPER_CACHE_H
+#define _WRAPPER_CACHE_H
+
+#include <map>
+
+/**
+ * The wrappers that are alive, by the libspotify object they wrap, so the same libspotify object always gives the same
+ * JS object. A wrapper removes itself in its destructor, which node::ObjectWrap calls from the weak callback when its
+ * JS object was collected. The map does not keep the wrappers alive.
+ **/
+template <class K, class T>
+class WrapperCache {
+public:
+  WrapperCache() : hits(0), misses(0), evictions(0) {}
+
+  T* find(const K& key) {
+    auto it = wrappers.find(key);
+    if(it == wrappers.end()) {
+      misses++;
+      return nullptr;
+    }
+    hits++;
+    return it->second;
+  }
+
+  void add(const K& key, T* wrapper) {
+    wrappers[key] = wrapper;
+  }
+
+  /**
+   * Only removes the entry if it is still the one of this wrapper.
+   **/
+  void remove(const K& key, T* wrapper) {
+    auto it = wrappers.find(key);
+    if(it != wrappers.end() && it->second == wrapper) {
+      wrappers.erase(it);
+      evictions++;
+    }
+  }
+
+  int size() const {
+    return wrappers.size();
+  }
+
+  int hits;
+  int misses;
+  int evictions;
+private:
+  std::map<K, T*> wrappers;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "Album.h"
 #include "../../utils/ImageUtils.h"
 #include "../../Application.h"
+#include "../../Engine.h"
 #include "../../callbacks/AlbumBrowseCallbacks.h"
 
 extern Application* application;
@@ -20,6 +21,8 @@ Album::Album(const Album& other) : album(other.album), cover(other.cover) {
 };
 
 Album::~Album() {
+  SessionLock sessionLock;
+  Engine::forget(this);
   sp_album_release(album);
   if(cover != nullptr) {
     sp_image_release(cover);
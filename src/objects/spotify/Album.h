@@ -16,6 +16,7 @@ class NodeAlbum;
 
 class Album {
 friend class NodeAlbum;
+friend class LoadWatcher;
 friend class AlbumBrowseCallbacks;
 public:
   Album(sp_album* _album);
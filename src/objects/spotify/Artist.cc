@@ -1,6 +1,7 @@
 #include "Artist.h"
 #include "../../callbacks/ArtistBrowseCallbacks.h"
 #include "../../Application.h"
+#include "../../Engine.h"
 
 extern Application* application;
 
@@ -16,6 +17,8 @@ Artist::Artist(sp_artist* _artist) : artist(_artist), artistBrowse(nullptr), nod
 };
 
 Artist::~Artist() {
+  SessionLock sessionLock;
+  Engine::forget(this);
   sp_artist_release(artist);
   if(artistBrowse != nullptr) {
     sp_artistbrowse_release(artistBrowse);
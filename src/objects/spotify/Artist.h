@@ -16,6 +16,7 @@ class NodeArtist;
 
 class Artist {
 friend class NodeArtist;
+friend class LoadWatcher;
 friend class ArtistBrowseCallbacks;
 public:
   Artist(sp_artist* _artist);
@@ -4,9 +4,27 @@
 
 extern Application* application;
 
-Player::Player() : currentSecond(0), isPaused(false), isLoading(false), loadingTrack(nullptr) {}
+/**
+ * "Artist - Track" for sinks that send a title along, empty if the track is not loaded.
+ */
+static std::string streamTitle(sp_track* track) {
+  if(!sp_track_is_loaded(track)) {
+    return std::string();
+  }
+  std::string title(sp_track_name(track));
+  if(sp_track_num_artists(track) > 0) {
+    title = std::string(sp_artist_name(sp_track_artist(track, 0))) + " - " + title;
+  }
+  return title;
+}
+
+Player::Player() : positionOrigin(0), originEpoch(0), volume(1), isPaused(false), isLoading(false), loadingTrack(nullptr) {}
 
 void Player::stop() {
+  setNext(nullptr);
+  if(application->audioHandler) {
+    application->audioHandler->releaseHeldBack();
+  }
   sp_session_player_unload(application->session);
 }
 
@@ -32,9 +50,9 @@ void Player::play(std::shared_ptr<Track> track) {
   }
 #endif
   application->audioHandler->setStopped(false);
-  application->audioHandler->framesReceived = 0;
-  application->audioHandler->currentSecond = 0;
-  currentSecond = 0;
+  originEpoch = application->audioHandler->resetClock();
+  positionOrigin = 0;
+  application->audioHandler->setTitle(originEpoch, streamTitle(track->track));
   sp_error error = sp_session_player_load(application->session, track->track);
   if(error == SP_ERROR_IS_LOADING) {
     isLoading = true;
@@ -57,10 +75,69 @@ void Player::retryPlay() {
 }
 
 void Player::seek(int second) {
+  //New epoch before the seek, like play does before the load, audio of the new position must not be flushed.
+  originEpoch = application->audioHandler->resetClock();
+  positionOrigin = second*1000;
   sp_session_player_seek(application->session, second*1000);
-  application->audioHandler->currentSecond = second;
 }
 
-void Player::setCurrentSecond(int second) {
-  currentSecond = second;
+void Player::setNext(std::shared_ptr<Track> track) {
+  nextTrack = track;
+  if(nextTrack) {
+    sp_session_player_prefetch(application->session, nextTrack->track);
+  }
+  if(application->audioHandler) {
+    application->audioHandler->armCrossfade(nextTrack != nullptr);
+  }
+}
+
+bool Player::playNext() {
+  if(!nextTrack || !application->audioHandler) {
+    return false;
+  }
+  std::shared_ptr<Track> track = nextTrack;
+  nextTrack.reset();
+  sp_error error = sp_session_player_load(application->session, track->track);
+  if(error == SP_ERROR_TRACK_NOT_PLAYABLE) {
+    return false;
+  }
+  //Unlike play the queue is not flushed, the end of the current track is still in there.
+  int epoch = application->audioHandler->queueNextTrack();
+  application->audioHandler->setTitle(epoch, streamTitle(track->track));
+  if(error == SP_ERROR_IS_LOADING) {
+    isLoading = true;
+    loadingTrack = track->track;
+  } else {
+    sp_session_player_play(application->session, 1);
+  }
+  return true;
+}
+
+double Player::position() {
+  if(!application->audioHandler) {
+    return positionOrigin;
+  }
+  int epoch;
+  double played = application->audioHandler->playedMilliseconds(&epoch);
+  return (epoch == originEpoch ? positionOrigin : 0) + played;
+}
+
+void Player::setVolume(double _volume) {
+  volume = _volume < 0 ? 0 : (_volume > 1 ? 1 : _volume);
+  if(application->audioHandler) {
+    application->audioHandler->setVolume(volume);
+  }
+}
+
+void Player::useAudioHandler(std::unique_ptr<AudioHandler> audioHandler) {
+  audioHandler->setVolume(volume);
+  if(isPaused) {
+    audioHandler->setStopped(true);
+  }
+  audioHandler->armCrossfade(nextTrack != nullptr);
+  AudioHandler::replace(application->audioHandler, std::move(audioHandler));
+}
+
+double Player::getVolume() {
+  return volume;
 }
@@ -6,6 +6,8 @@
 #include <libspotify/api.h>
 #include <memory>
 
+class AudioHandler;
+
 class Player {
 friend class NodePlayer;
 friend class SessionCallbacks;
@@ -16,9 +18,41 @@ public:
   void resume();
   void play(std::shared_ptr<Track> track);
   void seek(int second);
-  void setCurrentSecond(int second);
+  /**
+   * @brief setNext Track to play without a gap when the current one ends. libspotify starts prefetching it right away.
+   * @param track the next track or nullptr to play none.
+   */
+  void setNext(std::shared_ptr<Track> track);
+  /**
+   * @brief playNext Load the track set with setNext, keeping the queued audio of the current one.
+   * @return false if there is no next track or it can't be played.
+   */
+  bool playNext();
+  /**
+   * @brief position Milliseconds into the current track the audio sink has played.
+   */
+  double position();
+  /**
+   * @brief setVolume Set the volume, clamped to 0 (silent) to 1 (as delivered by libspotify).
+   */
+  void setVolume(double volume);
+  double getVolume();
+  /**
+   * @brief useAudioHandler Play through audioHandler from now on. Audio that is already queued moves to it, so
+   * playback goes on without a gap.
+   */
+  void useAudioHandler(std::unique_ptr<AudioHandler> audioHandler);
 private:
-  int currentSecond;
+  /**
+   * Where in the track the playback clock of the audio handler was started, in milliseconds.
+   */
+  int positionOrigin;
+  /**
+   * Epoch of the audio handler's clock positionOrigin applies to. Tracks started gaplessly have another one and start at 0.
+   */
+  int originEpoch;
+  std::shared_ptr<Track> nextTrack;
+  double volume;
   bool isPaused;
   bool isLoading;
   sp_track* loadingTrack;
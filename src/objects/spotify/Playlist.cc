@@ -3,6 +3,7 @@
 #include "Track.h"
 #include "TrackExtended.h"
 #include "../../Application.h"
+#include "../../Engine.h"
 #include "../../exceptions.h"
 
 extern Application* application;
@@ -28,6 +29,7 @@ Playlist::Playlist(const Playlist& other) : PlaylistBase(other.isFolder), playli
 }
 
 Playlist::~Playlist() {
+  SessionLock sessionLock;
   sp_playlist_release(playlist);
 }
 
@@ -15,6 +15,7 @@ class TrackExtended;
 
 class Playlist : public PlaylistBase {
 friend class NodePlaylist;
+friend class LoadWatcher;
 friend class PlaylistCallbacksHolder;
 friend class PlaylistContainer;
 public:
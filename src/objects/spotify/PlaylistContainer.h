@@ -13,6 +13,7 @@ class User;
 
 class PlaylistContainer {
 friend class NodePlaylistContainer;
+friend class LoadWatcher;
 public:
   PlaylistContainer(sp_playlistcontainer* _playlistContainer) : playlistContainer(_playlistContainer) {}
   std::shared_ptr<PlaylistBase> getPlaylist(int index);
@@ -1,5 +1,6 @@
 #include "Search.h"
 #include "../../Application.h"
+#include "../../Engine.h"
 #include "../../callbacks/SearchCallbacks.h"
 
 #include <libspotify/api.h>
@@ -11,6 +12,8 @@ Search::Search(const Search& other) : search(other.search) {
 };
 
 Search::~Search() {
+  SessionLock sessionLock;
+  Engine::forget(this);
   sp_search_release(search);
 };
 
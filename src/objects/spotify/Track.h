@@ -3,6 +3,7 @@
 
 #include "Artist.h"
 #include "Album.h"
+#include "../../Engine.h"
 
 #include <libspotify/api.h>
 #include <string>
@@ -16,12 +17,15 @@ class Track {
 friend class Player;
 friend class Playlist;
 friend class NodeTrack;
+friend class LoadWatcher;
+friend class NodeTrackExtended;
 public:
   Track(sp_track* _track);
   Track(const Track& other) : track(other.track) {
       sp_track_add_ref(track);
     };
   virtual ~Track() {
+    SessionLock sessionLock;
     sp_track_release(track);
   };
 
@@ -1,10 +1,12 @@
 #include "TrackExtended.h"
+#include "../../Engine.h"
 
 TrackExtended::TrackExtended(sp_track* _track, sp_playlist* _playlist, int _position) : Track(_track), playlist(_playlist), position(_position) {
   sp_playlist_add_ref(playlist);
 }
 
 TrackExtended::~TrackExtended() {
+  SessionLock sessionLock;
   sp_playlist_release(playlist);
 }
 
@@ -9,6 +9,7 @@
 #include <string>
 
 class TrackExtended : public Track {
+friend class NodeTrackExtended;
 private:
   sp_playlist* playlist;
   int position;
@@ -1,6 +1,7 @@
 #include "User.h"
 #include "StarredPlaylist.h"
 #include "../../Application.h"
+#include "../../Engine.h"
 
 extern Application* application;
 
@@ -13,6 +14,7 @@ User::User(const User& other) : user(other.user) {
 };
 
 User::~User() {
+  SessionLock sessionLock;
   sp_user_release(user);
 }
 
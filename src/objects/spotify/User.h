@@ -12,6 +12,7 @@ class PlaylistContainer;
 
 class User {
 friend class NodeUser;
+friend class LoadWatcher;
 public:
   User(sp_user* user);
   User(const User& other);
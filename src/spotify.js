@@ -1,5 +1,5 @@
 var _spotify = require('./nodespotify');
-var metadataUpdater = require('./metadataUpdater');
+var stream = require('stream');
 
 function addMethodsToPrototypes(sp) {
   function arrayGetter(name, refer) {
@@ -63,26 +63,63 @@ function addMethodsToPrototypes(sp) {
   }
 }
 
-var beefedupSpotify = function(options) {
-  var spotify = _spotify(options);
-  addMethodsToPrototypes(spotify);
-  spotify.version = '0.7.1';
+/**
+ * Creates a Readable stream of the raw PCM audio (16 bit, native endianness). Audio is only taken from
+ * libspotify as fast as the stream is read, highWaterMark is the number of frames the stream buffers.
+ * A 'format' event with sampleRate and channels is emitted before the first audio and whenever it changes.
+ * The stream ends when its audio handler is replaced by another call of spotify.use*Audio or player.stream.
+ * lowWatermark, highWatermark, crossfade and crossfadeCurve are passed on to the native audio handler.
+ * With add the stream is another sink of the current audio handler, backpressure says what happens if it is not
+ * read fast enough.
+ **/
+function createAudioStream(spotify, options) {
+  options = options || {};
+  //libspotify delivers 16 bit stereo
+  var highWaterMark = (options.highWaterMark || 44100) * 4;
+  var audioStream = new stream.Readable({ highWaterMark: highWaterMark });
+  var format;
 
-  var _on = spotify.on;
-  spotify.on = function(callbacks) {
-    if(callbacks.metadataUpdated) {
-      var userCallback = callbacks.metadataUpdated;
-      callbacks.metadataUpdated = function() {
-        userCallback();
-        metadataUpdater.metadataUpdated();
+  function pull() {
+    var buffer;
+    while((buffer = read(highWaterMark)) !== null) {
+      if(buffer === false) {
+        //The audio handler was replaced, the audio goes on there
+        audioStream.push(null);
+        return;
+      }
+      if(!format || format.sampleRate !== buffer.sampleRate || format.channels !== buffer.channels) {
+        format = { sampleRate: buffer.sampleRate, channels: buffer.channels };
+        audioStream.emit('format', format);
+      }
+      if(!audioStream.push(buffer)) {
+        return;
       }
-    } else {
-      callbacks.metadataUpdated = metadataUpdater.metadataUpdated;
     }
-    _on.call(spotify, callbacks);
   }
 
-  spotify.waitForLoaded = metadataUpdater.waitForLoaded;
+  var read = spotify.useNodejsAudio(pull, {
+    pull: true,
+    lowWatermark: options.lowWatermark,
+    highWatermark: options.highWatermark,
+    crossfade: options.crossfade,
+    crossfadeCurve: options.crossfadeCurve,
+    outputRate: options.outputRate,
+    resampleQuality: options.resampleQuality,
+    add: options.add,
+    backpressure: options.backpressure
+  });
+  audioStream._read = pull;
+  return audioStream;
+}
+
+var beefedupSpotify = function(options) {
+  var spotify = _spotify(options);
+  addMethodsToPrototypes(spotify);
+  spotify.version = '0.7.1';
+
+  spotify.player.stream = function(options) {
+    return createAudioStream(spotify, options);
+  };
   return spotify;
 }
 
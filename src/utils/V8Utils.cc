@@ -11,4 +11,27 @@ std::unique_ptr<NanCallback> V8Utils::getFunctionFromObject(Handle<Object> callb
     callback = std::unique_ptr<NanCallback>(new NanCallback(callbacks->Get(key).As<Function>()));
   }
   return callback;
-}
\ No newline at end of file
+}
+
+/**
+  Get a field from an object as an integer. defaultValue if the key does not exist or is not a number.
+**/
+int V8Utils::getIntegerFromObject(Handle<Object> options, Handle<String> key, int defaultValue) {
+  if(options->Has(key)) {
+    Handle<Value> value = options->Get(key);
+    if(value->IsNumber()) {
+      return value->ToInteger()->Value();
+    }
+  }
+  return defaultValue;
+}
+
+/**
+  Get a field from an object as a boolean. defaultValue if the key does not exist.
+**/
+bool V8Utils::getBooleanFromObject(Handle<Object> options, Handle<String> key, bool defaultValue) {
+  if(options->Has(key)) {
+    return options->Get(key)->ToBoolean()->BooleanValue();
+  }
+  return defaultValue;
+}
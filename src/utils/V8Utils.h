@@ -7,6 +7,8 @@
 class V8Utils {
 public:
   static std::unique_ptr<NanCallback> getFunctionFromObject(v8::Handle<v8::Object> callbacks, v8::Handle<v8::String> key);
+  static int getIntegerFromObject(v8::Handle<v8::Object> options, v8::Handle<v8::String> key, int defaultValue);
+  static bool getBooleanFromObject(v8::Handle<v8::Object> options, v8::Handle<v8::String> key, bool defaultValue);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+var fs = require('fs');
+
+baseTest.executeTest(test);
+
+/*
+ * Plays into ALSA devices that need no sound card. The null and file devices take audio as fast as it comes, so they
+ * have to play at least in real time, with a small and a large period. The file device has to write the audio that
+ * was played. The dummy sound card (modprobe snd-dummy) plays in real time and is skipped if it is missing. A device
+ * that does not exist must not take the process down but keep the track going.
+ */
+var secondsPerDevice = 10;
+var rawFile = '/tmp/node-spotify-alsa.raw';
+var devices = [
+  { device: 'null', periodSize: 256, bufferSize: 1024 },
+  { device: 'null', periodSize: 8192, bufferSize: 32768 },
+  { device: 'file:FILE=' + rawFile + ',FORMAT=raw', outputRate: 48000 },
+  { device: 'hw:Dummy', outputRate: 48000, periodSize: 512, bufferSize: 2048, realTime: true },
+  { device: 'does-not-exist' }
+];
+var track;
+
+function play(options, done) {
+  spotify.useNativeAudio(options);
+  spotify.player.play(track);
+  setTimeout(function() {
+    var output = spotify.audioStats().output;
+    var position = spotify.player.position;
+    spotify.player.stop();
+    //Closes the device, so the file device has written everything.
+    spotify.useNativeAudio();
+    console.log(options.device + ': played ' + (position / 1000).toFixed(2) + ' s, ' + output.xruns + ' xruns, ' +
+      'period ' + output.periodSize + ', buffer ' + output.bufferSize + (output.mmap ? ', mmap' : ', no mmap') +
+      (output.openFailures ? ', could not be opened ' + output.openFailures + ' times' : ''));
+    var tooSlow = position < secondsPerDevice * 1000 - 1500;
+    var tooFast = options.realTime && position > secondsPerDevice * 1000 + 1500;
+    if(options.device === 'hw:Dummy' && output.openFailures > 0) {
+      console.log('No dummy sound card, skipped');
+    } else if(tooSlow || tooFast) {
+      console.log('FAIL: ' + options.device + ' did not play ' + (options.realTime ? 'in' : 'at least in') + ' real time');
+    }
+    if(options.device.indexOf('file:') === 0) {
+      var seconds = fs.statSync(rawFile).size / 4 / 48000;
+      if(seconds < position / 1000 - 0.5) {
+        console.log('FAIL: the file device wrote ' + seconds.toFixed(2) + ' s of audio');
+      }
+      fs.unlinkSync(rawFile);
+    }
+    if(options.device === 'does-not-exist' && output.openFailures === 0) {
+      console.log('FAIL: opening a device that does not exist did not fail');
+    }
+    done();
+  }, secondsPerDevice * 1000);
+}
+
+function test() {
+  console.log('Starting tests, ' + secondsPerDevice + ' seconds per device');
+  track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var next = 0;
+  function runNext() {
+    if(next === devices.length) {
+      spotify.logout(function () {
+        process.exit();
+      });
+      return;
+    }
+    play(devices[next++], runNext);
+  }
+  runNext();
+}
@@ -0,0 +1,54 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+var fs = require('fs');
+
+baseTest.executeTest(test);
+
+/*
+ * Plays a track to a file and adds two node.js sinks: one that stops taking audio after the first buffer and skips
+ * what it cannot take, and one that takes everything. The stalled sink must not slow down the file, the other node.js
+ * sink must get all of the audio and the stalled one must report what it dropped.
+ */
+var seconds = 10;
+var path = '/tmp/node-spotify-sinks.wav';
+
+function test() {
+  var track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var framesTaken = 0;
+  spotify.useFileAudio(path);
+  spotify.useNodejsAudio(function(err, buffer) {
+    return false;
+  }, { add: true, backpressure: 'skip' });
+  spotify.useNodejsAudio(function(err, buffer) {
+    framesTaken += buffer.numberOfSamples;
+    return true;
+  }, { add: true, backpressure: 'block' });
+  spotify.player.play(track);
+
+  setTimeout(function() {
+    var position = spotify.player.position;
+    var stats = spotify.audioStats();
+    spotify.player.stop();
+    spotify.useFileAudio('/dev/null', { format: 'raw' });
+    fs.unlinkSync(path);
+    console.log('file: ' + (position / 1000).toFixed(2) + ' s in ' + seconds + ' s, sinks: ' +
+      stats.sinks.map(function(sink) {
+        return sink.telemetry.framesConsumed + ' frames played, ' + sink.telemetry.framesDropped + ' dropped';
+      }).join(', '));
+    if(stats.sinks.length !== 2) {
+      console.log('FAIL: ' + stats.sinks.length + ' sinks instead of 2');
+    }
+    if(position < seconds * 1000 - 1500) {
+      console.log('FAIL: the stalled sink held up the file');
+    }
+    if(stats.sinks[0].telemetry.framesDropped === 0) {
+      console.log('FAIL: the stalled sink dropped nothing');
+    }
+    if(framesTaken < stats.telemetry.framesConsumed - 44100) {
+      console.log('FAIL: the blocking sink got ' + framesTaken + ' of ' + stats.telemetry.framesConsumed + ' frames');
+    }
+    spotify.logout(function () {
+      process.exit();
+    });
+  }, seconds * 1000);
+}
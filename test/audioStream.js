@@ -0,0 +1,35 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+var stream = require('stream');
+
+baseTest.executeTest(test);
+
+/*
+ * Pipes the player stream into a writable that is slower than real time and checks that the stream
+ * throttles libspotify instead of dropping audio.
+ */
+function test() {
+  console.log('Starting tests');
+  var bytes = 0;
+  var slowWritable = new stream.Writable();
+  slowWritable._write = function(chunk, encoding, done) {
+    bytes += chunk.length;
+    setTimeout(done, 200);
+  };
+
+  var audioStream = spotify.player.stream({ highWaterMark: 4410 });
+  audioStream.on('format', function(format) {
+    console.log('Format: ' + format.sampleRate + ' Hz, ' + format.channels + ' channels');
+  });
+  audioStream.pipe(slowWritable);
+
+  var track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  spotify.player.play(track);
+  setTimeout( function() {
+    console.log('Received ' + bytes + ' bytes in 10 seconds, queued natively: ' + spotify.audioStats().pool.chunksInUse + ' chunks');
+    spotify.player.stop();
+    spotify.logout(function () {
+      process.exit();
+    });
+  }, 10000);
+}
@@ -0,0 +1,173 @@
+/**
+ * Compares the two ways of moving audio from the fifo to the node.js side: polling with a 20 ms uv_timer that takes
+ * one chunk per tick (how NodeAudioHandler used to work) and a uv_async_t sent on delivery that drains the queue.
+ * Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_delivery_bench.c src/audio/audio.c src/audio/audio-pool.c \
+ *     src/audio/audio-dsp.c -luv -lpthread
+ *   ./a.out
+ *
+ * A synthetic producer thread delivers 10 ms chunks in real time for two seconds and then stays silent for one second.
+ * Reported are the delay between delivery and consumption, whether consumption kept up and how often the loop woke up
+ * while there was nothing to do.
+ **/
+#include "../src/audio/audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define SAMPLE_RATE 44100
+#define CHUNK_FRAMES 441
+#define PLAY_MS 2000
+#define IDLE_MS 1000
+#define MAX_CHUNKS (PLAY_MS / 10)
+
+typedef struct bench {
+  audio_fifo_t audioFifo;
+  audio_pool_t* pool;
+  uv_loop_t* loop;
+  uv_async_t notify;
+  uv_timer_t poll;
+  uv_timer_t end;
+  int useAsync;
+  int producing;
+  uint64_t idleSince;
+  unsigned int wakeups;
+  unsigned int idleWakeups;
+  unsigned int consumed;
+  uint64_t latencies[MAX_CHUNKS];
+} bench_t;
+
+static void consume(bench_t* bench, audio_fifo_data_t* audioData) {
+  uint64_t delivered;
+  memcpy(&delivered, audioData->samples, sizeof(delivered));
+  if(bench->consumed < MAX_CHUNKS) {
+    bench->latencies[bench->consumed] = uv_hrtime() - delivered;
+  }
+  bench->consumed++;
+  audio_data_free(audioData);
+}
+
+static void countWakeup(bench_t* bench) {
+  bench->wakeups++;
+  if(!__atomic_load_n(&bench->producing, __ATOMIC_ACQUIRE) && bench->idleSince > 0) {
+    bench->idleWakeups++;
+  }
+}
+
+static void pollTimeout(uv_timer_t* timer) {
+  bench_t* bench = timer->data;
+  audio_fifo_data_t* audioData;
+  countWakeup(bench);
+  if((audioData = audio_get(&bench->audioFifo))) {
+    consume(bench, audioData);
+  }
+}
+
+static void musicAvailable(uv_async_t* handle) {
+  bench_t* bench = handle->data;
+  audio_fifo_data_t* audioData;
+  countWakeup(bench);
+  while((audioData = audio_get(&bench->audioFifo))) {
+    consume(bench, audioData);
+  }
+}
+
+static void endTimeout(uv_timer_t* timer) {
+  bench_t* bench = timer->data;
+  uv_close((uv_handle_t*)&bench->notify, NULL);
+  uv_close((uv_handle_t*)&bench->poll, NULL);
+  uv_close((uv_handle_t*)&bench->end, NULL);
+}
+
+static void producer(void* aux) {
+  bench_t* bench = aux;
+  uint64_t start = uv_hrtime();
+  int i;
+  for(i = 0; i < MAX_CHUNKS; i++) {
+    uint64_t due = start + (uint64_t)i * 10 * 1000000;
+    uint64_t now = uv_hrtime();
+    if(due > now) {
+      usleep((due - now) / 1000);
+    }
+    audio_fifo_data_t* audioData = audio_data_alloc(bench->pool, CHUNK_FRAMES * 2 * sizeof(int16_t));
+    audioData->channels = 2;
+    audioData->sampleRate = SAMPLE_RATE;
+    audioData->numberOfSamples = CHUNK_FRAMES;
+    now = uv_hrtime();
+    memcpy(audioData->samples, &now, sizeof(now));
+    if(!audio_fifo_put(&bench->audioFifo, audioData)) {
+      audio_data_free(audioData);
+    }
+    if(bench->useAsync) {
+      uv_async_send(&bench->notify);
+    }
+  }
+  bench->idleSince = uv_hrtime();
+  __atomic_store_n(&bench->producing, 0, __ATOMIC_RELEASE);
+}
+
+static int compareLatency(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+static double cpuMs(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3 + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+static void run(int useAsync) {
+  static bench_t bench;
+  uv_thread_t producerThread;
+  unsigned int measured, i;
+  uint64_t sum = 0;
+  double cpuBefore;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.useAsync = useAsync;
+  bench.producing = 1;
+  bench.pool = audio_pool_create();
+  bench.loop = uv_default_loop();
+  audio_init(&bench.audioFifo);
+
+  uv_async_init(bench.loop, &bench.notify, musicAvailable);
+  bench.notify.data = &bench;
+  uv_timer_init(bench.loop, &bench.poll);
+  bench.poll.data = &bench;
+  if(!useAsync) {
+    uv_timer_start(&bench.poll, pollTimeout, 0, 20);
+  }
+  uv_timer_init(bench.loop, &bench.end);
+  bench.end.data = &bench;
+  uv_timer_start(&bench.end, endTimeout, PLAY_MS + IDLE_MS, 0);
+
+  cpuBefore = cpuMs();
+  uv_thread_create(&producerThread, producer, &bench);
+  uv_run(bench.loop, UV_RUN_DEFAULT);
+  uv_thread_join(&producerThread);
+
+  measured = bench.consumed < MAX_CHUNKS ? bench.consumed : MAX_CHUNKS;
+  qsort(bench.latencies, measured, sizeof(uint64_t), compareLatency);
+  for(i = 0; i < measured; i++) {
+    sum += bench.latencies[i];
+  }
+  printf("%-13s consumed %3u/%u chunks, left in queue %4d ms, latency mean %6.2f ms p99 %6.2f ms max %6.2f ms, "
+    "wakeups %3u (%2u while idle), cpu %.1f ms\n",
+    useAsync ? "uv_async" : "20 ms timer", bench.consumed, MAX_CHUNKS, audio_fifo_samples(&bench.audioFifo) * 1000 / SAMPLE_RATE,
+    measured ? sum / measured / 1e6 : 0.0, measured ? bench.latencies[measured * 99 / 100] / 1e6 : 0.0,
+    measured ? bench.latencies[measured - 1] / 1e6 : 0.0, bench.wakeups, bench.idleWakeups, cpuMs() - cpuBefore);
+
+  audio_stop(&bench.audioFifo);
+  audio_pool_release(bench.pool);
+}
+
+int main(void) {
+  run(0);
+  run(1);
+  return 0;
+}
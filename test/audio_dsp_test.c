@@ -0,0 +1,206 @@
+/**
+ * Test and benchmark for the vectorised audio kernels. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_dsp_test.c src/audio/audio-dsp.c -luv
+ *   ./a.out
+ *
+ * Every kernel is compared sample by sample with a plain C version, for lengths that do and don't fill whole
+ * vectors, with full scale input that has to saturate and with the output written over an input like the crossfade
+ * does. The float conversions must be exact, interleaved and planar. The volume ramp must change the gain smoothly and end at the new volume. Then it reports how many times
+ * faster than real time a 44.1 kHz stereo stream is processed.
+ **/
+#include "../src/audio/audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_SAMPLES 8192
+#define BENCH_SECONDS 60
+#define BENCH_SAMPLES (44100 * 2)
+
+static int16_t a[MAX_SAMPLES], b[MAX_SAMPLES], gainA[MAX_SAMPLES], gainB[MAX_SAMPLES];
+static int16_t expected[MAX_SAMPLES], actual[MAX_SAMPLES];
+static float floats[MAX_SAMPLES];
+
+static int16_t randomSample(int fullScale) {
+  if(fullScale) {
+    return rand() % 2 ? INT16_MAX : INT16_MIN;
+  }
+  return (int16_t)(rand() % 65536 - 32768);
+}
+
+static void referenceMix(int16_t* dst, int samples) {
+  int i;
+  for(i = 0; i < samples; i++) {
+    int32_t mixed = ((int32_t)a[i] * gainA[i] + (int32_t)b[i] * gainB[i] + (1 << 14)) >> 15;
+    dst[i] = mixed > INT16_MAX ? INT16_MAX : (mixed < INT16_MIN ? INT16_MIN : mixed);
+  }
+}
+
+static int testMix(int samples, int fullScale, int inPlace) {
+  int i;
+  for(i = 0; i < samples; i++) {
+    a[i] = randomSample(fullScale);
+    b[i] = randomSample(fullScale);
+    gainA[i] = rand() % 32768;
+    gainB[i] = fullScale ? 32767 : rand() % 32768;
+  }
+  referenceMix(expected, samples);
+  if(inPlace) {
+    audio_dsp_mix(a, a, gainA, b, gainB, samples);
+  } else {
+    audio_dsp_mix(actual, a, gainA, b, gainB, samples);
+  }
+  for(i = 0; i < samples; i++) {
+    if((inPlace ? a[i] : actual[i]) != expected[i]) {
+      printf("FAIL: mix of %d samples differs at %d: %d instead of %d\n", samples, i, inPlace ? a[i] : actual[i],
+        expected[i]);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int testGain(int samples, int fullScale, int inPlace) {
+  int16_t gain = fullScale ? 32767 : rand() % 32768;
+  int i;
+  for(i = 0; i < samples; i++) {
+    a[i] = randomSample(fullScale);
+    expected[i] = ((int32_t)a[i] * gain + (1 << 14)) >> 15;
+  }
+  if(inPlace) {
+    audio_dsp_gain(a, a, gain, samples);
+  } else {
+    audio_dsp_gain(actual, a, gain, samples);
+  }
+  for(i = 0; i < samples; i++) {
+    if((inPlace ? a[i] : actual[i]) != expected[i]) {
+      printf("FAIL: gain of %d samples differs at %d: %d instead of %d\n", samples, i, inPlace ? a[i] : actual[i],
+        expected[i]);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int testToFloat(int frames, int channels, int planar) {
+  int samples = frames * channels;
+  int i, c;
+  for(i = 0; i < samples; i++) {
+    a[i] = i < 2 ? (i ? INT16_MAX : INT16_MIN) : randomSample(0);
+  }
+  if(planar) {
+    audio_dsp_to_float_planar(floats, a, frames, channels);
+  } else {
+    audio_dsp_to_float(floats, a, samples);
+  }
+  for(i = 0; i < frames; i++) {
+    for(c = 0; c < channels; c++) {
+      float value = planar ? floats[c * frames + i] : floats[i * channels + c];
+      if(value != a[i * channels + c] / 32768.0f) {
+        printf("FAIL: %s conversion of %d frames with %d channels differs at frame %d channel %d: %f instead of %f\n",
+          planar ? "planar" : "interleaved", frames, channels, i, c, value, a[i * channels + c] / 32768.0f);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/**
+ * Turns a constant signal down to silence over several chunks. No step between two frames may be larger than the
+ * ramp allows and after the ramp the signal must be silent.
+ **/
+static int testRamp(void) {
+  static char chunkMemory[sizeof(audio_fifo_data_t) + 256 * 2 * sizeof(int16_t)];
+  audio_fifo_data_t* audioData = (audio_fifo_data_t*)chunkMemory;
+  audio_gain_t gain;
+  int rampFrames = 44100 * AUDIO_GAIN_RAMP_MS / 1000 + 1;
+  int maxStep = 10000 / rampFrames + 2;
+  int last = 10000;
+  int frame = 0;
+  int chunk, i;
+
+  audio_gain_init(&gain);
+  audio_gain_set(&gain, 0);
+  for(chunk = 0; chunk < 8; chunk++) {
+    audioData->channels = 2;
+    audioData->sampleRate = 44100;
+    audioData->numberOfSamples = 256;
+    for(i = 0; i < 512; i++) {
+      audioData->samples[i] = 10000;
+    }
+    audio_gain_apply(&gain, audioData->samples, audioData->numberOfSamples, audioData->channels, audioData->sampleRate);
+    for(i = 0; i < 256; i++, frame++) {
+      int sample = audioData->samples[i * 2];
+      if(sample != audioData->samples[i * 2 + 1] || last - sample > maxStep || sample > last) {
+        printf("FAIL: volume ramp jumps from %d to %d at frame %d\n", last, sample, frame);
+        return 0;
+      }
+      if(frame >= rampFrames && sample != 0) {
+        printf("FAIL: volume ramp did not end after %d frames\n", rampFrames);
+        return 0;
+      }
+      last = sample;
+    }
+  }
+  return 1;
+}
+
+int main(void) {
+  int samples;
+  int i;
+  uint64_t start;
+  double seconds;
+
+  printf("audio_dsp_mix uses %s\n", audio_dsp_name());
+  for(samples = 0; samples <= 67; samples++) {
+    if(!testMix(samples, 0, 0) || !testMix(samples, 1, 0) || !testMix(samples, 0, 1)) {
+      return 1;
+    }
+  }
+  if(!testMix(MAX_SAMPLES, 0, 0) || !testMix(MAX_SAMPLES, 1, 1)) {
+    return 1;
+  }
+  for(samples = 0; samples <= 67; samples++) {
+    if(!testGain(samples, 0, 0) || !testGain(samples, 1, 0) || !testGain(samples, 0, 1)) {
+      return 1;
+    }
+  }
+  if(!testGain(MAX_SAMPLES, 0, 1) || !testRamp()) {
+    return 1;
+  }
+  for(samples = 0; samples <= 67; samples++) {
+    if(!testToFloat(samples, 1, 0) || !testToFloat(samples, 2, 0) || !testToFloat(samples, 1, 1) ||
+      !testToFloat(samples, 2, 1) || !testToFloat(samples, 3, 1)) {
+      return 1;
+    }
+  }
+
+  start = uv_hrtime();
+  for(i = 0; i < BENCH_SECONDS * BENCH_SAMPLES / MAX_SAMPLES; i++) {
+    audio_dsp_mix(a, a, gainA, b, gainB, MAX_SAMPLES);
+  }
+  seconds = (uv_hrtime() - start) / 1e9;
+  printf("mix: %d s of 44.1 kHz stereo in %.1f ms, %.0fx real time\n", BENCH_SECONDS, seconds * 1000,
+    BENCH_SECONDS / seconds);
+
+  start = uv_hrtime();
+  for(i = 0; i < BENCH_SECONDS * BENCH_SAMPLES / MAX_SAMPLES; i++) {
+    audio_dsp_gain(a, a, 23170, MAX_SAMPLES);
+  }
+  seconds = (uv_hrtime() - start) / 1e9;
+  printf("gain: %d s of 44.1 kHz stereo in %.1f ms, %.0fx real time\n", BENCH_SECONDS, seconds * 1000,
+    BENCH_SECONDS / seconds);
+
+  start = uv_hrtime();
+  for(i = 0; i < BENCH_SECONDS * BENCH_SAMPLES / MAX_SAMPLES; i++) {
+    audio_dsp_to_float_planar(floats, a, MAX_SAMPLES / 2, 2);
+  }
+  seconds = (uv_hrtime() - start) / 1e9;
+  printf("planar float: %d s of 44.1 kHz stereo in %.1f ms, %.0fx real time\n", BENCH_SECONDS, seconds * 1000,
+    BENCH_SECONDS / seconds);
+
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * Test for the fan-out of one queue to several sinks. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_fanout_test.c src/audio/audio.c src/audio/audio-pool.c \
+ *     src/audio/audio-dsp.c -luv -lpthread
+ *   ./a.out
+ *
+ * A producer puts chunks into a queue with three taps: one with the BLOCK policy read by a slow sink, one with
+ * DROP_OLDEST and one with SKIP, whose sinks only start reading once the producer is done. The sink of the queue
+ * itself turns the volume down to silence, which must not change what the other sinks get. Every sink must see the
+ * chunks in order, the stalled sinks must not hold up the producer, the BLOCK sink must get every chunk, the
+ * DROP_OLDEST sink the newest and the SKIP sink the oldest ones. No chunk may be copied except by the volume, the
+ * telemetry of every tap must account for all frames and at the end every chunk must be back in the pool.
+ **/
+#include "../src/audio/audio.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHUNKS 20000
+#define FRAMES 441
+#define CAPACITY_MS 100
+
+static audio_pool_t* pool;
+static audio_fifo_t primary;
+static audio_fifo_t blocking;
+static audio_fifo_t dropOldest;
+static audio_fifo_t skipping;
+static int producerDone;
+
+typedef struct {
+  audio_fifo_t* audioFifo;
+  int applyGain;
+  int slow;
+  int waitForProducer;
+  long long first;
+  long long last;
+  int chunks;
+  int outOfOrder;
+  int damaged;
+} reader_t;
+
+static void* produce(void* unused) {
+  unsigned int sequence;
+  int i;
+  for(sequence = 0; sequence < CHUNKS; sequence++) {
+    audio_fifo_data_t* audioData = audio_data_alloc(pool, FRAMES * 2 * sizeof(int16_t));
+    audioData->epoch = 0;
+    audioData->channels = 2;
+    audioData->sampleRate = 44100;
+    audioData->numberOfSamples = FRAMES;
+    for(i = 0; i < FRAMES * 2; i++) {
+      audioData->samples[i] = (int16_t)(sequence % 30000 + 1);
+    }
+    memcpy(audioData->samples, &sequence, sizeof(sequence));
+    while(!audio_fifo_put(&primary, audioData)) {
+      sched_yield();
+    }
+  }
+  __atomic_store_n(&producerDone, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static void* readSink(void* argument) {
+  reader_t* reader = argument;
+  audio_fifo_data_t* audioData;
+  int i;
+  reader->first = -1;
+  reader->last = -1;
+  while(reader->waitForProducer && !__atomic_load_n(&producerDone, __ATOMIC_ACQUIRE)) {
+    usleep(1000);
+  }
+  for(;;) {
+    unsigned int sequence;
+    int done = __atomic_load_n(&producerDone, __ATOMIC_ACQUIRE);
+    if((audioData = audio_get(reader->audioFifo)) == NULL) {
+      if(done) {
+        break;
+      }
+      sched_yield();
+      continue;
+    }
+    if(reader->applyGain) {
+      audioData = audio_data_apply_gain(&reader->audioFifo->gain, audioData);
+    } else {
+      memcpy(&sequence, audioData->samples, sizeof(sequence));
+      for(i = 2; i < FRAMES * 2; i++) {
+        if(audioData->samples[i] != (int16_t)(sequence % 30000 + 1)) {
+          reader->damaged++;
+          break;
+        }
+      }
+      if((long long)sequence <= reader->last) {
+        reader->outOfOrder++;
+      }
+      if(reader->first < 0) {
+        reader->first = sequence;
+      }
+      reader->last = sequence;
+    }
+    reader->chunks++;
+    audio_data_free(audioData);
+    if(reader->slow) {
+      usleep(20);
+    }
+  }
+  return NULL;
+}
+
+static int checkTelemetry(const char* name, audio_fifo_t* audioFifo) {
+  audio_telemetry_t telemetry;
+  audio_telemetry_get(audioFifo, &telemetry);
+  if(telemetry.framesDelivered != (int64_t)CHUNKS * FRAMES ||
+    telemetry.framesConsumed + telemetry.framesDropped != telemetry.framesDelivered) {
+    printf("FAIL: the %s sink got %lld frames, consumed %lld and dropped %lld\n", name,
+      (long long)telemetry.framesDelivered, (long long)telemetry.framesConsumed, (long long)telemetry.framesDropped);
+    return 0;
+  }
+  return 1;
+}
+
+int main(void) {
+  pthread_t producer, readers[4];
+  reader_t primaryReader = { &primary, 1, 0, 0 };
+  reader_t blockingReader = { &blocking, 0, 1, 0 };
+  reader_t dropOldestReader = { &dropOldest, 0, 0, 1 };
+  reader_t skippingReader = { &skipping, 0, 0, 1 };
+  reader_t* tapReaders[3] = { &blockingReader, &dropOldestReader, &skippingReader };
+  audio_pool_stats_t poolStats;
+  int i, ok = 1;
+
+  pool = audio_pool_create();
+  audio_init(&primary);
+  audio_init(&blocking);
+  audio_init(&dropOldest);
+  audio_init(&skipping);
+  audio_gain_set(&primary.gain, 0);
+  if(audio_fifo_add_tap(&primary, &blocking, AUDIO_TAP_BLOCK, CAPACITY_MS) != 0 ||
+    audio_fifo_add_tap(&primary, &dropOldest, AUDIO_TAP_DROP_OLDEST, CAPACITY_MS) != 0 ||
+    audio_fifo_add_tap(&primary, &skipping, AUDIO_TAP_SKIP, CAPACITY_MS) != 0) {
+    printf("FAIL: the taps could not be added\n");
+    return 1;
+  }
+
+  pthread_create(&readers[0], NULL, readSink, &primaryReader);
+  pthread_create(&readers[1], NULL, readSink, &blockingReader);
+  pthread_create(&readers[2], NULL, readSink, &dropOldestReader);
+  pthread_create(&readers[3], NULL, readSink, &skippingReader);
+  pthread_create(&producer, NULL, produce, NULL);
+  pthread_join(producer, NULL);
+  for(i = 0; i < 4; i++) {
+    pthread_join(readers[i], NULL);
+  }
+  audio_fifo_remove_tap(&primary, &blocking);
+  audio_fifo_remove_tap(&primary, &dropOldest);
+  audio_fifo_remove_tap(&primary, &skipping);
+
+  for(i = 0; i < 3; i++) {
+    if(tapReaders[i]->outOfOrder > 0 || tapReaders[i]->damaged > 0) {
+      printf("FAIL: tap %d got %d chunks out of order and %d changed by the volume\n", i + 1, tapReaders[i]->outOfOrder,
+        tapReaders[i]->damaged);
+      ok = 0;
+    }
+  }
+  if(primaryReader.chunks != CHUNKS || blockingReader.chunks != CHUNKS) {
+    printf("FAIL: the queue got %d and the blocking sink %d of %d chunks\n", primaryReader.chunks, blockingReader.chunks,
+      CHUNKS);
+    ok = 0;
+  }
+  if(dropOldestReader.last != CHUNKS - 1 || dropOldestReader.first < CHUNKS - CAPACITY_MS * 44100 / 1000 / FRAMES - 1) {
+    printf("FAIL: the dropping sink got chunks %lld to %lld instead of the newest\n", dropOldestReader.first,
+      dropOldestReader.last);
+    ok = 0;
+  }
+  if(skippingReader.first != 0 || skippingReader.last > CAPACITY_MS * 44100 / 1000 / FRAMES + 1) {
+    printf("FAIL: the skipping sink got chunks %lld to %lld instead of the oldest\n", skippingReader.first,
+      skippingReader.last);
+    ok = 0;
+  }
+  ok = ok && checkTelemetry("blocking", &blocking) && checkTelemetry("dropping", &dropOldest) &&
+    checkTelemetry("skipping", &skipping);
+
+  audio_pool_get_stats(pool, &poolStats);
+  //The volume copies the chunks of the queue that are still shared, nothing else may.
+  if(poolStats.hits + poolStats.misses > 2 * CHUNKS) {
+    printf("FAIL: %llu chunks allocated for %d delivered\n", (unsigned long long)(poolStats.hits + poolStats.misses),
+      CHUNKS);
+    ok = 0;
+  }
+  if(poolStats.chunksInUse != 0) {
+    printf("FAIL: %d chunks were not given back\n", poolStats.chunksInUse);
+    ok = 0;
+  }
+  printf("%d chunks, %llu allocated, the dropping sink got %d, the skipping sink %d\n", CHUNKS,
+    (unsigned long long)(poolStats.hits + poolStats.misses), dropOldestReader.chunks, skippingReader.chunks);
+  audio_pool_release(pool);
+  if(!ok) {
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * Stress test for the audio fifo. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -DNODE_SPOTIFY_NATIVE_SOUND -I<node include dir> test/audio_fifo_stress.c src/audio/audio.c \
+ *     src/audio/audio-pool.c src/audio/audio-dsp.c -luv -lpthread
+ *   ./a.out
+ *
+ * A producer thread delivers chunks like libspotify does while the native consumer thread is deliberately slow
+ * and a third thread keeps flushing the queue like a resume from the main thread does. The producer must never wait
+ * for the consumer: while the consumer stalls, puts keep returning immediately (refused once the queue is full).
+ * The time of every audio_fifo_put is recorded, the 99.99th percentile is checked, the maximum is only reported
+ * because it includes preemption by the OS scheduler. Chunks come from the chunk pool and are given back by both
+ * reading threads, at the end every pooled chunk must have been returned. The flushing thread also resets the
+ * playback clock like a seek does or moves it to the next track like gapless playback, the clock must end up with
+ * exactly the frames consumed in the epoch it is counting. The telemetry must account for every frame that was put
+ * into the queue and have measured the latency and the queue depth of every chunk taken out.
+ **/
+#include "../src/audio/audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHUNKS 2000000
+#define FRAMES 8
+#define MAX_PUT_NS 50000
+#define BUCKET_NS 100
+#define BUCKETS (MAX_PUT_NS / BUCKET_NS + 1)
+
+static int producerDone;
+static unsigned int consumed;
+static unsigned int flushed;
+static int outOfOrder;
+static unsigned int putTimes[BUCKETS];
+static audio_pool_t* pool;
+static int64_t framesPerEpoch[AUDIO_CLOCK_EPOCH_MASK + 1];
+
+static audio_fifo_data_t* createChunk(audio_fifo_t* audioFifo, unsigned int sequence) {
+  audio_fifo_data_t* audioData = audio_data_alloc(pool, FRAMES * 2 * sizeof(int16_t));
+  audioData->epoch = audio_clock_epoch(&audioFifo->clock);
+  audioData->channels = 2;
+  audioData->sampleRate = 44100;
+  audioData->numberOfSamples = FRAMES;
+  memcpy(audioData->samples, &sequence, sizeof(sequence));
+  return audioData;
+}
+
+/**
+ * Every reader must see strictly increasing sequence numbers.
+ **/
+static void checkSequence(audio_fifo_data_t* audioData, long long* last) {
+  unsigned int sequence;
+  memcpy(&sequence, audioData->samples, sizeof(sequence));
+  if((long long)sequence <= *last) {
+    outOfOrder++;
+  }
+  *last = sequence;
+}
+
+/**
+ * The native consumer, started by audio_init_native. Sleeps every now and then to simulate a blocked sound device.
+ **/
+void audio_start(void* aux) {
+  audio_fifo_t* audioFifo = aux;
+  audio_fifo_data_t* audioData;
+  long long last = -1;
+  while((audioData = audio_get_native(audioFifo))) {
+    checkSequence(audioData, &last);
+    consumed++;
+    framesPerEpoch[audioData->epoch] += audioData->numberOfSamples;
+    audio_clock_advance(&audioFifo->clock, audioData->epoch, audioData->numberOfSamples, audioData->sampleRate);
+    if(consumed % 4096 == 0) {
+      usleep(20000);
+    }
+    audio_data_free(audioData);
+  }
+}
+
+static void flusher(void* aux) {
+  audio_fifo_t* audioFifo = aux;
+  long long last = -1;
+  int round = 0;
+  while(!__atomic_load_n(&producerDone, __ATOMIC_ACQUIRE)) {
+    usleep(5000);
+    if(round++ % 2) {
+      audio_clock_next(&audioFifo->clock);
+    } else {
+      audio_clock_reset(&audioFifo->clock);
+    }
+    audio_fifo_data_t* audioData;
+    while((audioData = audio_get(audioFifo))) {
+      checkSequence(audioData, &last);
+      flushed++;
+      audio_data_free(audioData);
+    }
+  }
+}
+
+int main(void) {
+  static audio_fifo_t audioFifo;
+  uv_thread_t flushThread;
+  uint64_t worstPut = 0;
+  unsigned int percentile = 0;
+  unsigned int counted = 0;
+  uint64_t start = uv_hrtime();
+  unsigned int delivered = 0;
+  unsigned int refused = 0;
+  audio_pool_stats_t poolStats;
+  audio_output_options_t outputOptions;
+  audio_telemetry_t telemetry;
+  unsigned int latencies = 0, depths = 0;
+  int64_t clockFrames;
+  int clockRate;
+  int clockEpoch;
+  int i;
+
+  pool = audio_pool_create();
+  audio_init(&audioFifo);
+  memset(&outputOptions, 0, sizeof(outputOptions));
+  audio_init_native(&audioFifo, pool, &outputOptions);
+  uv_thread_create(&flushThread, flusher, &audioFifo);
+
+  for(i = 0; i < CHUNKS; i++) {
+    audio_fifo_data_t* audioData = createChunk(&audioFifo, i);
+    uint64_t before = uv_hrtime();
+    int put = audio_fifo_put(&audioFifo, audioData);
+    audio_signal_native(&audioFifo);
+    uint64_t took = uv_hrtime() - before;
+    if(took > worstPut) {
+      worstPut = took;
+    }
+    putTimes[took / BUCKET_NS < BUCKETS ? took / BUCKET_NS : BUCKETS - 1]++;
+    if(put) {
+      delivered++;
+    } else {
+      refused++;
+      audio_data_free(audioData);
+    }
+  }
+  __atomic_store_n(&producerDone, 1, __ATOMIC_RELEASE);
+  uv_thread_join(&flushThread);
+
+  //Let the consumer drain what is left before stopping it.
+  while(audio_fifo_samples(&audioFifo) > 0) {
+    usleep(1000);
+  }
+  audio_stop_native(&audioFifo);
+  audio_stop(&audioFifo);
+
+  audio_pool_get_stats(pool, &poolStats);
+  audio_pool_release(pool);
+  clockFrames = audio_clock_frames(&audioFifo.clock, &clockRate, &clockEpoch);
+  audio_telemetry_get(&audioFifo, &telemetry);
+  for(i = 0; i < AUDIO_LATENCY_BUCKETS; i++) {
+    latencies += telemetry.latency[i];
+  }
+  for(i = 0; i < AUDIO_DEPTH_BUCKETS; i++) {
+    depths += telemetry.depth[i];
+  }
+
+  printf("delivered %u, refused %u, consumed %u, flushed %u in %.1f ms\n", delivered, refused, consumed, flushed,
+    (uv_hrtime() - start) / 1e6);
+  while(percentile < BUCKETS - 1 && (counted += putTimes[percentile]) < CHUNKS - CHUNKS / 10000) {
+    percentile++;
+  }
+  printf("audio_fifo_put + audio_signal_native: 99.99%% below %u ns, worst %llu ns\n", (percentile + 1) * BUCKET_NS,
+    (unsigned long long)worstPut);
+
+  printf("pool hits %u, misses %u, high water mark %d\n", poolStats.hits, poolStats.misses, poolStats.highWaterMark);
+  printf("telemetry: %d underruns, latency median %d ms, 99th percentile %d ms, max %.1f ms\n", telemetry.underruns,
+    audio_telemetry_percentile(&telemetry, 50), audio_telemetry_percentile(&telemetry, 99),
+    telemetry.maxLatency / 1000.0);
+
+  if(poolStats.chunksInUse != 0) {
+    printf("FAIL: %d pooled chunks were not returned\n", poolStats.chunksInUse);
+    return 1;
+  }
+  if(consumed + flushed != delivered || outOfOrder > 0) {
+    printf("FAIL: lost or duplicated chunks\n");
+    return 1;
+  }
+  if(clockFrames != framesPerEpoch[clockEpoch]) {
+    printf("FAIL: clock counted %lld frames, %lld were played in its epoch\n", (long long)clockFrames,
+      (long long)framesPerEpoch[clockEpoch]);
+    return 1;
+  }
+  if(telemetry.framesDelivered != (int64_t)delivered * FRAMES ||
+    telemetry.framesConsumed + telemetry.framesDropped != telemetry.framesDelivered) {
+    printf("FAIL: telemetry counted %lld frames delivered, %lld consumed and %lld dropped, %lld were delivered\n",
+      (long long)telemetry.framesDelivered, (long long)telemetry.framesConsumed, (long long)telemetry.framesDropped,
+      (long long)delivered * FRAMES);
+    return 1;
+  }
+  if(latencies != consumed + flushed || depths != consumed + flushed) {
+    printf("FAIL: latency measured %u times and queue depth %u times for %u chunks\n", latencies, depths,
+      consumed + flushed);
+    return 1;
+  }
+  if(percentile == BUCKETS - 1) {
+    printf("FAIL: delivery was blocked\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,232 @@
+/**
+ * Test and benchmark for the file sink. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_file_test.c src/audio/file-audio.c src/audio/audio.c \
+ *     src/audio/audio-pool.c src/audio/audio-dsp.c -luv -lpthread
+ *   ./a.out [directory]
+ *
+ * Two tracks of different length are delivered like libspotify does, with a pause after the first one. With %d in
+ * the path each track must end up in its own WAV file, without it both in one, with headers that match the audio
+ * and the audio exactly as it was delivered. The same goes for raw files, with direct writes and with preallocation.
+ * While the sink is idle after the first track the file must already be complete and once the sink stopped no more
+ * disk space may be reserved than the file needs. Then it reports how fast a minute of 44.1 kHz stereo is written.
+ * The files go to /tmp unless another directory is given, direct writes are skipped if its file system does not
+ * support them.
+ **/
+#include "../src/audio/audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FRAMES 2048
+#define TRACK1_CHUNKS 300
+#define TRACK2_CHUNKS 177
+#define BENCH_CHUNKS (44100 * 60 / FRAMES)
+
+static const char* directory = "/tmp";
+static audio_pool_t* pool;
+
+static int16_t sampleAt(int track, int64_t index) {
+  return (int16_t)((index * 7 + track * 1000) % 65536 - 32768);
+}
+
+static void deliver(audio_fifo_t* audioFifo, int track, int chunks, int epoch) {
+  int64_t index = 0;
+  int chunk, i;
+  for(chunk = 0; chunk < chunks; chunk++) {
+    audio_fifo_data_t* audioData = audio_data_alloc(pool, FRAMES * 2 * sizeof(int16_t));
+    audioData->epoch = epoch;
+    audioData->channels = 2;
+    audioData->sampleRate = 44100;
+    audioData->numberOfSamples = FRAMES;
+    for(i = 0; i < FRAMES * 2; i++) {
+      audioData->samples[i] = sampleAt(track, index++);
+    }
+    while(!audio_fifo_put(audioFifo, audioData)) {
+      usleep(1000);
+    }
+    audio_signal_native(audioFifo);
+  }
+}
+
+static void waitUntilPlayed(audio_fifo_t* audioFifo, int epoch, int64_t frames) {
+  int rate, playedEpoch;
+  while(audio_clock_frames(&audioFifo->clock, &rate, &playedEpoch) < frames || playedEpoch != epoch) {
+    usleep(1000);
+  }
+}
+
+static unsigned char* readFile(const char* path, long* size) {
+  FILE* file = fopen(path, "rb");
+  unsigned char* data;
+  if(file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  data = malloc(*size + 1);
+  *size = (long)fread(data, 1, *size, file);
+  fclose(file);
+  return data;
+}
+
+static uint32_t get32(const unsigned char* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+ * Checks that the file at path holds the given tracks one after the other.
+ **/
+static int checkFile(const char* path, int format, int firstTrack, int tracks, const int* chunks) {
+  long size;
+  unsigned char* data = readFile(path, &size);
+  int64_t expectedBytes = 0, offset = format == AUDIO_FILE_WAV ? 44 : 0;
+  int track;
+  if(data == NULL) {
+    printf("FAIL: %s was not written\n", path);
+    return 0;
+  }
+  for(track = 0; track < tracks; track++) {
+    expectedBytes += (int64_t)chunks[track] * FRAMES * 2 * sizeof(int16_t);
+  }
+  if(size != offset + expectedBytes) {
+    printf("FAIL: %s has %ld bytes instead of %lld\n", path, size, (long long)(offset + expectedBytes));
+    free(data);
+    return 0;
+  }
+  if(format == AUDIO_FILE_WAV && (memcmp(data, "RIFF", 4) != 0 || get32(data + 4) != size - 8 ||
+    memcmp(data + 8, "WAVEfmt ", 8) != 0 || get32(data + 24) != 44100 || get32(data + 40) != expectedBytes)) {
+    printf("FAIL: %s has a wrong WAV header\n", path);
+    free(data);
+    return 0;
+  }
+  for(track = 0; track < tracks; track++) {
+    int64_t index;
+    for(index = 0; index < (int64_t)chunks[track] * FRAMES * 2; index++) {
+      int16_t sample = (int16_t)(data[offset] | (data[offset + 1] << 8));
+      if(sample != sampleAt(firstTrack + track, index)) {
+        printf("FAIL: %s differs at sample %lld of track %d\n", path, (long long)index, firstTrack + track + 1);
+        free(data);
+        return 0;
+      }
+      offset += 2;
+    }
+  }
+  free(data);
+  return 1;
+}
+
+static int testSink(int format, int perTrack, int direct, int64_t preallocate) {
+  static audio_fifo_t audioFifo;
+  audio_file_sink_t sink;
+  audio_output_options_t outputOptions;
+  audio_file_stats_t stats;
+  const char* extension = format == AUDIO_FILE_WAV ? "wav" : "raw";
+  int chunks[2] = { TRACK1_CHUNKS, TRACK2_CHUNKS };
+  char path[AUDIO_PATH_LENGTH];
+  int ok;
+
+  memset(&sink, 0, sizeof(sink));
+  memset(&outputOptions, 0, sizeof(outputOptions));
+  snprintf(sink.options.path, AUDIO_PATH_LENGTH, "%s/node-spotify-test%s.%s", directory, perTrack ? "-%d" : "",
+    extension);
+  sink.options.format = format;
+  sink.options.direct = direct;
+  sink.options.preallocate = preallocate;
+  sink.options.writeSize = 64 * 1024;
+  audio_init(&audioFifo);
+  audio_init_file(&audioFifo, pool, &sink, &outputOptions);
+
+  deliver(&audioFifo, 0, TRACK1_CHUNKS, 0);
+  //Let the sink go idle, the file has to be complete then.
+  waitUntilPlayed(&audioFifo, 0, (int64_t)TRACK1_CHUNKS * FRAMES);
+  usleep(800000);
+  snprintf(path, AUDIO_PATH_LENGTH, "%s/node-spotify-test%s.%s", directory, perTrack ? "-1" : "", extension);
+  if(!checkFile(path, format, 0, 1, chunks)) {
+    printf("FAIL: the file was not complete while the sink was idle\n");
+    return 0;
+  }
+  audio_clock_next(&audioFifo.clock);
+  deliver(&audioFifo, 1, TRACK2_CHUNKS, 1);
+  waitUntilPlayed(&audioFifo, 1, (int64_t)TRACK2_CHUNKS * FRAMES);
+  audio_stop_native(&audioFifo);
+  audio_stop(&audioFifo);
+  audio_file_get_stats(&sink, &stats);
+
+  if(preallocate > 0) {
+    struct stat info;
+    if(stat(path, &info) == 0 && (int64_t)info.st_blocks * 512 >= info.st_size + preallocate) {
+      printf("FAIL: %s still has %lld bytes of disk space for %lld bytes\n", path, (long long)info.st_blocks * 512,
+        (long long)info.st_size);
+      unlink(path);
+      return 0;
+    }
+  }
+  if(perTrack) {
+    char second[AUDIO_PATH_LENGTH];
+    snprintf(second, AUDIO_PATH_LENGTH, "%s/node-spotify-test-2.%s", directory, extension);
+    ok = checkFile(path, format, 0, 1, chunks) && checkFile(second, format, 1, 1, chunks + 1);
+    unlink(second);
+  } else {
+    ok = checkFile(path, format, 0, 2, chunks);
+  }
+  unlink(path);
+  if(ok && (stats.files != (perTrack ? 2 : 1) || stats.openFailures != 0 || stats.writeErrors != 0)) {
+    printf("FAIL: %d files, %d open failures, %d write errors\n", stats.files, stats.openFailures, stats.writeErrors);
+    ok = 0;
+  }
+  if(ok && direct && !stats.direct) {
+    printf("%s does not support direct writes, tested without\n", directory);
+  }
+  printf("%s%s%s%s: %lld bytes in %d writes\n", extension, perTrack ? ", file per track" : "",
+    stats.direct ? ", direct" : "", stats.preallocated ? ", preallocated" : "", (long long)stats.bytesWritten,
+    stats.writes);
+  return ok;
+}
+
+static void benchmark(int direct) {
+  static audio_fifo_t audioFifo;
+  audio_file_sink_t sink;
+  audio_output_options_t outputOptions;
+  audio_file_stats_t stats;
+  uint64_t start;
+  double seconds;
+
+  memset(&sink, 0, sizeof(sink));
+  memset(&outputOptions, 0, sizeof(outputOptions));
+  snprintf(sink.options.path, AUDIO_PATH_LENGTH, "%s/node-spotify-bench.wav", directory);
+  sink.options.direct = direct;
+  audio_init(&audioFifo);
+  start = uv_hrtime();
+  audio_init_file(&audioFifo, pool, &sink, &outputOptions);
+  deliver(&audioFifo, 0, BENCH_CHUNKS, 0);
+  waitUntilPlayed(&audioFifo, 0, (int64_t)BENCH_CHUNKS * FRAMES);
+  audio_stop_native(&audioFifo);
+  seconds = (uv_hrtime() - start) / 1e9;
+  audio_stop(&audioFifo);
+  audio_file_get_stats(&sink, &stats);
+  unlink(sink.options.path);
+  printf("%s: 60 s of 44.1 kHz stereo in %.1f ms, %.0fx real time, %d writes\n", stats.direct ? "direct" : "buffered",
+    seconds * 1000, 60 / seconds, stats.writes);
+}
+
+int main(int argc, char** argv) {
+  if(argc > 1) {
+    directory = argv[1];
+  }
+  pool = audio_pool_create();
+  if(!testSink(AUDIO_FILE_WAV, 1, 0, 0) || !testSink(AUDIO_FILE_WAV, 0, 0, 0) || !testSink(AUDIO_FILE_RAW, 0, 0, 0) ||
+    !testSink(AUDIO_FILE_WAV, 1, 1, 0) || !testSink(AUDIO_FILE_WAV, 0, 1, 64 << 20) ||
+    !testSink(AUDIO_FILE_RAW, 1, 1, 64 << 20)) {
+    return 1;
+  }
+  benchmark(0);
+  benchmark(1);
+  audio_pool_release(pool);
+  printf("OK\n");
+  return 0;
+}
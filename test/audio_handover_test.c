@@ -0,0 +1,123 @@
+/**
+ * Test for handing a playing queue over to another one. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_handover_test.c src/audio/audio.c src/audio/audio-pool.c \
+ *     src/audio/audio-dsp.c -luv -lpthread
+ *   ./a.out
+ *
+ * A producer delivers chunks into a queue played by a consumer thread, like libspotify and a native handler do.
+ * Every few hundred chunks the producer is paused like libspotify is while the handler is replaced, the consumer is
+ * halted and a new queue with its own consumer takes over. Together the consumers must play every chunk exactly once
+ * and in order, the playback clock must count all of them and the volume of the first queue must be kept without
+ * ramping to it again.
+ **/
+#include "../src/audio/audio.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHUNKS 20000
+#define FRAMES 64
+#define HANDOVERS 50
+#define GAIN (AUDIO_GAIN_UNITY / 2)
+
+static audio_pool_t* pool;
+static long long lastPlayed = -1;
+static int outOfOrder;
+static int wrongGain;
+static int played;
+
+static void consume(void* aux) {
+  audio_fifo_t* audioFifo = aux;
+  audio_fifo_data_t* audioData;
+  while((audioData = audio_get_native(audioFifo))) {
+    //The sequence number is in the first two samples, at half the volume.
+    unsigned int sequence = audioData->samples[0] * 256 + audioData->samples[1];
+    if((long long)sequence != lastPlayed + 1) {
+      outOfOrder++;
+    }
+    if(audioData->samples[FRAMES * 2 - 1] != 5000) {
+      wrongGain++;
+    }
+    lastPlayed = sequence;
+    played++;
+    audio_clock_advance(&audioFifo->clock, audioData->epoch, audioData->numberOfSamples, audioData->sampleRate);
+    audio_data_free(audioData);
+  }
+}
+
+static void start(audio_fifo_t* audioFifo, int first) {
+  audio_output_options_t options;
+  memset(&options, 0, sizeof(options));
+  audio_init(audioFifo);
+  audio_gain_set(&audioFifo->gain, GAIN);
+  if(first) {
+    //At the volume from the start, the queues taking over have to keep it.
+    audioFifo->gain.current = GAIN;
+    audioFifo->gain.rampFrom = GAIN;
+    audioFifo->gain.rampTo = GAIN;
+  }
+  audio_init_thread(audioFifo, pool, &options, consume, NULL);
+}
+
+int main(void) {
+  static audio_fifo_t fifos[2];
+  audio_fifo_t* current = &fifos[0];
+  unsigned int sequence;
+  int64_t frames;
+  int rate, epoch, i;
+
+  pool = audio_pool_create();
+  start(current, 1);
+  for(sequence = 0; sequence < CHUNKS; sequence++) {
+    audio_fifo_data_t* audioData = audio_data_alloc(pool, FRAMES * 2 * sizeof(int16_t));
+    audioData->epoch = audio_clock_epoch(&current->clock);
+    audioData->channels = 2;
+    audioData->sampleRate = 44100;
+    audioData->numberOfSamples = FRAMES;
+    for(i = 0; i < FRAMES * 2; i++) {
+      audioData->samples[i] = 10000;
+    }
+    audioData->samples[0] = (sequence / 256) * 2;
+    audioData->samples[1] = (sequence % 256) * 2;
+    while(!audio_fifo_put(current, audioData)) {
+      sched_yield();
+    }
+    audio_signal_native(current);
+    if(sequence % (CHUNKS / HANDOVERS) == CHUNKS / HANDOVERS / 2) {
+      audio_fifo_t* next = current == &fifos[0] ? &fifos[1] : &fifos[0];
+      start(next, 0);
+      audio_halt_native(current);
+      audio_fifo_take_over(next, current);
+      audio_signal_native(next);
+      audio_stop_native(current);
+      audio_stop(current);
+      current = next;
+    }
+  }
+  while(audio_fifo_samples(current) > 0) {
+    usleep(1000);
+  }
+  audio_stop_native(current);
+  frames = audio_clock_frames(&current->clock, &rate, &epoch);
+  audio_stop(current);
+  audio_pool_release(pool);
+
+  printf("%d chunks played over %d handovers\n", played, HANDOVERS);
+  if(played != CHUNKS || outOfOrder > 0) {
+    printf("FAIL: %d of %d chunks played, %d out of order\n", played, CHUNKS, outOfOrder);
+    return 1;
+  }
+  if(frames != (int64_t)CHUNKS * FRAMES) {
+    printf("FAIL: the clock counted %lld frames instead of %lld\n", (long long)frames, (long long)CHUNKS * FRAMES);
+    return 1;
+  }
+  if(wrongGain > 0) {
+    printf("FAIL: %d chunks were not at the set volume\n", wrongGain);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
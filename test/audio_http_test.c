@@ -0,0 +1,272 @@
+/**
+ * Test for the HTTP sink. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_http_test.c src/audio/audio.c src/audio/audio-pool.c \
+ *     src/audio/audio-dsp.c src/audio/file-audio.c src/audio/http-audio.c -luv -lpthread
+ *   ./a.out
+ *
+ * Streams a few seconds of a running frame count to listeners on localhost: one with the chunked transfer encoding,
+ * one asking for ICY metadata and one that never reads. The audio is labelled with a high sample rate so the real
+ * time pacing does not make the test slow. The reading listeners must get a WAV header and every frame from where
+ * they started in order, the ICY listener the title, and both the end of the stream where the format changes. The
+ * listener that does not read must be disconnected without holding up the others and a listener above maxListeners
+ * must be turned away.
+ **/
+#include "../src/audio/audio.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define RATE 384000
+#define FRAMES 4096
+#define SECONDS 4
+#define TITLE "Some Artist - Some Track"
+
+static audio_http_sink_t sink;
+
+typedef struct {
+  const char* request;
+  int frames;
+  int titleSeen;
+  int ok;
+} listener_t;
+
+static int connectTo(int receiveBuffer) {
+  struct sockaddr_in address;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if(receiveBuffer > 0) {
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+  }
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons((uint16_t)sink.port);
+  if(connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    perror("connect");
+    exit(1);
+  }
+  return fd;
+}
+
+/**
+Reads everything until the server closes the connection.
+**/
+static char* readAll(int fd, size_t* length) {
+  size_t size = 1 << 20;
+  char* data = malloc(size);
+  ssize_t r;
+  *length = 0;
+  while((r = read(fd, data + *length, size - *length)) > 0) {
+    *length += r;
+    if(*length == size) {
+      size *= 2;
+      data = realloc(data, size);
+    }
+  }
+  return data;
+}
+
+/**
+Decodes a chunked body in place. Returns its length, -1 if it is not complete.
+**/
+static long dechunk(char* body, size_t length) {
+  size_t in = 0, out = 0;
+  for(;;) {
+    char* end;
+    long size = strtol(body + in, &end, 16);
+    if(end == body + in || strncmp(end, "\r\n", 2) != 0) {
+      return -1;
+    }
+    in = end + 2 - body;
+    if(size == 0) {
+      return in + 2 == length ? (long)out : -1;
+    }
+    if(in + size + 2 > length) {
+      return -1;
+    }
+    memmove(body + out, body + in, size);
+    out += size;
+    in += size + 2;
+  }
+}
+
+/**
+Takes the ICY metadata out of the body. Returns its length.
+**/
+static size_t unicy(listener_t* listener, char* body, size_t length, int metaint) {
+  size_t in = 0, out = 0;
+  while(in < length) {
+    size_t n = length - in < (size_t)metaint ? length - in : (size_t)metaint;
+    memmove(body + out, body + in, n);
+    out += n;
+    in += n;
+    if(in < length) {
+      int metadata = (unsigned char)body[in] * 16;
+      if(metadata > 0 && strstr(body + in + 1, "StreamTitle='" TITLE "';") == body + in + 1) {
+        listener->titleSeen = 1;
+      }
+      in += 1 + metadata;
+    }
+  }
+  return out;
+}
+
+static void* receive(void* argument) {
+  listener_t* listener = argument;
+  int fd = connectTo(0);
+  size_t length;
+  char* response;
+  char* body;
+  const char* metaint;
+  int i, first;
+
+  if(write(fd, listener->request, strlen(listener->request)) < 0) {
+    perror("write");
+    return NULL;
+  }
+  response = readAll(fd, &length);
+  close(fd);
+  body = strstr(response, "\r\n\r\n");
+  if(body == NULL || strncmp(response, "HTTP/1.", 7) != 0 || strstr(response, " 200 OK") == NULL) {
+    printf("FAIL: no response\n");
+    return NULL;
+  }
+  *body = '\0';
+  body += 4;
+  length -= body - response;
+  if(strstr(response, "Transfer-Encoding: chunked") != NULL) {
+    long decoded = dechunk(body, length);
+    if(decoded < 0) {
+      printf("FAIL: the chunked body is incomplete\n");
+      return NULL;
+    }
+    length = decoded;
+  }
+  if((metaint = strstr(response, "icy-metaint: ")) != NULL) {
+    length = unicy(listener, body, length, atoi(metaint + 13));
+  }
+  if(length < AUDIO_WAV_HEADER_SIZE || memcmp(body, "RIFF", 4) != 0) {
+    printf("FAIL: no WAV header\n");
+    return NULL;
+  }
+  body += AUDIO_WAV_HEADER_SIZE;
+  length -= AUDIO_WAV_HEADER_SIZE;
+  if(length % 4 != 0) {
+    printf("FAIL: %d bytes are no whole frames\n", (int)length);
+    return NULL;
+  }
+  listener->frames = length / 4;
+  first = ((int16_t*)body)[0];
+  for(i = 0; i < listener->frames; i++) {
+    int16_t* frame = (int16_t*)body + i * 2;
+    if(frame[0] != (first + i) % 32000 || frame[1] != frame[0]) {
+      printf("FAIL: frame %d is %d instead of %d\n", i, frame[0], (first + i) % 32000);
+      return NULL;
+    }
+  }
+  //The last frame before the format changes is the last one of the stream.
+  if((first + listener->frames) % 32000 != RATE * SECONDS % 32000) {
+    printf("FAIL: the stream ended at %d instead of the change of the format\n", (first + listener->frames) % 32000);
+    return NULL;
+  }
+  listener->ok = 1;
+  free(response);
+  return NULL;
+}
+
+static void put(audio_fifo_t* audioFifo, audio_pool_t* pool, int64_t firstFrame, int rate) {
+  audio_fifo_data_t* audioData = audio_data_alloc(pool, FRAMES * 2 * sizeof(int16_t));
+  int i;
+  audioData->epoch = 0;
+  audioData->channels = 2;
+  audioData->sampleRate = rate;
+  audioData->numberOfSamples = FRAMES;
+  for(i = 0; i < FRAMES; i++) {
+    audioData->samples[i * 2] = (int16_t)((firstFrame + i) % 32000);
+    audioData->samples[i * 2 + 1] = audioData->samples[i * 2];
+  }
+  while(!audio_fifo_put(audioFifo, audioData)) {
+    usleep(1000);
+  }
+}
+
+int main(void) {
+  static audio_fifo_t audioFifo;
+  audio_output_options_t options;
+  audio_http_stats_t stats;
+  audio_pool_t* pool;
+  listener_t chunked = { "GET /stream.wav HTTP/1.1\r\nHost: localhost\r\n\r\n" };
+  listener_t icy = { "GET / HTTP/1.0\r\nIcy-MetaData: 1\r\n\r\n" };
+  pthread_t threads[2];
+  char busy[64] = "";
+  int stalled, rejected, error;
+  int64_t frame;
+
+  memset(&options, 0, sizeof(options));
+  memset(&sink, 0, sizeof(sink));
+  sink.options.format = AUDIO_FILE_WAV;
+  sink.options.maxListeners = 3;
+  sink.options.bufferSize = 1024 * 1024;
+  if((error = audio_http_listen(&sink)) != 0) {
+    printf("FAIL: unable to listen: %s\n", strerror(-error));
+    return 1;
+  }
+  pool = audio_pool_create();
+  audio_init(&audioFifo);
+  audio_init_http(&audioFifo, pool, &sink, &options);
+  audio_http_set_title(&sink, 0, TITLE);
+
+  pthread_create(&threads[0], NULL, receive, &chunked);
+  pthread_create(&threads[1], NULL, receive, &icy);
+  stalled = connectTo(4096);
+  if(write(stalled, "GET / HTTP/1.1\r\n\r\n", 18) < 0) {
+    perror("write");
+  }
+  usleep(100000);
+  rejected = connectTo(0);
+  if(read(rejected, busy, sizeof(busy) - 1) <= 0 || strstr(busy, " 503 ") == NULL) {
+    printf("FAIL: a listener above maxListeners was not turned away\n");
+    return 1;
+  }
+  close(rejected);
+
+  for(frame = 0; frame < RATE * SECONDS; frame += FRAMES) {
+    put(&audioFifo, pool, frame, RATE);
+  }
+  //A change of the format ends the streams.
+  put(&audioFifo, pool, frame, 48000);
+  pthread_join(threads[0], NULL);
+  pthread_join(threads[1], NULL);
+  audio_http_get_stats(&sink, &stats);
+  audio_stop_native(&audioFifo);
+  audio_http_close(&sink);
+  close(stalled);
+  audio_stop(&audioFifo);
+  audio_pool_release(pool);
+
+  printf("chunked listener got %d frames, ICY listener %d, %d accepted, %d rejected, %d evicted, %lld bytes sent\n",
+    chunked.frames, icy.frames, stats.accepted, stats.rejected, stats.evicted, (long long)stats.bytesSent);
+  if(!chunked.ok || !icy.ok) {
+    return 1;
+  }
+  if(!icy.titleSeen) {
+    printf("FAIL: the ICY listener did not get the title\n");
+    return 1;
+  }
+  if(chunked.frames < RATE * (SECONDS - 1) || icy.frames < RATE * (SECONDS - 1)) {
+    printf("FAIL: the listeners missed audio\n");
+    return 1;
+  }
+  if(stats.accepted != 3 || stats.rejected != 1 || stats.evicted != 1) {
+    printf("FAIL: the stalled listener was not disconnected\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
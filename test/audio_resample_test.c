@@ -0,0 +1,142 @@
+/**
+ * Test and benchmark for the resampler. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_resample_test.c src/audio/audio-resample.c src/audio/audio-dsp.c -luv -lm
+ *   ./a.out
+ *
+ * A sine converted from 44.1 to 48 kHz must match the ideal sine at the output rate, at every quality level, and
+ * come out the same no matter how the input is split into chunks. A tone above the output's Nyquist frequency must be
+ * filtered out instead of aliasing. Then it reports how many times faster than real time a 44.1 kHz stereo stream is
+ * converted to 48 kHz.
+ **/
+#include "../src/audio/audio.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INPUT_FRAMES 44100
+#define MAX_OUTPUT (INPUT_FRAMES * 2)
+#define BENCH_SECONDS 60
+
+static int16_t input[INPUT_FRAMES * 2];
+static int16_t output[MAX_OUTPUT * 2];
+static int16_t chunked[MAX_OUTPUT * 2];
+
+static void sine(int rate, double frequency) {
+  double pi = atan(1.0) * 4;
+  int i;
+  for(i = 0; i < INPUT_FRAMES; i++) {
+    input[i * 2] = (int16_t)lrint(16000 * sin(2 * pi * frequency * i / rate));
+    input[i * 2 + 1] = (int16_t)lrint(-8000 * sin(2 * pi * frequency * i / rate));
+  }
+}
+
+/**
+ * Feeds the input in chunks of random length, or all at once for chunkFrames 0.
+ **/
+static int resample(int16_t* dst, int inputRate, int outputRate, int quality, int chunkFrames) {
+  audio_resampler_t resampler;
+  int done = 0, written = 0;
+  audio_resampler_init(&resampler, outputRate, quality);
+  while(done < INPUT_FRAMES) {
+    int frames = chunkFrames == 0 ? INPUT_FRAMES : 1 + rand() % chunkFrames;
+    int produced;
+    if(frames > INPUT_FRAMES - done) {
+      frames = INPUT_FRAMES - done;
+    }
+    produced = audio_resample(&resampler, dst + written * 2, input + done * 2, frames, inputRate, 2, 1);
+    if(produced > audio_resampler_max_output(&resampler, inputRate, frames)) {
+      printf("FAIL: %d frames put out for %d frames of input, more than the maximum\n", produced, frames);
+      exit(1);
+    }
+    done += frames;
+    written += produced;
+  }
+  audio_resampler_destroy(&resampler);
+  return written;
+}
+
+static int testSine(int quality, double minimumSnr) {
+  double pi = atan(1.0) * 4;
+  double signal = 0, noise = 0, snr;
+  int frames = resample(output, 44100, 48000, quality, 0);
+  int expectedFrames = (int)((int64_t)INPUT_FRAMES * 48000 / 44100);
+  int i;
+  if(abs(frames - expectedFrames) > 64) {
+    printf("FAIL: %d frames instead of about %d\n", frames, expectedFrames);
+    return 0;
+  }
+  //Skip the start, where the filter had silence before the first frame.
+  for(i = 100; i < frames; i++) {
+    double ideal = 16000 * sin(2 * pi * 1000 * i / 48000);
+    signal += ideal * ideal;
+    noise += (output[i * 2] - ideal) * (output[i * 2] - ideal);
+  }
+  snr = 10 * log10(signal / noise);
+  if(snr < minimumSnr) {
+    printf("FAIL: quality %d has a signal to noise ratio of %.1f dB, less than %.0f dB\n", quality, snr, minimumSnr);
+    return 0;
+  }
+  printf("quality %d: %.1f dB signal to noise ratio\n", quality, snr);
+
+  if(resample(chunked, 44100, 48000, quality, 700) != frames) {
+    printf("FAIL: quality %d puts out a different number of frames when fed in chunks\n", quality);
+    return 0;
+  }
+  for(i = 0; i < frames * 2; i++) {
+    if(chunked[i] != output[i]) {
+      printf("FAIL: quality %d differs at sample %d when fed in chunks\n", quality, i);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int testAliasing(void) {
+  double sum = 0, rms;
+  int frames, i;
+  sine(48000, 15000);
+  frames = resample(output, 48000, 22050, AUDIO_RESAMPLE_MEDIUM, 0);
+  for(i = 100; i < frames; i++) {
+    sum += (double)output[i * 2] * output[i * 2];
+  }
+  rms = sqrt(sum / (frames - 100));
+  //The input has an RMS of about 11300.
+  if(rms > 50) {
+    printf("FAIL: a 15 kHz tone resampled to 22.05 kHz leaves an RMS of %.1f\n", rms);
+    return 0;
+  }
+  return 1;
+}
+
+int main(void) {
+  audio_resampler_t resampler;
+  uint64_t start;
+  double seconds;
+  int i;
+
+  printf("audio_dsp_fir2 uses %s\n", audio_dsp_name());
+  sine(44100, 1000);
+  if(!testSine(AUDIO_RESAMPLE_LOW, 55) || !testSine(AUDIO_RESAMPLE_MEDIUM, 75) ||
+    !testSine(AUDIO_RESAMPLE_HIGH, 85) || !testAliasing()) {
+    return 1;
+  }
+
+  sine(44100, 1000);
+  for(i = AUDIO_RESAMPLE_LOW; i <= AUDIO_RESAMPLE_HIGH; i++) {
+    int second;
+    audio_resampler_init(&resampler, 48000, i);
+    start = uv_hrtime();
+    for(second = 0; second < BENCH_SECONDS; second++) {
+      audio_resample(&resampler, output, input, INPUT_FRAMES, 44100, 2, 1);
+    }
+    seconds = (uv_hrtime() - start) / 1e9;
+    audio_resampler_destroy(&resampler);
+    printf("quality %d: %d s of 44.1 kHz stereo to 48 kHz in %.1f ms, %.0fx real time\n", i, BENCH_SECONDS,
+      seconds * 1000, BENCH_SECONDS / seconds);
+  }
+
+  printf("OK\n");
+  return 0;
+}
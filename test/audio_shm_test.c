@@ -0,0 +1,208 @@
+/**
+ * Test for the shared memory audio ring. Not part of the node module, build and run it with
+ *
+ *   gcc -O2 -I<node include dir> test/audio_shm_test.c src/audio/audio.c src/audio/audio-pool.c \
+ *     src/audio/audio-dsp.c src/audio/shm-audio.c -luv -lpthread -lrt
+ *   ./a.out
+ *
+ * The parent queues chunks of a running frame count and writes them into an anonymous ring, a child process reads the
+ * inherited fd with the audio mapped twice in a row, like an out-of-process consumer would. While the child keeps up
+ * it must read every frame in order and see the format change at the right index. Then it stops reading while the
+ * parent writes several times the ring, it must notice that it was overtaken and read valid audio again afterwards.
+ **/
+#include "../src/audio/audio.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CAPACITY 65536
+#define FRAMES 441
+#define CHUNKS 5000
+#define OVERRUN_CHUNKS (4 * CAPACITY / (FRAMES * 4))
+#define RATE_CHANGE (CHUNKS / 2)
+
+typedef struct {
+  uint64_t cursor;
+  int paused;
+  int resumed;
+} progress_t;
+
+typedef struct {
+  uint32_t sampleRate;
+  uint64_t formatIndex;
+  uint64_t writeIndex;
+} snapshot_t;
+
+static progress_t* progress;
+
+static void snapshot(const audio_shm_header_t* header, snapshot_t* copy) {
+  uint32_t before, after;
+  do {
+    while((before = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE)) & 1) {
+      sched_yield();
+    }
+    copy->sampleRate = header->sampleRate;
+    copy->formatIndex = header->formatIndex;
+    copy->writeIndex = header->writeIndex;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    after = __atomic_load_n(&header->sequence, __ATOMIC_RELAXED);
+  } while(before != after);
+}
+
+/**
+Reads the ring until the parent is done. Returns the exit code.
+**/
+static int readRing(int fd) {
+  const audio_shm_header_t* header = mmap(NULL, AUDIO_SHM_HEADER_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+  unsigned char* audio = mmap(NULL, 2 * CAPACITY, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  uint64_t total = (uint64_t)(CHUNKS + OVERRUN_CHUNKS) * FRAMES * 4;
+  uint64_t cursor = 0;
+  int16_t frames[CAPACITY / 2];
+  snapshot_t before, after;
+  int overruns = 0, framesAfterOverrun = 0, formatSeen = 0;
+
+  if(header == MAP_FAILED || audio == MAP_FAILED ||
+    mmap(audio, CAPACITY, PROT_READ, MAP_SHARED | MAP_FIXED, fd, AUDIO_SHM_HEADER_SIZE) == MAP_FAILED ||
+    mmap(audio + CAPACITY, CAPACITY, PROT_READ, MAP_SHARED | MAP_FIXED, fd, AUDIO_SHM_HEADER_SIZE) == MAP_FAILED) {
+    printf("FAIL: the ring could not be mapped\n");
+    return 1;
+  }
+  if(header->magic != AUDIO_SHM_MAGIC || header->capacity != CAPACITY || header->headerSize != AUDIO_SHM_HEADER_SIZE) {
+    printf("FAIL: the header is not set up\n");
+    return 1;
+  }
+  while(cursor < total) {
+    uint64_t bytes, i;
+    if(cursor >= (uint64_t)CHUNKS * FRAMES * 4 && !__atomic_load_n(&progress->resumed, __ATOMIC_ACQUIRE)) {
+      //Stop reading and let the parent overtake us.
+      __atomic_store_n(&progress->paused, 1, __ATOMIC_RELEASE);
+      usleep(1000);
+      continue;
+    }
+    snapshot(header, &before);
+    if(before.writeIndex == cursor) {
+      sched_yield();
+      continue;
+    }
+    if(before.writeIndex - cursor > CAPACITY) {
+      overruns++;
+      cursor = before.writeIndex - CAPACITY / 2;
+      continue;
+    }
+    bytes = before.writeIndex - cursor;
+    memcpy(frames, audio + (cursor & (CAPACITY - 1)), bytes);
+    snapshot(header, &after);
+    if(after.writeIndex - cursor > CAPACITY) {
+      overruns++;
+      cursor = after.writeIndex - CAPACITY / 2;
+      continue;
+    }
+    for(i = 0; i < bytes / 4; i++) {
+      uint64_t frame = cursor / 4 + i;
+      if(frames[i * 2] != (int16_t)(frame % 32000) || frames[i * 2 + 1] != (int16_t)(frame % 32000)) {
+        printf("FAIL: frame %llu is %d instead of %d\n", (unsigned long long)frame, frames[i * 2],
+          (int)(frame % 32000));
+        return 1;
+      }
+    }
+    if(overruns > 0) {
+      framesAfterOverrun += bytes / 4;
+    }
+    if(before.sampleRate == 48000 && !formatSeen) {
+      formatSeen = 1;
+      if(before.formatIndex != (uint64_t)RATE_CHANGE * FRAMES * 4) {
+        printf("FAIL: the format changed at %llu instead of %llu\n", (unsigned long long)before.formatIndex,
+          (unsigned long long)RATE_CHANGE * FRAMES * 4);
+        return 1;
+      }
+    }
+    cursor += bytes;
+    __atomic_store_n(&progress->cursor, cursor, __ATOMIC_RELEASE);
+  }
+  if(!formatSeen || overruns == 0 || framesAfterOverrun == 0) {
+    printf("FAIL: format change %sseen, %d overruns, %d frames read after them\n", formatSeen ? "" : "not ", overruns,
+      framesAfterOverrun);
+    return 1;
+  }
+  printf("%d overruns, %d frames read after them\n", overruns, framesAfterOverrun);
+  return 0;
+}
+
+static void writeChunk(audio_fifo_t* audioFifo, audio_pool_t* pool, audio_shm_ring_t* ring, unsigned int chunk) {
+  audio_fifo_data_t* audioData = audio_data_alloc(pool, FRAMES * 2 * sizeof(int16_t));
+  int i;
+  audioData->epoch = 0;
+  audioData->channels = 2;
+  audioData->sampleRate = chunk < RATE_CHANGE ? 44100 : 48000;
+  audioData->numberOfSamples = FRAMES;
+  for(i = 0; i < FRAMES; i++) {
+    uint64_t frame = (uint64_t)chunk * FRAMES + i;
+    audioData->samples[i * 2] = (int16_t)(frame % 32000);
+    audioData->samples[i * 2 + 1] = (int16_t)(frame % 32000);
+  }
+  while(!audio_fifo_put(audioFifo, audioData)) {
+    sched_yield();
+  }
+  audio_shm_drain(audioFifo, ring);
+}
+
+int main(void) {
+  static audio_fifo_t audioFifo;
+  audio_shm_ring_t ring;
+  audio_pool_t* pool;
+  unsigned int chunk;
+  int status, error;
+  pid_t child;
+
+  progress = mmap(NULL, sizeof(progress_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if((error = audio_shm_open(&ring, NULL, CAPACITY)) != 0) {
+    printf("FAIL: the ring could not be created: %s\n", strerror(-error));
+    return 1;
+  }
+  if(audio_shm_open(&(audio_shm_ring_t){0}, NULL, CAPACITY + 4096) != -EINVAL) {
+    printf("FAIL: a capacity that is no power of two was taken\n");
+    return 1;
+  }
+  if((child = fork()) == 0) {
+    exit(readRing(ring.fd));
+  }
+  pool = audio_pool_create();
+  audio_init(&audioFifo);
+  for(chunk = 0; chunk < CHUNKS; chunk++) {
+    //Stay within the ring while the child reads.
+    while(((uint64_t)chunk + 1) * FRAMES * 4 - __atomic_load_n(&progress->cursor, __ATOMIC_ACQUIRE) > CAPACITY) {
+      sched_yield();
+    }
+    writeChunk(&audioFifo, pool, &ring, chunk);
+  }
+  while(!__atomic_load_n(&progress->paused, __ATOMIC_ACQUIRE)) {
+    usleep(1000);
+  }
+  for(; chunk < CHUNKS + OVERRUN_CHUNKS - 10; chunk++) {
+    writeChunk(&audioFifo, pool, &ring, chunk);
+  }
+  __atomic_store_n(&progress->resumed, 1, __ATOMIC_RELEASE);
+  for(; chunk < CHUNKS + OVERRUN_CHUNKS; chunk++) {
+    usleep(1000);
+    writeChunk(&audioFifo, pool, &ring, chunk);
+  }
+  waitpid(child, &status, 0);
+  if(ring.header->frames != (uint64_t)(CHUNKS + OVERRUN_CHUNKS) * FRAMES) {
+    printf("FAIL: the header counts %llu frames\n", (unsigned long long)ring.header->frames);
+    return 1;
+  }
+  audio_shm_close(&ring);
+  audio_stop(&audioFifo);
+  audio_pool_release(pool);
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -1,4 +1,8 @@
-var spotify = require('../build/Debug/spotify')({appkeyFile: '../spotify_appkey.key'});
+//SPOTIFY_ENGINE=thread runs the tests with libspotify on its own thread.
+var spotify = require('../build/Debug/spotify')({
+  appkeyFile: '../spotify_appkey.key',
+  engine: process.env.SPOTIFY_ENGINE || 'loop'
+});
 var loginData = require('./loginData.js');
 
 /*
@@ -0,0 +1,70 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+
+baseTest.executeTest(test);
+
+/*
+ * Benchmark for the buffer watermarks. Plays the same track with different watermarks into a consumer that takes
+ * audio in real time like a sound card would. For every setting it prints how much audio was queued (the latency
+ * between libspotify delivering audio and it being played) and how often the queue was refilled (the burstiness
+ * of the download). Low watermarks give low latency but make libspotify deliver small amounts all the time, high
+ * watermarks let it download in a few large bursts at the cost of latency, which the telemetry measures per chunk.
+ */
+var settings = [
+  { lowWatermark: 50, highWatermark: 100 },
+  { lowWatermark: 250, highWatermark: 500 },
+  { lowWatermark: 1000, highWatermark: 1000 },
+  { lowWatermark: 2000, highWatermark: 5000 },
+  { lowWatermark: 5000, highWatermark: 10000 }
+];
+var secondsPerSetting = 30;
+var track;
+
+function benchmark(options, done) {
+  var queued = [];
+  var needMoreData = spotify.useNodejsAudio(function(err, buffer) {
+    //Pretend to play the buffer and only ask for the next one when it is done.
+    setTimeout(function() {
+      needMoreData(true);
+    }, buffer.length / 4 / buffer.sampleRate * 1000);
+    return false;
+  }, options);
+
+  var sampler = setInterval(function() {
+    queued.push(spotify.audioStats().buffer.milliseconds);
+  }, 50);
+
+  spotify.player.play(track);
+  setTimeout(function() {
+    clearInterval(sampler);
+    var stats = spotify.audioStats();
+    var refills = stats.buffer.refills;
+    var latency = stats.telemetry.latency;
+    spotify.player.stop();
+    queued.sort(function(a, b) { return a - b; });
+    var mean = queued.reduce(function(sum, value) { return sum + value; }, 0) / queued.length;
+    console.log('low ' + options.lowWatermark + ' ms, high ' + options.highWatermark + ' ms: ' +
+      'queued mean ' + Math.round(mean) + ' ms, median ' + queued[Math.floor(queued.length / 2)] + ' ms, ' +
+      'max ' + queued[queued.length - 1] + ' ms, ' +
+      (refills / secondsPerSetting * 60).toFixed(1) + ' refills per minute, ' +
+      'latency median ' + latency.p50 + ' ms, 99th percentile ' + latency.p99 + ' ms, ' +
+      stats.telemetry.underruns + ' underruns');
+    done();
+  }, secondsPerSetting * 1000);
+}
+
+function test() {
+  console.log('Starting tests, ' + secondsPerSetting + ' seconds per setting');
+  track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var next = 0;
+  function runNext() {
+    if(next === settings.length) {
+      spotify.logout(function () {
+        process.exit();
+      });
+      return;
+    }
+    benchmark(settings[next++], runNext);
+  }
+  runNext();
+}
@@ -0,0 +1,68 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+
+baseTest.executeTest(test);
+
+/*
+ * Loads all playlists and their tracks while a timer measures how late the event loop runs it, run it as
+ *
+ *   node engine.js
+ *   SPOTIFY_ENGINE=thread node engine.js
+ *
+ * to compare the main loop with the engine thread. With the engine thread libspotify's work happens beside the loop,
+ * the callbacks come back in order and everything must still load. On the main loop a pump must not take much longer
+ * than its budget before it yields.
+ */
+var interval = 5;
+var duration = 10000;
+
+function test() {
+  var playlists = spotify.playlistContainer.getPlaylists();
+  var loaded = 0;
+  var tracks = 0;
+  var maxLag = 0;
+  var sameTracks = true;
+  var last = Date.now();
+  var timer = setInterval(function() {
+    var now = Date.now();
+    maxLag = Math.max(maxLag, now - last - interval);
+    last = now;
+  }, interval);
+
+  spotify.waitForLoaded(playlists, function(playlist) {
+    loaded++;
+    var playlistTracks = playlist.getTracks();
+    tracks += playlistTracks.length;
+    if(playlistTracks.length > 0 && playlist.getTrack(0) !== playlistTracks[0]) {
+      sameTracks = false;
+    }
+    spotify.waitForLoaded(playlistTracks, function() {});
+  });
+
+  setTimeout(function() {
+    clearInterval(timer);
+    console.log('engine ' + (process.env.SPOTIFY_ENGINE || 'loop') + ': ' + loaded + ' of ' + playlists.length +
+      ' playlists with ' + tracks + ' tracks loaded, the event loop was up to ' + maxLag + ' ms late');
+    var stats = spotify.engineStats();
+    console.log(stats.pumps + ' pumps, ' + stats.yields + ' yielded after ' + stats.pumpBudget + ' ms, the longest took ' +
+      stats.duration.max + ' us and ' + stats.iterations.max + ' iterations');
+    console.log(stats.metadataUpdated.notifications + ' metadata notifications in ' +
+      stats.metadataUpdated.dispatches + ' calls of metadataUpdated');
+    console.log(stats.loadWatch.resolved + ' objects were loaded, ' + stats.loadWatch.pending + ' are still pending');
+    var playlistTracks = stats.wrappers.playlistTracks;
+    console.log(playlistTracks.hits + ' of ' + (playlistTracks.hits + playlistTracks.misses) +
+      ' playlist tracks were an existing object, ' + playlistTracks.size + ' are alive');
+    if(stats.metadataUpdated.dispatches > stats.metadataUpdated.notifications) {
+      console.log('FAIL: metadataUpdated was called more often than libspotify notified');
+    }
+    if(!sameTracks) {
+      console.log('FAIL: the same playlist track gave another object');
+    }
+    if(loaded === 0 && playlists.length > 0) {
+      console.log('FAIL: no playlist was loaded');
+    }
+    spotify.logout(function () {
+      process.exit();
+    });
+  }, duration);
+}
@@ -0,0 +1,63 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+var fs = require('fs');
+
+baseTest.executeTest(test);
+
+/*
+ * Writes a track to files without a sound card, the same track once as one WAV file per track, once as raw PCM
+ * with direct writes and preallocation. The file sink takes audio as fast as libspotify delivers it, so it has to be
+ * at least in real time, and the file has to hold what was played with a header that matches it. Prints how many
+ * times faster than real time the audio was written, as a baseline for the other sinks.
+ */
+var secondsPerRun = 10;
+var runs = [
+  { path: '/tmp/node-spotify-%d.wav', file: '/tmp/node-spotify-1.wav' },
+  { path: '/tmp/node-spotify.raw', file: '/tmp/node-spotify.raw', direct: true, preallocate: 64 * 1024 * 1024 }
+];
+var track;
+
+function run(options, done) {
+  spotify.useFileAudio(options.path, options);
+  spotify.player.play(track);
+  setTimeout(function() {
+    var position = spotify.player.position;
+    var file = spotify.audioStats().file;
+    spotify.player.stop();
+    //Stops the writing thread, which completes the file.
+    spotify.useFileAudio('/dev/null', { format: 'raw' });
+    var data = fs.readFileSync(options.file);
+    var headerSize = options.file.indexOf('.wav') > 0 ? 44 : 0;
+    var seconds = (data.length - headerSize) / 4 / 44100;
+    console.log(options.path + ': ' + seconds.toFixed(2) + ' s written in ' + secondsPerRun + ' s, ' +
+      (seconds / secondsPerRun).toFixed(1) + 'x real time, ' + file.writes + ' writes' +
+      (file.direct ? ', direct' : '') + (file.preallocated ? ', preallocated' : ''));
+    if(position < secondsPerRun * 1000 - 1500) {
+      console.log('FAIL: ' + options.path + ' was not written at least in real time');
+    }
+    if(seconds < position / 1000 - 0.5) {
+      console.log('FAIL: the file holds ' + seconds.toFixed(2) + ' s, ' + (position / 1000).toFixed(2) + ' s were played');
+    }
+    if(headerSize > 0 && (data.toString('ascii', 0, 4) !== 'RIFF' || data.readUInt32LE(40) !== data.length - 44)) {
+      console.log('FAIL: the WAV header does not match the audio');
+    }
+    fs.unlinkSync(options.file);
+    done();
+  }, secondsPerRun * 1000);
+}
+
+function test() {
+  console.log('Starting tests, ' + secondsPerRun + ' seconds per run');
+  track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var next = 0;
+  function runNext() {
+    if(next === runs.length) {
+      spotify.logout(function () {
+        process.exit();
+      });
+      return;
+    }
+    run(runs[next++], runNext);
+  }
+  runNext();
+}
@@ -0,0 +1,45 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+
+baseTest.executeTest(test);
+
+/*
+ * Plays the last seconds of a track with the next one set, the player has to switch on its own.
+ * player.position has to go back to 0 only when the audio of the second track is played, not when it is loaded.
+ */
+function test() {
+  console.log('Starting tests');
+  var first = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var second = spotify.createFromLink('spotify:track:4ue6O2GB9hQJXRbbIqsM2Z');
+  var tracksEnded = 0;
+  spotify.player.on({
+    endOfTrack: function() {
+      tracksEnded++;
+      console.log('End of track ' + tracksEnded + ' at position ' + spotify.player.position.toFixed(1) + ' ms');
+    }
+  });
+
+  spotify.player.play(first);
+  spotify.player.seek(Math.floor(first.duration / 1000) - 5);
+  spotify.player.setNext(second);
+
+  var lastPosition = 0;
+  var positionChecker = setInterval(function() {
+    var position = spotify.player.position;
+    if(position < lastPosition) {
+      console.log('Second track started playing after ' + tracksEnded + ' end of track, position ' + position.toFixed(1) + ' ms');
+    }
+    lastPosition = position;
+  }, 10);
+
+  setTimeout(function() {
+    clearInterval(positionChecker);
+    if(tracksEnded !== 1 || lastPosition < 5000) {
+      console.log('FAIL: the second track did not play on after the first one');
+    }
+    spotify.player.stop();
+    spotify.logout(function () {
+      process.exit();
+    });
+  }, 15000);
+}
@@ -0,0 +1,67 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+var http = require('http');
+
+baseTest.executeTest(test);
+
+/*
+ * Streams a track over HTTP to several listeners at once, one of them asking for ICY metadata, the same as
+ *
+ *   curl -s http://127.0.0.1:<port>/ > stream.wav
+ *   curl -s -H 'Icy-MetaData: 1' http://127.0.0.1:<port>/ > /dev/null
+ *
+ * The server paces the audio in real time, every listener must get about as much audio as was played and the ICY
+ * listener the title of the track.
+ */
+var seconds = 10;
+var listeners = 4;
+
+function test() {
+  var track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var port = spotify.useHttpAudio({ format: 'wav' });
+  var received = [];
+  var title = null;
+  for(var i = 0; i < listeners; i++) {
+    (function(i) {
+      var headers = i === 0 ? { 'Icy-MetaData': '1' } : {};
+      received[i] = 0;
+      http.get({ host: '127.0.0.1', port: port, path: '/', headers: headers }, function(response) {
+        response.on('data', function(data) {
+          received[i] += data.length;
+          var match = /StreamTitle='([^']*)';/.exec(data.toString('binary'));
+          if(match) {
+            title = match[1];
+          }
+        });
+      });
+    })(i);
+  }
+  spotify.player.play(track);
+
+  setTimeout(function() {
+    var position = spotify.player.position;
+    var stats = spotify.audioStats().http;
+    spotify.player.stop();
+    console.log('http: ' + stats.listeners + ' listeners, ' + (position / 1000).toFixed(2) + ' s played, received ' +
+      received.map(function(bytes) { return (bytes / 4 / 44100).toFixed(2) + ' s'; }).join(', ') + ', title: ' + title);
+    if(stats.listeners !== listeners) {
+      console.log('FAIL: ' + stats.listeners + ' of ' + listeners + ' listeners connected');
+    }
+    if(position > seconds * 1000 + 500) {
+      console.log('FAIL: the audio was not paced in real time');
+    }
+    received.forEach(function(bytes) {
+      if(bytes / 4 / 44.1 < position - 1500) {
+        console.log('FAIL: a listener got ' + (bytes / 4 / 44100).toFixed(2) + ' s of audio');
+      }
+    });
+    if(!title) {
+      console.log('FAIL: the ICY listener got no title');
+    }
+    //Stops the server, which disconnects the listeners.
+    spotify.useFileAudio('/dev/null', { format: 'raw' });
+    spotify.logout(function () {
+      process.exit();
+    });
+  }, seconds * 1000);
+}
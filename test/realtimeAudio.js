@@ -0,0 +1,75 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+var childProcess = require('child_process');
+var os = require('os');
+
+baseTest.executeTest(test);
+
+/*
+ * Benchmark for the scheduling options of the native audio thread. Plays into a device with a small buffer while
+ * every CPU is kept busy by other processes and the main thread churns through JSON like a busy server would, once
+ * with the default scheduling and once with realtime priority, pinned to CPU 0 and with locked memory. Prints the
+ * xruns of both runs. Realtime scheduling needs root or CAP_SYS_NICE (or an rtprio limit), without it the second run
+ * reports that it fell back to normal priority.
+ * The device defaults to the dummy sound card (modprobe snd-dummy), set ALSA_DEVICE to use another one.
+ */
+var device = process.env.ALSA_DEVICE || 'hw:Dummy';
+var secondsPerRun = 30;
+var runs = [
+  { name: 'default scheduling' },
+  { name: 'realtime', realtime: 'fifo', priority: 50, cpus: [0], lockMemory: true }
+];
+var track;
+
+function busyProcesses() {
+  var children = [];
+  for(var i = 0; i < os.cpus().length * 2; i++) {
+    children.push(childProcess.spawn(process.execPath, ['-e', 'for(;;) {}']));
+  }
+  return children;
+}
+
+function run(options, done) {
+  options.device = device;
+  options.outputRate = 48000;
+  options.periodSize = 128;
+  options.bufferSize = 512;
+  spotify.useNativeAudio(options);
+  var children = busyProcesses();
+  var churn = setInterval(function() {
+    var data = [];
+    for(var i = 0; i < 20000; i++) {
+      data.push({ index: i, name: 'track ' + i, artists: ['a', 'b'] });
+    }
+    JSON.parse(JSON.stringify(data));
+  }, 10);
+
+  spotify.player.play(track);
+  setTimeout(function() {
+    clearInterval(churn);
+    children.forEach(function(child) { child.kill(); });
+    var output = spotify.audioStats().output;
+    spotify.player.stop();
+    console.log(options.name + ': ' + output.xruns + ' xruns in ' + secondsPerRun + ' s' +
+      (options.realtime ? ', realtime ' + output.realtime + ', pinned ' + output.affinity +
+        ', memory locked ' + output.memoryLocked : ''));
+    done();
+  }, secondsPerRun * 1000);
+}
+
+function test() {
+  console.log('Starting tests on ' + device + ', ' + secondsPerRun + ' seconds per run');
+  track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var next = 0;
+  function runNext() {
+    if(next === runs.length) {
+      spotify.useNativeAudio();
+      spotify.logout(function () {
+        process.exit();
+      });
+      return;
+    }
+    run(runs[next++], runNext);
+  }
+  runNext();
+}
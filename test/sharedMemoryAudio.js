@@ -0,0 +1,54 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+var fs = require('fs');
+
+baseTest.executeTest(test);
+
+/*
+ * Plays a track to /dev/null with a shared memory ring as another sink and reads the ring through /proc like another
+ * process would. The header must be set up, count all frames that were played and the audio up to its write index
+ * must be in the ring.
+ */
+var seconds = 5;
+
+function readUInt64(buffer, offset) {
+  return buffer.readUInt32LE(offset) + buffer.readUInt32LE(offset + 4) * 4294967296;
+}
+
+function test() {
+  var track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  spotify.useFileAudio('/dev/null', { format: 'raw' });
+  var ring = spotify.useSharedMemoryAudio({ add: true, backpressure: 'block', size: 1024 * 1024 });
+  spotify.player.play(track);
+
+  setTimeout(function() {
+    var position = spotify.player.position;
+    spotify.player.stop();
+    var fd = fs.openSync('/proc/self/fd/' + ring.fd, 'r');
+    var header = new Buffer(72);
+    fs.readSync(fd, header, 0, header.length, 0);
+    var frames = readUInt64(header, 48);
+    var writeIndex = readUInt64(header, 40);
+    var audio = new Buffer(4096);
+    fs.readSync(fd, audio, 0, audio.length, ring.headerSize + (writeIndex - audio.length) % ring.size);
+    fs.closeSync(fd);
+    console.log('ring: ' + ring.size + ' bytes, ' + (frames / 44100).toFixed(2) + ' s written, ' +
+      (position / 1000).toFixed(2) + ' s played');
+    if(header.readUInt32LE(0) !== 0x4d525053 || header.readUInt32LE(12) !== ring.size) {
+      console.log('FAIL: the header is not set up');
+    }
+    if(header.readUInt32LE(20) !== 44100 || header.readUInt32LE(24) !== 2 || writeIndex !== frames * 4) {
+      console.log('FAIL: the header does not describe the audio');
+    }
+    if(frames / 44.1 < position - 1000) {
+      console.log('FAIL: ' + (frames / 44100).toFixed(2) + ' s in the ring, ' + (position / 1000).toFixed(2) +
+        ' s were played');
+    }
+    if(audio.readUInt32LE(0) === 0 && audio.readUInt32LE(2048) === 0 && audio.readUInt32LE(4092) === 0) {
+      console.log('FAIL: the ring holds silence');
+    }
+    spotify.logout(function () {
+      process.exit();
+    });
+  }, seconds * 1000);
+}
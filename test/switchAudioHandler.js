@@ -0,0 +1,47 @@
+var baseTest = require('./basetest.js');
+var spotify = baseTest.spotify;
+
+baseTest.executeTest(test);
+
+/*
+ * Switches the audio handler back and forth while a track plays: native audio, a node.js stream and a file. Every
+ * switch has to keep the playback position and the audio that was queued, the new handler starts with it instead of
+ * an empty queue.
+ */
+var switches = 6;
+var interval = 1500;
+
+function test() {
+  var track = spotify.createFromLink('spotify:track:6koWevx9MqN6efQ6qreIbm');
+  var handlers = [
+    function() { spotify.useNativeAudio(); },
+    function() { spotify.player.stream().on('data', function() {}); },
+    function() { spotify.useFileAudio('/dev/null', { format: 'raw' }); }
+  ];
+  var done = 0;
+  spotify.useNativeAudio();
+  spotify.player.play(track);
+
+  var timer = setInterval(function() {
+    var before = spotify.player.position;
+    var queued = spotify.audioStats().buffer.milliseconds;
+    handlers[done % handlers.length]();
+    var after = spotify.player.position;
+    var stats = spotify.audioStats();
+    console.log('switch ' + (done + 1) + ': ' + (before / 1000).toFixed(2) + ' s, ' + queued + ' ms queued, ' +
+      stats.buffer.milliseconds + ' ms queued after the switch');
+    if(after < before) {
+      console.log('FAIL: the position went back from ' + before + ' to ' + after + ' ms');
+    }
+    if(queued > 0 && stats.telemetry.framesDelivered === 0 && stats.buffer.samples === 0) {
+      console.log('FAIL: the queued audio was not handed over');
+    }
+    if(++done === switches) {
+      clearInterval(timer);
+      spotify.player.stop();
+      spotify.logout(function () {
+        process.exit();
+      });
+    }
+  }, interval);
+}